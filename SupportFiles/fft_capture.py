@@ -0,0 +1,74 @@
+'''
+Reader for the binary capture files (.fcap) written by host/csv2fcap.
+
+The layout is described in host/fft_capture.h: a 64 byte header, frames
+of N little endian 16 bit samples starting on a page boundary, one every
+frame_stride bytes, and an index of uint64 start times in ns. The file is
+mapped, so opening a large capture reads nothing but the header and a
+frame is only paged in when it is used.
+
+  cap = fft_capture.Capture('fft_input.fcap')
+  cap.samples, cap.sample_rate, cap.q_format, len(cap)
+  cap.frame(0)       samples of the first frame
+  cap.time(0)        its start time in ns
+'''
+
+import mmap
+import struct
+from array import array
+
+try:
+    import numpy
+except ImportError:
+    numpy = None
+
+MAGIC = 'FCAP'
+VERSION = 1
+
+#magic, version, header size, samples, sample rate, Q format,
+#frame stride, frame count, frames offset, index offset
+HEADER = struct.Struct('<4sHHIIB3xIQQQ16x')
+
+
+class Capture(object):
+
+    def __init__(self, path):
+        f = open(path, 'rb')
+        try:
+            self.map = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        finally:
+            f.close()
+
+        (magic, version, header_size, self.samples, self.sample_rate,
+         self.q_format, self.frame_stride, self.frame_count,
+         self.frames_offset, self.index_offset) = HEADER.unpack_from(self.map, 0)
+        if magic != MAGIC or version != VERSION or header_size != HEADER.size:
+            self.map.close()
+            raise ValueError(path + ' is not a capture file')
+        if self.index_offset + 8 * self.frame_count > len(self.map):
+            self.map.close()
+            raise ValueError(path + ' is truncated')
+
+    def __len__(self):
+        return self.frame_count
+
+    def frame(self, i):
+        '''Samples of frame i, a numpy view of the map if numpy is there'''
+        if i < 0 or i >= self.frame_count:
+            raise IndexError(i)
+        start = self.frames_offset + i * self.frame_stride
+        if numpy is not None:
+            return numpy.frombuffer(self.map, dtype='<i2', count=self.samples,
+                                    offset=start)
+        values = array('h')
+        values.fromstring(self.map[start:start + 2 * self.samples])
+        return values
+
+    def time(self, i):
+        '''Start time of frame i in ns'''
+        if i < 0 or i >= self.frame_count:
+            raise IndexError(i)
+        return struct.unpack_from('<Q', self.map, self.index_offset + 8 * i)[0]
+
+    def close(self):
+        self.map.close()
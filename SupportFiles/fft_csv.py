@@ -2,14 +2,36 @@
 This program reads SAMPLES no. of inputs from fft_input.csv
 and sends to COM4 at 9600 baud rate.
 It then receives back the magnitudes from the FFT
-The output is stored in fft_output.csv
+The output is stored in fft_output.csv, and appended to the spectrum
+store fft_output.fspec that keeps the spectra of every run
 The input and output are then displayed using matplotlib
+
+Usage: fft_csv.py [port] [samples] [sample frequency] [input file] [ring]
+The board is switched to the requested size and sample frequency
+before the frame is sent. The input can also be a capture written by
+host/csv2fcap; its first frame is sent and its sample frequency used.
+Given a ring name, the spectrum is published there for fft_viewer.py
+instead of being plotted, so the script does not wait on a window.
+The frame's round trip is timed as fft_latency.py describes, and its
+split is written to fft_latency.json. The whole serial session is logged
+to fft_session.fses; give that (or name.fses@speed) as the port to run
+again against the recorded board.
 '''
 
 #Import libraries
-import serial
 import csv
+import sys
 import matplotlib.pyplot as plt
+import fft_protocol
+import fft_capture
+import fft_store
+import fft_ring
+import fft_latency
+import fft_session
+import time
+
+#Serial port
+port = 'COM4'
 
 #Set length of signal
 SAMPLES = 1024
@@ -17,8 +39,23 @@ SAMPLES = 1024
 #Sampling frequency - purely for graphs to be correctly scaled
 fs = 8192
 
+if len(sys.argv) > 1:
+    port = sys.argv[1]
+if len(sys.argv) > 2:
+    SAMPLES = int(sys.argv[2])
+if len(sys.argv) > 3:
+    fs = int(sys.argv[3])
+
 input_file = 'fft_input.csv'
+if len(sys.argv) > 4:
+    input_file = sys.argv[4]
+ring_name = None
+if len(sys.argv) > 5:
+    ring_name = sys.argv[5]
 output_file = 'fft_output.csv'
+store_file = 'fft_output.fspec'
+latency_file = 'fft_latency.json'
+session_file = 'fft_session.fses'
 
 print "Send input signal of length " + str(fs) + " from " + input_file + " to board and receive FFT magnitude"
 print "Store results in " + output_file + " and display input and output using Matplotlib"
@@ -26,55 +63,74 @@ print "Store results in " + output_file + " and display input and output using M
 #Store input values
 values = []
 
-#Read inputs from csv
-with open(input_file, 'rb') as f:
-    reader = csv.reader(f)
-    for row in reader:
-        values.append(row)
-
-    f.close()
+if input_file.endswith('.fcap'):
+    #Capture frames are already binary, nothing to parse
+    capture = fft_capture.Capture(input_file)
+    if len(capture) > 0:
+        values = [int(v) for v in capture.frame(0)]
+    fs = capture.sample_rate
+    capture.close()
+else:
+    #Read inputs from csv
+    with open(input_file, 'rb') as f:
+        reader = csv.reader(f)
+        for row in reader:
+            values.append(int(row[0]))
+
+        f.close()
 
 #print values
 
-#Connect to serial channel and send input
-s = serial.Serial('COM4', 9600)
+#Connect to serial channel and set the board up
+#Log the session unless it is itself a replay
+record = None if port.partition('@')[0].endswith('.fses') else session_file
+s = fft_latency.TimedPort(fft_session.open_port(port, 9600, record=record))
 
-print "Sending values to board..."
+caps = fft_protocol.query_capabilities(s)
+if SAMPLES not in caps['plans']:
+    print "Board supports sizes " + str(caps['plans']) + ", not " + str(SAMPLES)
+    s.close()
+    sys.exit(1)
+if len(values) < SAMPLES:
+    print input_file + " only has " + str(len(values)) + " values"
+    s.close()
+    sys.exit(1)
 
-#Write
-for x in range(SAMPLES):
-    num = int(values[x][0])
+fft_protocol.select_size(s, SAMPLES)
+fft_protocol.set_sample_freq(s, fs)
 
-    #Turn into signed number
-    if (num <0):
-        num = num + 2**16
+print "Sending values to board..."
 
-    #Split into bytes
-    s.write(chr(num % 256))
-    s.write(chr(num / 256))
-    
-    #print 'Message sent ' + str(num)
+#Write
+fft_protocol.send_frame(s, values[:SAMPLES])
 
 print "Reading messages from board.."
 
 #Read messages
-magnitude = []
-    
-n=0
-for n in range(SAMPLES/2):
-
-    msg = s.read(2)
-
-    #Turn signed 16 bit number back into python integer
-    receivedMsg = int(msg[0].encode('hex'), 16) + 256*int(msg[1].encode('hex'), 16)
-
-    #Signed -> Normal
-    if (receivedMsg > (2**15)-1):
-        receivedMsg = receivedMsg - (2**16)
-
-    #print str(receivedMsg)
-
-    magnitude.append(receivedMsg)
+#With DIFF_OUTPUT the board sends a keyframe first after reset, so reset it
+#before running
+caps['samples'] = SAMPLES
+received = time.time()
+magnitude = fft_protocol.read_any_spectrum(s, caps)
+
+#Where the time went between the first byte out and the last byte back
+latency = fft_latency.Recorder()
+latency.record(s.frame_times())
+print latency.summary()
+latency.dump(latency_file)
+
+#Report how long the board took
+try:
+    telemetry = fft_protocol.query_telemetry(s)
+    us = 1e6 / telemetry['mclk_hz']
+    print "FFT took %d cycles (%.0f us), magnitudes %d cycles (%.0f us)" % (
+        telemetry['fft_cycles'], telemetry['fft_cycles'] * us,
+        telemetry['magnitude_cycles'], telemetry['magnitude_cycles'] * us)
+    if 'stack_peak' in telemetry:
+        print "Stack peak %d of %d bytes, plan %d bytes (sram_budget.py for more)" % (
+            telemetry['stack_peak'], telemetry['stack_size'], telemetry['plan_bytes'])
+except fft_protocol.DeviceError:
+    print "Board does not report telemetry"
 
 #Close serial channel
 s.close()
@@ -89,6 +145,28 @@ with open(output_file, 'wb') as fout:
 
     fout.close()
 
+#Keep the spectrum with those of earlier runs of the same size
+if caps['flags'] & (fft_protocol.CAP_BFP_OUTPUT | fft_protocol.CAP_FLOAT_OUTPUT):
+    value_type = fft_store.FLOAT32
+else:
+    value_type = fft_store.INT16
+try:
+    store = fft_store.Writer(store_file, SAMPLES, fs, SAMPLES/2, value_type=value_type)
+    store.append(magnitude, int(received * 1e9))
+    store.close()
+    print "Appended to " + store_file
+except ValueError as e:
+    print "Not stored: " + str(e)
+
+if ring_name is not None:
+    #The viewer reads the ring at its own pace; keep it up until it has
+    ring = fft_ring.Writer(ring_name, SAMPLES, fs, SAMPLES/2, value_type=value_type)
+    ring.publish(magnitude, int(received * 1e9))
+    print "Published to ring " + ring_name + ", press enter to remove it"
+    raw_input()
+    ring.close()
+    sys.exit(0)
+
 #Set up x axes variables for plotting
 time = []
 
@@ -105,7 +183,7 @@ fig = plt.figure(1)
 
 #Input signal
 plt.subplot(211)
-plt.plot(time, values, linewidth=0.5)
+plt.plot(time, values[:SAMPLES], linewidth=0.5)
 plt.ylabel('Acceleration (ms-2)')
 plt.xlabel('Time (s)')
 plt.title('Time based data')
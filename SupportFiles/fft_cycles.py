@@ -0,0 +1,178 @@
+'''
+FFT and magnitude cycles and energy per frame of a board at every plan
+size, to compare FFT engines and builds: the kernels run from flash or
+from SRAM (RAMFUNC_KERNELS), at 12 or 48 MHz (MCLK_48MHZ), spinning or
+sleeping between frames (LOW_POWER).
+
+It runs every engine the board has built in, kissFFT and IQmath cFFT,
+one after the other on the same frames over the same link. For each it
+sends FRAMES random frames at each size the engine offers and keeps the
+median of the cycles the telemetry reports for each, then appends one
+row per size to the results file, labelled with the engine, where the
+kernels ran (the capability flags say) and MCLK. Every size that has
+more than one row is then compared against kissFFT from flash at the
+same clock.
+
+Cycles alone hide the flash wait states that grow with the clock, so
+the same build at 12 MHz against 48 MHz shows their cost, and flash
+against SRAM at 48 MHz what running from SRAM wins back.
+
+Energy per frame is estimated from the telemetry and the frame period
+the host sees: the FFT and magnitudes awake at the compute clock, the
+wait_cycles awake at the idle clock, and the rest of the period asleep
+in LPM0 (none of it without LOW_POWER, where the core never sleeps).
+Currents are rough LDO mode figures for the MSP432P401R at 3 V, below;
+put measured ones in for numbers to rely on. compute_uj is the FFT and
+magnitudes alone, energy_uj the whole frame period.
+
+Usage: fft_cycles.py [port] [results file] [frames]
+results default to fft_cycles.csv, 20 frames a size.
+'''
+
+import csv
+import os
+import random
+import sys
+import time
+import fft_protocol
+import fft_session
+
+FRAMES = 20
+
+#Supply and currents for the energy estimate
+VOLTS = 3.0
+ACTIVE_UA_PER_MHZ = 100         #active mode, per MHz of MCLK
+LPM0_UA = 800                   #LPM0 with the DCO and SMCLK running for the UART
+
+FIELDS = ['engine', 'label', 'mclk_hz', 'samples', 'fft_cycles', 'magnitude_cycles',
+          'compute_uj', 'energy_uj']
+
+
+def median(values):
+    values = sorted(values)
+    return values[len(values) / 2]
+
+
+def energy(t, period):
+    '''(compute, frame) energy in uJ from a frame's telemetry and period in s'''
+    amps = lambda hz: ACTIVE_UA_PER_MHZ * hz / 1e12
+    compute = float(t['fft_cycles'] + t['magnitude_cycles']) / t['mclk_hz']
+    awake = float(t.get('wait_cycles', 0)) / t.get('idle_mclk_hz', t['mclk_hz'])
+    asleep = max(0.0, period - compute - awake)
+    compute_j = VOLTS * amps(t['mclk_hz']) * compute
+    frame_j = compute_j + VOLTS * (amps(t.get('idle_mclk_hz', t['mclk_hz'])) * awake +
+                                   LPM0_UA / 1e6 * asleep)
+    return compute_j * 1e6, frame_j * 1e6
+
+
+def measure(port, frames):
+    '''(label, mclk, [(engine, size, fft cycles, magnitude cycles, compute uJ, frame uJ)])'''
+    s = fft_session.open_port(port, 9600)
+    caps = fft_protocol.query_capabilities(s)
+    label = 'sram' if caps['flags'] & fft_protocol.CAP_RAMFUNC_KERNELS else 'flash'
+    if caps['flags'] & fft_protocol.CAP_LOW_POWER:
+        label += '-lp'
+    telemetry = fft_protocol.query_telemetry(s)
+    first = telemetry.get('engine', 0)
+    rows = []
+    mclk = None
+    #An engine can only be selected at a size it does; all do the smallest
+    for engine in fft_protocol.built_engines(telemetry):
+        if 'engine' in telemetry:
+            fft_protocol.select_size(s, min(caps['plans']))
+            fft_protocol.select_engine(s, engine)
+        mclk = measure_engine(s, fft_protocol.engine_name(engine), frames, rows)
+    if 'engine' in telemetry:
+        fft_protocol.select_size(s, min(caps['plans']))
+        fft_protocol.select_engine(s, first)
+    fft_protocol.select_size(s, caps['samples'])
+    s.close()
+    return label, mclk, rows
+
+
+def measure_engine(s, name, frames, rows):
+    '''Append the engine's rows at every size it offers, return MCLK'''
+    caps = fft_protocol.query_capabilities(s)
+    mclk = None
+    for samples in sorted(caps['plans']):
+        fft_protocol.select_size(s, samples)
+        frame_caps = dict(caps)
+        frame_caps['samples'] = samples
+        fft, magnitude, compute_uj, frame_uj = [], [], [], []
+        last = None
+        for n in range(frames):
+            sent = time.time()
+            fft_protocol.send_frame(s, [random.randint(-32768, 32767) for i in range(samples)])
+            fft_protocol.read_any_spectrum(s, frame_caps)
+            t = fft_protocol.query_telemetry(s)
+            fft.append(t['fft_cycles'])
+            magnitude.append(t['magnitude_cycles'])
+            mclk = t['mclk_hz']
+            #wait_cycles cover the time since the previous frame, so does the period
+            if last is not None:
+                c, f = energy(t, sent - last)
+                compute_uj.append(c)
+                frame_uj.append(f)
+            last = sent
+        rows.append((name, samples, median(fft), median(magnitude),
+                     median(compute_uj) if compute_uj else 0.0,
+                     median(frame_uj) if frame_uj else 0.0))
+    return mclk
+
+
+def read_results(path):
+    if not os.path.exists(path):
+        return []
+    with open(path, 'rb') as f:
+        convert = {'engine': str, 'label': str, 'compute_uj': float, 'energy_uj': float}
+        #Files from before the engines were added only hold kissFFT
+        return [dict((k, convert.get(k, int)(r.get(k, 'kissFFT'))) for k in FIELDS)
+                for r in csv.DictReader(f)]
+
+
+def append_results(path, label, mclk, rows):
+    new = not os.path.exists(path)
+    with open(path, 'ab') as f:
+        writer = csv.writer(f)
+        if new:
+            writer.writerow(FIELDS)
+        for engine, samples, fft, magnitude, compute_uj, energy_uj in rows:
+            writer.writerow([engine, label, mclk, samples, fft, magnitude,
+                             '%.3f' % compute_uj, '%.3f' % energy_uj])
+
+
+def compare(results):
+    '''Latest cycles per engine, label, clock and size, against kissFFT from flash'''
+    latest = {}
+    for r in results:
+        latest[(r['engine'], r['label'], r['mclk_hz'], r['samples'])] = r
+    print "%-8s %-8s %5s %6s %10s %8s %10s %8s %10s %10s" % (
+        'engine', 'label', 'MHz', 'size', 'fft', 'us', 'magnitude', 'vs flash',
+        'compute uJ', 'frame uJ')
+    for key in sorted(latest, key=lambda k: (k[3], k[2], k[0], k[1])):
+        engine, label, mclk, samples = key
+        r = latest[key]
+        base = latest.get(('kissFFT', 'flash', mclk, samples))
+        gain = ''
+        if base is not None and base is not r:
+            gain = '%.2fx' % (float(base['fft_cycles'] + base['magnitude_cycles']) /
+                              (r['fft_cycles'] + r['magnitude_cycles']))
+        print "%-8s %-8s %5d %6d %10d %8.0f %10d %8s %10.2f %10.2f" % (
+            engine, label, mclk / 1000000, samples, r['fft_cycles'], r['fft_cycles'] * 1e6 / mclk,
+            r['magnitude_cycles'], gain, r['compute_uj'], r['energy_uj'])
+
+
+def main(argv):
+    port = argv[0] if len(argv) > 0 else 'COM4'
+    path = argv[1] if len(argv) > 1 else 'fft_cycles.csv'
+    frames = int(argv[2]) if len(argv) > 2 else FRAMES
+
+    label, mclk, rows = measure(port, frames)
+    print "%s build at %d MHz, %d frames a size" % (label, mclk / 1000000, frames)
+    append_results(path, label, mclk, rows)
+    compare(read_results(path))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))
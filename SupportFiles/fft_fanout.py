@@ -0,0 +1,320 @@
+'''
+Spread a stream of frames over several boards at once.
+
+Each board answers one frame at a time, and at 9600 baud a 1024 point
+frame spends most of a second on the wire, so a rig of N boards gets
+through up to N times as many frames. Every board has a queue of frames
+and a thread that sends them and reads the spectra back. A new frame
+goes to the board with the fewest frames queued or in flight, so a
+slower board simply gets fewer; no more than depth frames wait for any
+board. Spectra come back out of order and are handed on in frame order.
+
+A board that stops answering is dropped and its frames are given to the
+others.
+
+Every frame's round trip is timed and split as fft_latency.py describes;
+the histograms of each board and of the whole rig are printed at the end
+and, with -l, written as JSON every 5 seconds while the run goes on.
+
+With -r every board's session is logged to prefix<board>.fses, and a
+port can be such a log instead of a board (fft_session.py), so a run can
+be replayed to time the host side alone.
+
+Usage: fft_fanout.py [-n samples] [-f fs] [-b baud] [-d depth] [-o store]
+                     [-m ring] [-l latency.json] [-r prefix]
+                     input port [port ...]
+input is a CSV of samples, cut into frames of samples, or a capture
+written by host/csv2fcap. The spectra are appended to the spectrum store
+(fft_output.fspec by default), and with -m also published in a shared
+memory ring for fft_viewer.py. host/fft_sim gives a board on a pty for
+trying this without hardware.
+'''
+
+import sys
+import time
+import threading
+import Queue
+import fft_protocol
+import fft_capture
+import fft_store
+import fft_ring
+import fft_latency
+import fft_session
+
+#Seconds between latency dumps
+DUMP_INTERVAL = 5
+
+
+class Device(object):
+    '''One board and the thread that talks to it'''
+
+    def __init__(self, fanout, port, baud, samples, fs, record=None):
+        self.fanout = fanout
+        self.port = port
+        #Long enough for a whole frame and spectrum on the wire
+        self.serial = fft_latency.TimedPort(
+            fft_session.open_port(port, baud, timeout=2 + 40.0 * samples / baud,
+                                  record=record))
+        self.caps = fft_protocol.query_capabilities(self.serial)
+        if samples not in self.caps['plans']:
+            raise fft_protocol.DeviceError(port + ' does not support ' + str(samples) + ' points')
+        fft_protocol.select_size(self.serial, samples)
+        fft_protocol.set_sample_freq(self.serial, fs)
+        self.caps['samples'] = samples
+
+        self.queue = Queue.Queue()
+        self.pending = 0                #queued or in flight, under the fanout lock
+        self.failed = False
+        self.frames = 0
+        self.busy = 0.0
+        self.previous = None            #last spectrum, for DIFF_OUTPUT boards
+        self.latency = fft_latency.Recorder()   #under the fanout lock
+        self.thread = threading.Thread(target=self.run)
+        self.thread.daemon = True
+        self.thread.start()
+
+    def run(self):
+        while True:
+            item = self.queue.get()
+            if item is None:
+                break
+            index, values = item
+            start = time.time()
+            try:
+                fft_protocol.send_frame(self.serial, values)
+                spectrum = fft_protocol.read_any_spectrum(self.serial, self.caps, self.previous)
+            except Exception as e:
+                self.fanout.failed(self, item, e)
+                break
+            self.busy += time.time() - start
+            self.frames += 1
+            self.previous = spectrum
+            self.fanout.done(self, index, spectrum, self.serial.frame_times())
+        self.serial.close()
+
+
+class FanOut(object):
+
+    def __init__(self, ports, samples, fs, baud=9600, depth=2, record=None):
+        self.lock = threading.Condition()
+        self.depth = depth
+        self.submitted = 0
+        self.next_out = 0
+        self.results = {}               #spectra that arrived before earlier ones
+        self.error = None
+        self.devices = [Device(self, port, baud, samples, fs,
+                               None if record is None else '%s%d.fses' % (record, i))
+                        for i, port in enumerate(ports)]
+        self.start = time.time()
+
+    def _pick(self):
+        '''The working board with the least to do, None if all are full'''
+        live = [d for d in self.devices if not d.failed]
+        if not live:
+            raise fft_protocol.DeviceError('no board left: ' + str(self.error))
+        best = min(live, key=lambda d: d.pending)
+        if best.pending >= self.depth:
+            return None
+        return best
+
+    def submit(self, values):
+        '''Queue the next frame, waiting while every board is full'''
+        with self.lock:
+            device = self._pick()
+            while device is None:
+                self.lock.wait()
+                device = self._pick()
+            device.pending += 1
+            device.queue.put((self.submitted, values))
+            self.submitted += 1
+
+    def done(self, device, index, spectrum, times):
+        with self.lock:
+            device.pending -= 1
+            device.latency.record(times)
+            self.results[index] = spectrum
+            self.lock.notify_all()
+
+    def failed(self, device, item, error):
+        '''Hand the frames of a board that stopped answering to the others'''
+        with self.lock:
+            device.failed = True
+            self.error = device.port + ': ' + str(error)
+            print >> sys.stderr, 'Dropping ' + self.error
+            items = [item]
+            while not device.queue.empty():
+                items.append(device.queue.get())
+            device.pending = 0
+            live = [d for d in self.devices if not d.failed]
+            for item in items:
+                if item is None or not live:
+                    continue
+                target = min(live, key=lambda d: d.pending)
+                target.pending += 1
+                target.queue.put(item)
+            self.lock.notify_all()
+
+    def ready(self, wait=False):
+        '''
+        Spectra that can be handed on in frame order, with their frame
+        numbers. With wait, block until every submitted frame is back.
+        '''
+        out = []
+        with self.lock:
+            while True:
+                while self.next_out in self.results:
+                    out.append((self.next_out, self.results.pop(self.next_out)))
+                    self.next_out += 1
+                if not wait or self.next_out == self.submitted:
+                    break
+                if not [d for d in self.devices if not d.failed]:
+                    raise fft_protocol.DeviceError('no board left: ' + str(self.error))
+                self.lock.wait(1.0)
+        return out
+
+    def close(self):
+        for device in self.devices:
+            if not device.failed:
+                device.queue.put(None)
+        for device in self.devices:
+            device.thread.join()
+
+    def latency(self):
+        '''Latency histograms of the whole rig, and of each board by port'''
+        with self.lock:
+            total = fft_latency.Recorder()
+            devices = {}
+            for d in self.devices:
+                total.merge(d.latency)
+                devices[d.port] = d.latency.to_dict()
+        return total, devices
+
+    def dump_latency(self, path):
+        total, devices = self.latency()
+        total.dump(path, devices=devices)
+
+    def stats(self):
+        '''Frames per second overall and the share of time each board was busy'''
+        elapsed = time.time() - self.start
+        frames = sum(d.frames for d in self.devices)
+        return {'elapsed': elapsed,
+                'frames': frames,
+                'frames_per_s': frames / elapsed if elapsed > 0 else 0.0,
+                'devices': [{'port': d.port,
+                             'frames': d.frames,
+                             'utilization': d.busy / elapsed if elapsed > 0 else 0.0,
+                             'failed': d.failed} for d in self.devices]}
+
+
+def read_frames(input_file, samples, fs):
+    '''Frames of samples values, their start times in ns, and the sample rate'''
+    if input_file.endswith('.fcap'):
+        capture = fft_capture.Capture(input_file)
+        if capture.samples != samples:
+            raise ValueError(input_file + ' has frames of ' + str(capture.samples))
+        frames = [[int(v) for v in capture.frame(i)] for i in range(len(capture))]
+        times = [capture.time(i) for i in range(len(capture))]
+        fs = capture.sample_rate
+        capture.close()
+        return frames, times, fs
+
+    #CSV frames are back to back in time
+    with open(input_file, 'rb') as f:
+        values = [int(row.split(',')[0]) for row in f if row.strip()]
+    frames = [values[i:i + samples] for i in range(0, len(values) - samples + 1, samples)]
+    times = [i * samples * 1000000000 / fs for i in range(len(frames))]
+    return frames, times, fs
+
+
+def main(argv):
+    samples = 1024
+    fs = 8192
+    baud = 9600
+    depth = 2
+    store_file = 'fft_output.fspec'
+    ring_name = None
+    latency_file = None
+    record = None
+
+    while len(argv) > 2 and argv[0] in ('-n', '-f', '-b', '-d', '-o', '-m', '-l', '-r'):
+        option, value = argv[0], argv[1]
+        argv = argv[2:]
+        if option == '-n':
+            samples = int(value)
+        elif option == '-f':
+            fs = int(value)
+        elif option == '-b':
+            baud = int(value)
+        elif option == '-d':
+            depth = int(value)
+        elif option == '-m':
+            ring_name = value
+        elif option == '-l':
+            latency_file = value
+        elif option == '-r':
+            record = value
+        else:
+            store_file = value
+    if len(argv) < 2:
+        print __doc__
+        return 1
+
+    frames, times, fs = read_frames(argv[0], samples, fs)
+    if not frames:
+        print argv[0] + ' has no complete frame of ' + str(samples) + ' samples'
+        return 1
+
+    fanout = FanOut(argv[1:], samples, fs, baud, depth, record)
+    flags = fanout.devices[0].caps['flags']
+    if flags & (fft_protocol.CAP_BFP_OUTPUT | fft_protocol.CAP_FLOAT_OUTPUT):
+        value_type = fft_store.FLOAT32
+    else:
+        value_type = fft_store.INT16
+    store = fft_store.Writer(store_file, samples, fs, samples / 2, value_type=value_type)
+    ring = None
+
+    def keep(index, spectrum):
+        store.append(spectrum, times[index])
+        if ring is not None:
+            ring.publish(spectrum, times[index])
+
+    #Whatever stops the run, the spectra kept so far reach the store
+    try:
+        if ring_name is not None:
+            ring = fft_ring.Writer(ring_name, samples, fs, samples / 2, value_type=value_type)
+        print "Sending %d frames to %d boards" % (len(frames), len(fanout.devices))
+        dumped = time.time()
+        for values in frames:
+            fanout.submit(values)
+            for index, spectrum in fanout.ready():
+                keep(index, spectrum)
+            if latency_file is not None and time.time() - dumped >= DUMP_INTERVAL:
+                fanout.dump_latency(latency_file)
+                dumped = time.time()
+        for index, spectrum in fanout.ready(wait=True):
+            keep(index, spectrum)
+    finally:
+        fanout.close()
+        store.close()
+        if ring is not None:
+            ring.close()
+
+    stats = fanout.stats()
+    print "%d frames in %.2f s, %.2f frames/s" % (stats['frames'], stats['elapsed'],
+                                                 stats['frames_per_s'])
+    for d in stats['devices']:
+        print "  %-20s %6d frames  %5.1f%% busy%s" % (d['port'], d['frames'],
+                                                   100 * d['utilization'],
+                                                   '  failed' if d['failed'] else '')
+    print "Spectra appended to " + store_file
+
+    total, devices = fanout.latency()
+    print total.summary()
+    if latency_file is not None:
+        fanout.dump_latency(latency_file)
+        print "Latency histograms written to " + latency_file
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))
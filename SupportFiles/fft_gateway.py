@@ -0,0 +1,69 @@
+'''
+Client for host/fft_gateway, which owns the serial links and shares every
+spectrum with all its clients.
+
+  gw = fft_gateway.Gateway('localhost:5555')   #or the path of its Unix socket
+  gw.send_frame(0, samples)                     #frame for board 0
+  spectrum = gw.read()
+
+read() returns a dict with the board, its frame size, seq, the time the
+gateway had the spectrum in ns and the magnitudes. seq counts the
+spectra of each board, so a gap means the gateway dropped spectra for
+this client because it fell behind; read() adds them up in dropped.
+'''
+
+import socket
+import struct
+from array import array
+
+#type, board, value type, samples, bins, seq, time
+MESSAGE = struct.Struct('<cBBxHHI4xQ')
+
+INT16 = 0
+FLOAT32 = 1
+
+
+class Gateway(object):
+
+    def __init__(self, address):
+        if ':' in address:
+            host, port = address.rsplit(':', 1)
+            self.sock = socket.create_connection((host, int(port)))
+        else:
+            self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+            self.sock.connect(address)
+        self.last_seq = {}
+        self.dropped = 0
+
+    def _read_exact(self, length):
+        data = []
+        while length:
+            chunk = self.sock.recv(length)
+            if not chunk:
+                raise EOFError('gateway closed the connection')
+            data.append(chunk)
+            length -= len(chunk)
+        return ''.join(data)
+
+    def send_frame(self, board, values):
+        '''Queue a frame of signed 16 bit samples for a board'''
+        samples = array('h', values)
+        self.sock.sendall(struct.pack('<cBH', 'F', board, len(samples)) + samples.tostring())
+
+    def read(self):
+        '''Wait for the next spectrum of any board'''
+        (kind, board, value_type, samples, bins, seq,
+         time_ns) = MESSAGE.unpack(self._read_exact(MESSAGE.size))
+        if kind != 'S':
+            raise ValueError('Unknown message ' + repr(kind))
+        values = array('h' if value_type == INT16 else 'f')
+        values.fromstring(self._read_exact(bins * values.itemsize))
+
+        if board in self.last_seq:
+            self.dropped += (seq - self.last_seq[board] - 1) % 2**32
+        self.last_seq[board] = seq
+        return {'board': board, 'samples': samples, 'seq': seq,
+                'time_ns': time_ns, 'magnitude': values}
+
+    def close(self):
+        self.sock.close()
@@ -0,0 +1,209 @@
+'''
+Latency of each frame's round trip to a board, split into where the time
+goes, kept in log bucketed histograms so tails show up.
+
+Wrap the serial port in a TimedPort and every frame gets four times: the
+first and last byte sent and the first and last byte received. From
+those a Recorder keeps
+
+  wire_in    first to last byte sent, the frame on the wire
+  compute    last byte sent to first byte received, the board's FFT
+  wire_out   first to last byte received, the spectrum on the wire
+  latency    last byte sent to last byte received, what the caller waits
+  round_trip first byte sent to last byte received
+
+  port = fft_latency.TimedPort(serial.Serial(port, 9600))
+  recorder = fft_latency.Recorder()
+  fft_protocol.send_frame(port, values)
+  spectrum = fft_protocol.read_any_spectrum(port, caps)
+  recorder.record(port.frame_times())
+  recorder.dump('latency.json')
+
+The last byte counts as sent once the driver has drained it, so the
+split is only as good as the OS serial driver and time.time(); on a USB
+serial bridge the bridge's own buffering lands in wire_in and wire_out.
+
+Histograms follow HdrHistogram: each power of two is cut into 2^SUB_BITS
+linear buckets, so every value is kept to within 1/2^SUB_BITS of itself
+from a microsecond to hours, in a few hundred buckets at most.
+'''
+
+import json
+import os
+import time
+
+#Buckets per power of two, as a power of two: 32 keeps values to ~3%
+SUB_BITS = 5
+SUB_COUNT = 1 << SUB_BITS
+
+PERCENTILES = (50, 90, 99, 99.9)
+
+SPLITS = ('wire_in', 'compute', 'wire_out', 'latency', 'round_trip')
+
+
+def bucket_of(value):
+    '''Index of the bucket holding a value in ns'''
+    if value < SUB_COUNT:
+        return value
+    shift = value.bit_length() - SUB_BITS - 1
+    return (shift + 1) * SUB_COUNT + (value >> shift) - SUB_COUNT
+
+
+def bucket_range(index):
+    '''Lowest and highest value of a bucket'''
+    if index < SUB_COUNT:
+        return index, index
+    shift = index / SUB_COUNT - 1
+    low = (index % SUB_COUNT + SUB_COUNT) << shift
+    return low, low + (1 << shift) - 1
+
+
+class Histogram(object):
+    '''Counts of values in ns, in log spaced buckets'''
+
+    def __init__(self):
+        self.buckets = {}
+        self.count = 0
+        self.total = 0
+        self.min = None
+        self.max = None
+
+    def record(self, value):
+        value = max(0, int(value))
+        index = bucket_of(value)
+        self.buckets[index] = self.buckets.get(index, 0) + 1
+        self.count += 1
+        self.total += value
+        if self.min is None or value < self.min:
+            self.min = value
+        if self.max is None or value > self.max:
+            self.max = value
+
+    def merge(self, other):
+        for index, count in other.buckets.items():
+            self.buckets[index] = self.buckets.get(index, 0) + count
+        self.count += other.count
+        self.total += other.total
+        for value in (other.min, other.max):
+            if value is not None:
+                self.min = value if self.min is None else min(self.min, value)
+                self.max = value if self.max is None else max(self.max, value)
+
+    def percentile(self, p):
+        '''Highest value of the bucket where p percent of the counts are reached'''
+        if self.count == 0:
+            return None
+        wanted = max(1, int(self.count * p / 100.0 + 0.5))
+        seen = 0
+        for index in sorted(self.buckets):
+            seen += self.buckets[index]
+            if seen >= wanted:
+                return min(bucket_range(index)[1], self.max)
+        return self.max
+
+    def to_dict(self):
+        '''Summary in us and the non empty buckets as [low ns, high ns, count]'''
+        us = lambda v: None if v is None else v / 1000.0
+        out = {'count': self.count,
+               'min_us': us(self.min),
+               'max_us': us(self.max),
+               'mean_us': us(self.total / self.count) if self.count else None}
+        for p in PERCENTILES:
+            out['p%s_us' % ('%g' % p).replace('.', '_')] = us(self.percentile(p))
+        out['buckets'] = [list(bucket_range(i)) + [self.buckets[i]]
+                          for i in sorted(self.buckets)]
+        return out
+
+
+class TimedPort(object):
+    '''
+    A serial port that notes when each frame went out and came back. A
+    write after a read starts a new frame; reads after a write belong to
+    its reply.
+    '''
+
+    def __init__(self, serial):
+        self.serial = serial
+        self.times = [None, None, None, None]
+        self.replying = True
+
+    def write(self, data):
+        if self.replying:
+            self.times = [time.time(), None, None, None]
+            self.replying = False
+        self.serial.write(data)
+        #Wait for the driver to put it on the wire
+        self.serial.flush()
+        self.times[1] = time.time()
+
+    def read(self, size=1):
+        if not self.replying:
+            self.replying = True
+            #Take the first byte on its own so its time is its own
+            first = self.serial.read(1)
+            self.times[2] = time.time()
+            if size > 1 and first:
+                first += self.serial.read(size - 1)
+            self.times[3] = time.time()
+            return first
+        data = self.serial.read(size)
+        self.times[3] = time.time()
+        return data
+
+    def frame_times(self):
+        '''First and last byte sent and received for the last exchange, in s'''
+        return tuple(self.times)
+
+    def close(self):
+        self.serial.close()
+
+    def __getattr__(self, name):
+        return getattr(self.serial, name)
+
+
+class Recorder(object):
+    '''One histogram per split of the round trip'''
+
+    def __init__(self):
+        self.histograms = dict((name, Histogram()) for name in SPLITS)
+        self.started = time.time()
+
+    def record(self, times):
+        '''Add a frame from the four times TimedPort.frame_times gives'''
+        first_sent, last_sent, first_received, last_received = times
+        if None in times:
+            return
+        ns = lambda a, b: (b - a) * 1e9
+        self.histograms['wire_in'].record(ns(first_sent, last_sent))
+        self.histograms['compute'].record(ns(last_sent, first_received))
+        self.histograms['wire_out'].record(ns(first_received, last_received))
+        self.histograms['latency'].record(ns(last_sent, last_received))
+        self.histograms['round_trip'].record(ns(first_sent, last_received))
+
+    def merge(self, other):
+        for name in SPLITS:
+            self.histograms[name].merge(other.histograms[name])
+        self.started = min(self.started, other.started)
+
+    def to_dict(self, **extra):
+        out = {'time': time.time(), 'since': self.started}
+        out.update(extra)
+        for name in SPLITS:
+            out[name] = self.histograms[name].to_dict()
+        return out
+
+    def dump(self, path, **extra):
+        '''Write the histograms as JSON, replacing the file in one step'''
+        with open(path + '.tmp', 'w') as f:
+            json.dump(self.to_dict(**extra), f, indent=1, sort_keys=True)
+        os.rename(path + '.tmp', path)
+
+    def summary(self):
+        '''One line per split: count, p50, p99 and max in ms'''
+        lines = []
+        for name in SPLITS:
+            h = self.histograms[name]
+            if h.count:
+                lines.append('%-10s %6d frames  p50 %8.2f ms  p99 %8.2f ms  max %8.2f ms' % (
+                    name, h.count, h.percentile(50) / 1e6, h.percentile(99) / 1e6, h.max / 1e6))
+        return '\n'.join(lines)
@@ -0,0 +1,227 @@
+'''
+Helpers for the serial protocol spoken by uart_FFT_kissFFT.
+
+Every message to the board starts with a command byte:
+
+  'F' + 2*N bytes  frame of N samples, answered with a spectrum
+  'N' + word       select FFT size, answered with 'A' + size
+  'S' + word       set sample frequency, answered with 'A' + frequency
+  'E' + byte       select FFT engine, answered with 'A' + engine
+  '?'              capabilities, answered with 'C' + details
+  'T'              telemetry, answered with 'T' + count + (tag, long)...
+  errors are answered with 'E' + code
+
+Words are 16 bit, least significant byte first. A spectrum is N/2
+magnitudes. When the board is built with DIFF_OUTPUT every spectrum
+starts with a type byte:
+
+  'K'  keyframe, N/2 magnitudes follow
+  'D'  delta, a run count then (start, length, magnitudes...) per run
+
+Delta frames only make sense against the previous spectrum, so the caller
+keeps the last decoded spectrum and passes it back in.
+
+When the board is built with BFP_OUTPUT every spectrum is instead
+
+  'B'  a signed exponent byte e, then N/2 unsigned magnitudes m
+
+where the DFT magnitude is m * 2^e. Dividing by N gives the same scale as
+a plain spectrum.
+
+A board built with the float engine sends N/2 little endian 32 bit floats
+instead of words, already on the plain scale.
+'''
+
+import struct
+
+PROTOCOL_VERSION = 1
+
+#Capability flags
+CAP_DIFF_OUTPUT = 0x01
+CAP_BFP_OUTPUT = 0x02
+CAP_FLOAT_OUTPUT = 0x04
+CAP_RAMFUNC_KERNELS = 0x08
+CAP_LOW_POWER = 0x10
+
+#Telemetry tags
+TELEMETRY = {1: 'fft_cycles', 2: 'magnitude_cycles', 3: 'mclk_hz', 4: 'overflows',
+             #Memory in bytes, see sram_budget.py
+             5: 'stack_peak', 6: 'stack_size', 7: 'sram_free', 8: 'plan_bytes',
+             9: 'plan_memory', 10: 'heap_size',
+             #Time awake between frames, for energy per frame, see fft_cycles.py
+             11: 'idle_mclk_hz', 12: 'wait_cycles',
+             #FFT engine in use, and a bit per engine built in
+             13: 'engine', 14: 'engines'}
+
+#FFT engines, as numbered in fftEngine/fft_engine.h. The capability plans
+#are those of the engine in use.
+ENGINES = {0: 'kissFFT', 1: 'cFFT', 2: 'inplace'}
+
+def engine_name(engine):
+    return ENGINES.get(engine, 'engine%d' % engine)
+
+#Boards built with CHECK_OVERFLOW also send a tag per radix and stage that
+#overflowed: OVERFLOW_TAG + radix * 8 + stage, see kiss_fft_overflows
+OVERFLOW_TAG = 0x40
+OVERFLOW_RADIXES = ['radix2', 'radix3', 'radix4', 'radix5', 'generic', 'real']
+
+def telemetry_name(tag):
+    if tag in TELEMETRY:
+        return TELEMETRY[tag]
+    if OVERFLOW_TAG <= tag < OVERFLOW_TAG + 8 * len(OVERFLOW_RADIXES):
+        radix, stage = divmod(tag - OVERFLOW_TAG, 8)
+        return 'overflows_%s_stage%d' % (OVERFLOW_RADIXES[radix], stage)
+    return tag
+
+ERRORS = {1: 'unknown command', 2: 'unsupported FFT size', 3: 'bad sample frequency',
+          4: 'unsupported FFT engine'}
+
+class DeviceError(Exception):
+    pass
+
+def read_word(s):
+    msg = s.read(2)
+    return ord(msg[0]) + 256*ord(msg[1])
+
+def read_signed(s):
+    word = read_word(s)
+
+    #Signed -> Normal
+    if (word > (2**15)-1):
+        word = word - (2**16)
+    return word
+
+def read_spectrum(s, bins):
+    '''Read a plain spectrum of bins magnitudes'''
+    return [read_signed(s) for n in range(bins)]
+
+def read_diff_spectrum(s, bins, previous):
+    '''
+    Read one frame sent with DIFF_OUTPUT and return the full spectrum.
+    previous is the spectrum returned for the last frame, or None.
+    '''
+    frame_type = s.read(1)
+
+    if frame_type == 'K':
+        return read_spectrum(s, bins)
+
+    if frame_type != 'D':
+        raise ValueError('Unknown frame type ' + repr(frame_type))
+    if previous is None:
+        raise ValueError('Delta frame received before any keyframe')
+
+    magnitude = list(previous)
+    runs = read_word(s)
+    for r in range(runs):
+        start = read_word(s)
+        length = read_word(s)
+        for n in range(start, start + length):
+            magnitude[n] = read_signed(s)
+    return magnitude
+
+def read_bfp_spectrum(s, bins, samples):
+    '''
+    Read one frame sent with BFP_OUTPUT and return the magnitudes on the
+    plain spectrum scale, as floats since they keep bits below one LSB.
+    '''
+    frame_type = s.read(1)
+    if frame_type != 'B':
+        raise ValueError('Unknown frame type ' + repr(frame_type))
+
+    exponent = ord(s.read(1))
+    if (exponent > 127):
+        exponent = exponent - 256
+    scale = 2.0**exponent / samples
+    return [read_word(s) * scale for n in range(bins)]
+
+def read_float_spectrum(s, bins):
+    '''Read a spectrum of bins floats sent by the float engine'''
+    return list(struct.unpack('<%df' % bins, s.read(4*bins)))
+
+def read_any_spectrum(s, caps, previous=None):
+    '''Read one spectrum in whatever format the capabilities announce'''
+    bins = caps['samples']/2
+    if caps['flags'] & CAP_DIFF_OUTPUT:
+        return read_diff_spectrum(s, bins, previous)
+    if caps['flags'] & CAP_BFP_OUTPUT:
+        return read_bfp_spectrum(s, bins, caps['samples'])
+    if caps['flags'] & CAP_FLOAT_OUTPUT:
+        return read_float_spectrum(s, bins)
+    return read_spectrum(s, bins)
+
+def read_long(s):
+    low = read_word(s)
+    return low + 65536*read_word(s)
+
+def write_word(s, word):
+    s.write(chr(word % 256) + chr(word / 256))
+
+def read_reply(s, expected):
+    '''Read the reply type byte, raising DeviceError for an error reply'''
+    reply = s.read(1)
+    if reply == 'E':
+        code = ord(s.read(1))
+        raise DeviceError(ERRORS.get(code, 'error ' + str(code)))
+    if reply != expected:
+        raise DeviceError('Unexpected reply ' + repr(reply))
+
+def query_capabilities(s):
+    '''Ask the board what it supports and how it is currently set up'''
+    s.write('?')
+    read_reply(s, 'C')
+
+    caps = {}
+    caps['version'] = ord(s.read(1))
+    caps['flags'] = ord(s.read(1))
+    caps['samples'] = read_word(s)
+    caps['sample_freq'] = read_word(s)
+    caps['max_sample_freq'] = read_word(s)
+    count = ord(s.read(1))
+    caps['plans'] = [read_word(s) for n in range(count)]
+    return caps
+
+def query_telemetry(s):
+    '''Read the board's counters, keyed by the names telemetry_name gives'''
+    s.write('T')
+    read_reply(s, 'T')
+
+    values = {}
+    count = ord(s.read(1))
+    for n in range(count):
+        tag = ord(s.read(1))
+        values[telemetry_name(tag)] = read_long(s)
+    return values
+
+def select_size(s, samples):
+    '''Select the FFT size, which must be one of the capability plans'''
+    s.write('N')
+    write_word(s, samples)
+    read_reply(s, 'A')
+    return read_word(s)
+
+def select_engine(s, engine):
+    '''Select the FFT engine, keeping the size, which it must support'''
+    s.write('E' + chr(engine))
+    read_reply(s, 'A')
+    return ord(s.read(1))
+
+def built_engines(telemetry):
+    '''Engines a board has, from its telemetry; older boards only kissFFT'''
+    mask = telemetry.get('engines', 1)
+    return [e for e in range(8) if mask & (1 << e)]
+
+def set_sample_freq(s, fs):
+    s.write('S')
+    write_word(s, fs)
+    read_reply(s, 'A')
+    return read_word(s)
+
+def send_frame(s, values):
+    '''Send one frame of signed 16 bit samples'''
+    data = ['F']
+    for num in values:
+        #Turn into signed number
+        if (num < 0):
+            num = num + 2**16
+        data.append(chr(num % 256) + chr(num / 256))
+    s.write(''.join(data))
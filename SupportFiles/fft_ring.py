@@ -0,0 +1,133 @@
+'''
+Shared memory ring of spectra between an acquisition process and any
+number of viewers, laid out as described in host/fft_ring.h.
+
+The writer never waits for a reader: spectrum n goes to slot n % slots
+whether or not anyone has read what was there. Each slot carries a
+sequence number, odd while it is being written and 2n+2 once spectrum n
+is complete; a reader checks it before and after copying the values and
+gives up on the spectrum if it changed. Readers only read, so any number
+of them can come and go.
+
+  ring = fft_ring.Writer('fft_spectra', 1024, 8192, 512)
+  ring.publish(magnitude, time_ns)
+
+  ring = fft_ring.Reader('fft_spectra')
+  n, time_ns, source, magnitude = ring.latest()
+'''
+
+import mmap
+import os
+import struct
+import time
+from array import array
+
+MAGIC = 'FRNG'
+VERSION = 1
+PAGE = 4096
+SLOT_HEADER = 32
+
+INT16 = 0
+FLOAT32 = 1
+VALUES = {INT16: ('h', 2), FLOAT32: ('f', 4)}
+
+#magic, version, header size, slots, slot stride, samples, bins,
+#value type, sample rate, epoch
+HEADER = struct.Struct('<4sHHIIIIB3xIQ24x')
+HEAD = struct.Struct('<Q')
+SLOT = struct.Struct('<QQI12x')
+
+SHM = '/dev/shm/'
+
+
+class Writer(object):
+
+    def __init__(self, name, samples, sample_rate, bins, value_type=INT16, slots=64):
+        self.path = SHM + name
+        self.slots = slots
+        self.bins = bins
+        self.code, size = VALUES[value_type]
+        self.stride = (SLOT_HEADER + bins * size + 63) / 64 * 64
+
+        #A new file, so readers of an old ring keep theirs until they reopen
+        if os.path.exists(self.path):
+            os.unlink(self.path)
+        f = open(self.path, 'w+b')
+        f.truncate(PAGE + slots * self.stride)
+        self.map = mmap.mmap(f.fileno(), PAGE + slots * self.stride)
+        f.close()
+        self.map[0:HEADER.size] = HEADER.pack(MAGIC, VERSION, HEADER.size, slots, self.stride,
+                                              samples, bins, value_type, sample_rate,
+                                              int(time.time() * 1e9))
+        self.head = 0
+
+    def publish(self, values, time_ns, source=0):
+        '''Add one spectrum of bins values'''
+        n = self.head
+        at = PAGE + (n % self.slots) * self.stride
+        data = array(self.code, values).tostring()
+        self.map[at:at + SLOT.size] = SLOT.pack(2*n + 1, time_ns, source)
+        self.map[at + SLOT_HEADER:at + SLOT_HEADER + len(data)] = data
+        self.map[at:at + 8] = HEAD.pack(2*n + 2)
+        self.head = n + 1
+        self.map[64:72] = HEAD.pack(self.head)
+
+    def close(self):
+        self.map.close()
+        os.unlink(self.path)
+
+
+class Reader(object):
+
+    def __init__(self, name):
+        self.path = SHM + name
+        f = open(self.path, 'rb')
+        try:
+            self.inode = os.fstat(f.fileno()).st_ino
+            self.map = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        finally:
+            f.close()
+        (magic, version, header_size, self.slots, self.stride, self.samples,
+         self.bins, self.value_type, self.sample_rate,
+         self.epoch) = HEADER.unpack_from(self.map, 0)
+        if magic != MAGIC or version != VERSION or header_size != HEADER.size \
+           or self.value_type not in VALUES:
+            self.map.close()
+            raise ValueError(self.path + ' is not a spectrum ring')
+        self.code, self.size = VALUES[self.value_type]
+
+    def replaced(self):
+        '''True if the writer has started a new ring under the same name'''
+        try:
+            return os.stat(self.path).st_ino != self.inode
+        except OSError:
+            return True
+
+    def head(self):
+        '''Number of spectra published so far'''
+        return HEAD.unpack_from(self.map, 64)[0]
+
+    def read(self, n):
+        '''(time_ns, source, values) of spectrum n, None if it was overwritten'''
+        at = PAGE + (n % self.slots) * self.stride
+        seq, time_ns, source = SLOT.unpack_from(self.map, at)
+        if seq != 2*n + 2:
+            return None
+        values = array(self.code)
+        values.fromstring(self.map[at + SLOT_HEADER:at + SLOT_HEADER + self.bins * self.size])
+        if HEAD.unpack_from(self.map, at)[0] != seq:
+            return None
+        return time_ns, source, values
+
+    def latest(self):
+        '''(n, time_ns, source, values) of the newest spectrum, None if none yet'''
+        head = self.head()
+        while head > 0:
+            got = self.read(head - 1)
+            if got is not None:
+                return (head - 1,) + got
+            head = self.head()
+        return None
+
+    def close(self):
+        self.map.close()
@@ -0,0 +1,287 @@
+'''
+Record a serial session with a board and replay it without the board.
+
+A RecordingPort wraps the serial port and logs every write to the board
+and every read from it, with the monotonic time it happened. A
+ReplayPort reads such a log and plays the board: what the host writes is
+checked against the recording, and the board's bytes come back as they
+did then, at the original pace, faster, or as fast as the host reads.
+A replay that leaves the recording, by writing other bytes than were
+recorded or reading past its end, raises ReplayError.
+Host side parsing, decoding and storage can so be timed on any Linux box
+against the exact bytes of a slow or corrupted run.
+
+open_port() does either, so a tool only has to call it instead of
+serial.Serial:
+
+  s = fft_session.open_port('/dev/ttyACM0', 9600, record='run.fses')
+  s = fft_session.open_port('run.fses')          #original pace
+  s = fft_session.open_port('run.fses@10')       #ten times faster
+  s = fft_session.open_port('run.fses@0')        #no waiting at all
+
+The log starts with a 20 byte header
+
+  magic 'FSES', version (uint16), header size (uint16), baud (uint32),
+  wall clock at the start of the session in ns (uint64)
+
+followed by one record per read or write:
+
+  direction  'H' host to board, 'D' board to host
+  varint     ns since the previous record (monotonic clock)
+  varint     length, then the bytes
+
+Varints are 7 bits per byte, least significant first, the top bit set on
+all but the last, so most records cost three or four bytes on top of
+their data.
+
+Usage: fft_session.py session.fses
+prints what the session holds.
+'''
+
+import ctypes
+import ctypes.util
+import struct
+import sys
+import time
+
+MAGIC = 'FSES'
+VERSION = 1
+HEADER = struct.Struct('<4sHHIQ')
+
+HOST = 'H'
+DEVICE = 'D'
+
+CLOCK_MONOTONIC = 1
+
+
+class timespec(ctypes.Structure):
+    _fields_ = [('tv_sec', ctypes.c_long), ('tv_nsec', ctypes.c_long)]
+
+
+try:
+    _librt = ctypes.CDLL(ctypes.util.find_library('rt') or 'librt.so.1', use_errno=True)
+    _clock_gettime = _librt.clock_gettime
+    _clock_gettime.argtypes = [ctypes.c_int, ctypes.POINTER(timespec)]
+except (OSError, AttributeError):
+    _clock_gettime = None
+
+
+def monotonic_ns():
+    '''CLOCK_MONOTONIC in ns, time.time() where it is not to be had'''
+    if _clock_gettime is None:
+        return int(time.time() * 1e9)
+    t = timespec()
+    _clock_gettime(CLOCK_MONOTONIC, ctypes.byref(t))
+    return t.tv_sec * 1000000000 + t.tv_nsec
+
+
+def write_varint(out, value):
+    data = []
+    while value >= 0x80:
+        data.append(chr(value & 0x7f | 0x80))
+        value >>= 7
+    data.append(chr(value))
+    out.write(''.join(data))
+
+
+def read_varint(f):
+    value = 0
+    shift = 0
+    while True:
+        c = f.read(1)
+        if not c:
+            raise EOFError('session log ends inside a record')
+        value |= (ord(c) & 0x7f) << shift
+        if ord(c) < 0x80:
+            return value
+        shift += 7
+
+
+def read_session(path):
+    '''(baud, start ns, records) with records as (direction, ns since start, data)'''
+    with open(path, 'rb') as f:
+        head = f.read(HEADER.size)
+        if len(head) < HEADER.size:
+            raise ValueError(path + ' is not a session log')
+        magic, version, header_size, baud, start = HEADER.unpack(head)
+        if magic != MAGIC or version != VERSION:
+            raise ValueError(path + ' is not a session log')
+        f.seek(header_size)
+
+        records = []
+        now = 0
+        while True:
+            direction = f.read(1)
+            if not direction:
+                break
+            if direction not in (HOST, DEVICE):
+                raise ValueError('%s: bad record at %d' % (path, f.tell() - 1))
+            now += read_varint(f)
+            data = f.read(read_varint(f))
+            records.append((direction, now, data))
+    return baud, start, records
+
+
+class RecordingPort(object):
+    '''A serial port that logs both directions of the session to a file'''
+
+    def __init__(self, serial, path):
+        self.serial = serial
+        self.log = open(path, 'wb')
+        self.log.write(HEADER.pack(MAGIC, VERSION, HEADER.size, serial.baudrate,
+                                   int(time.time() * 1e9)))
+        self.last = monotonic_ns()
+
+    def _record(self, direction, data):
+        now = monotonic_ns()
+        self.log.write(direction)
+        write_varint(self.log, now - self.last)
+        write_varint(self.log, len(data))
+        self.log.write(data)
+        self.last = now
+
+    def write(self, data):
+        self._record(HOST, data)
+        return self.serial.write(data)
+
+    def read(self, size=1):
+        data = self.serial.read(size)
+        if data:
+            self._record(DEVICE, data)
+        return data
+
+    def close(self):
+        self.log.close()
+        self.serial.close()
+
+    def __getattr__(self, name):
+        return getattr(self.serial, name)
+
+
+class ReplayError(Exception):
+    pass
+
+
+class ReplayPort(object):
+    '''
+    Plays the board of a recorded session. The board's bytes after each
+    host write are held back until as long after the write as they came
+    in the recording, divided by speed; speed 0 never waits. A read past
+    what the board sent before the host's next write returns short, as a
+    serial read would at its timeout. Writes that differ from the
+    recording and reads past its end raise ReplayError, since the
+    recorded answers no longer belong to what the host asked.
+    '''
+
+    def __init__(self, path, speed=1.0):
+        self.baudrate, self.started, self.records = read_session(path)
+        self.speed = float(speed)
+        self.index = 0                  #next record
+        self.offset = 0                 #bytes of it already used
+        self.anchor = (monotonic_ns(), 0)
+        self.written = 0                #host bytes matched so far
+        self.port = path
+
+    def _skip_device(self):
+        '''Drop board bytes the host never read, as the board would'''
+        while self.index < len(self.records) and self.records[self.index][0] == DEVICE:
+            self.index += 1
+            self.offset = 0
+
+    def write(self, data):
+        self._skip_device()
+        expected = []
+        needed = len(data)
+        while needed and self.index < len(self.records) \
+                and self.records[self.index][0] == HOST:
+            direction, at, chunk = self.records[self.index]
+            part = chunk[self.offset:self.offset + needed]
+            expected.append(part)
+            needed -= len(part)
+            self.offset += len(part)
+            self.anchor = (monotonic_ns(), at)
+            if self.offset == len(chunk):
+                self.index += 1
+                self.offset = 0
+        expected = ''.join(expected)
+        if expected != data:
+            at = next((k for k in range(min(len(expected), len(data)))
+                       if expected[k] != data[k]), min(len(expected), len(data)))
+            if at == len(expected):
+                raise ReplayError('%s: host byte %d is past the end of the recording'
+                                  % (self.port, self.written + at))
+            raise ReplayError('%s: host byte %d is %r, the recording has %r'
+                              % (self.port, self.written + at, data[at:at + 1],
+                                 expected[at]))
+        self.written += len(data)
+        return len(data)
+
+    def _wait(self, at):
+        if self.speed <= 0:
+            return
+        wall, logged = self.anchor
+        delay = (wall + (at - logged) / self.speed - monotonic_ns()) / 1e9
+        if delay > 0:
+            time.sleep(delay)
+
+    def read(self, size=1):
+        data = []
+        while size and self.index < len(self.records) \
+                and self.records[self.index][0] == DEVICE:
+            direction, at, chunk = self.records[self.index]
+            self._wait(at)
+            part = chunk[self.offset:self.offset + size]
+            data.append(part)
+            size -= len(part)
+            self.offset += len(part)
+            if self.offset == len(chunk):
+                self.index += 1
+                self.offset = 0
+        if size and self.index == len(self.records):
+            raise ReplayError('%s: read past the end of the recording' % self.port)
+        return ''.join(data)
+
+    def flush(self):
+        pass
+
+    def reset_input_buffer(self):
+        self._skip_device()
+
+    def close(self):
+        pass
+
+
+def open_port(port, baud=9600, timeout=None, record=None):
+    '''
+    A serial port, or the replay of a session log when port names one
+    (path.fses, or path.fses@speed). With record, the session on a real
+    port is logged to that file.
+    '''
+    path, _, speed = port.partition('@')
+    if path.endswith('.fses'):
+        return ReplayPort(path, float(speed) if speed else 1.0)
+    import serial
+    s = serial.Serial(port, baud, timeout=timeout)
+    if record is not None:
+        return RecordingPort(s, record)
+    return s
+
+
+def main(argv):
+    if len(argv) != 1:
+        print __doc__
+        return 1
+    baud, start, records = read_session(argv[0])
+    sent = sum(len(r[2]) for r in records if r[0] == HOST)
+    received = sum(len(r[2]) for r in records if r[0] == DEVICE)
+    length = records[-1][1] / 1e9 if records else 0.0
+    print "%s: %d baud, started %s" % (argv[0], baud,
+                                       time.strftime('%Y-%m-%d %H:%M:%S',
+                                                     time.localtime(start / 1e9)))
+    print "%d records over %.3f s, %d bytes sent, %d received" % (len(records), length,
+                                                                 sent, received)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,213 @@
+'''
+Spectrum stores (.fspec): spectra kept by bin in chunks, so the history
+of a few bins over a long run is read without touching the rest.
+
+The layout is described in host/fft_store.h: a one page header, then
+chunks of chunk_frames spectra, each holding chunk_frames uint64 start
+times in ns followed by one block of chunk_frames values per bin, padded
+to a page. host/fspec builds and queries the same files.
+
+  store = fft_store.Writer('fft_output.fspec', 1024, 8192, 512)
+  store.append(magnitude, time_ns)
+  store.close()
+
+  store = fft_store.Store('fft_output.fspec')
+  times, values = store.column(bin, start_ns, end_ns)
+  store.spectrum(i)
+
+Opening an existing store with Writer carries on after its last
+spectrum, so the host client can keep one store across runs.
+'''
+
+import mmap
+import os
+import struct
+from array import array
+
+MAGIC = 'FSPC'
+VERSION = 1
+PAGE = 4096
+
+#Value types
+INT16 = 0
+FLOAT32 = 1
+
+#array typecode and size of each value type
+VALUES = {INT16: ('h', 2), FLOAT32: ('f', 4)}
+
+#magic, version, header size, samples, sample rate, bins, chunk frames,
+#value type, chunk bytes, frame count, data offset
+HEADER = struct.Struct('<4sHHIIIIB3xIQQ16x')
+
+
+def _check(fields, path):
+    if fields[0] != MAGIC or fields[1] != VERSION or fields[2] != HEADER.size \
+       or fields[7] not in VALUES:
+        raise ValueError(path + ' is not a spectrum store')
+
+
+class Writer(object):
+
+    def __init__(self, path, samples, sample_rate, bins, chunk_frames=256,
+                 value_type=INT16):
+        if os.path.exists(path):
+            self.file = open(path, 'r+b')
+            fields = HEADER.unpack(self.file.read(HEADER.size))
+            _check(fields, path)
+            if (fields[3], fields[5]) != (samples, bins) or fields[7] != value_type:
+                self.file.close()
+                raise ValueError(path + ' holds spectra of another size or type')
+            if fields[4] != sample_rate:
+                self.file.close()
+                raise ValueError('%s holds spectra at %d Hz, not %d Hz'
+                                 % (path, fields[4], sample_rate))
+            (self.samples, self.sample_rate, self.bins, self.chunk_frames,
+             self.value_type, self.chunk_bytes, self.frame_count,
+             self.data_offset) = fields[3:]
+        else:
+            self.file = open(path, 'w+b')
+            self.samples = samples
+            self.sample_rate = sample_rate
+            self.bins = bins
+            self.chunk_frames = chunk_frames
+            self.value_type = value_type
+            size = VALUES[value_type][1]
+            used = chunk_frames * (8 + bins * size)
+            self.chunk_bytes = (used + PAGE - 1) / PAGE * PAGE
+            self.frame_count = 0
+            self.data_offset = PAGE
+            self._write_header()
+
+        self.chunk = self.frame_count / self.chunk_frames
+        self.fill = self.frame_count % self.chunk_frames
+        self._load_chunk()
+
+    def _write_header(self):
+        self.file.seek(0)
+        self.file.write(HEADER.pack(MAGIC, VERSION, HEADER.size, self.samples,
+                                    self.sample_rate, self.bins, self.chunk_frames,
+                                    self.value_type, self.chunk_bytes,
+                                    self.frame_count, self.data_offset))
+
+    def _load_chunk(self):
+        '''Times and bin blocks of the chunk being filled, read back if partial'''
+        code = VALUES[self.value_type][0]
+        self.times = [0] * self.chunk_frames
+        self.blocks = [array(code, [0] * self.chunk_frames) for b in range(self.bins)]
+        if self.fill == 0:
+            return
+        self.file.seek(self.data_offset + self.chunk * self.chunk_bytes)
+        self.times = list(struct.unpack('<%dQ' % self.chunk_frames,
+                                        self.file.read(8 * self.chunk_frames)))
+        for block in self.blocks:
+            del block[:]
+            block.fromfile(self.file, self.chunk_frames)
+
+    def _flush(self):
+        '''Write the chunk being filled, then the header that makes it visible'''
+        self.file.seek(self.data_offset + self.chunk * self.chunk_bytes)
+        data = [struct.pack('<%dQ' % self.chunk_frames, *self.times)]
+        data += [block.tostring() for block in self.blocks]
+        used = sum(len(d) for d in data)
+        self.file.write(''.join(data) + '\0' * (self.chunk_bytes - used))
+        self._write_header()
+        self.file.flush()
+
+    def append(self, spectrum, time_ns):
+        '''Add one spectrum of bins values, started at time_ns'''
+        if len(spectrum) != self.bins:
+            raise ValueError('spectrum has %d values, not %d' % (len(spectrum), self.bins))
+        self.times[self.fill] = time_ns
+        for b in range(self.bins):
+            self.blocks[b][self.fill] = spectrum[b]
+        self.fill += 1
+        self.frame_count += 1
+        if self.fill == self.chunk_frames:
+            self._flush()
+            self.chunk += 1
+            self.fill = 0
+            self._load_chunk()
+
+    def close(self):
+        if self.fill:
+            self._flush()
+        self.file.close()
+
+
+class Store(object):
+
+    def __init__(self, path):
+        f = open(path, 'rb')
+        try:
+            self.map = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        finally:
+            f.close()
+
+        fields = HEADER.unpack_from(self.map, 0)
+        _check(fields, path)
+        (self.samples, self.sample_rate, self.bins, self.chunk_frames,
+         self.value_type, self.chunk_bytes, self.frame_count,
+         self.data_offset) = fields[3:]
+        self.code, self.size = VALUES[self.value_type]
+        chunks = (self.frame_count + self.chunk_frames - 1) / self.chunk_frames
+        if self.data_offset + chunks * self.chunk_bytes > len(self.map) and chunks:
+            self.map.close()
+            raise ValueError(path + ' is truncated')
+
+    def __len__(self):
+        return self.frame_count
+
+    def _chunk(self, i):
+        return self.data_offset + i / self.chunk_frames * self.chunk_bytes
+
+    def time(self, i):
+        '''Start time of spectrum i in ns'''
+        if i < 0 or i >= self.frame_count:
+            raise IndexError(i)
+        return struct.unpack_from('<Q', self.map, self._chunk(i) + 8 * (i % self.chunk_frames))[0]
+
+    def find(self, time_ns):
+        '''First spectrum that starts at or after time_ns, len(self) if none'''
+        lo, hi = 0, self.frame_count
+        while lo < hi:
+            mid = (lo + hi) / 2
+            if self.time(mid) < time_ns:
+                lo = mid + 1
+            else:
+                hi = mid
+        return lo
+
+    def _values(self, bin, first, count):
+        '''count values of bin from spectrum first, which stay in one chunk'''
+        start = self._chunk(first) + 8 * self.chunk_frames \
+              + (bin * self.chunk_frames + first % self.chunk_frames) * self.size
+        values = array(self.code)
+        values.fromstring(self.map[start:start + count * self.size])
+        return values
+
+    def column(self, bin, start_ns=0, end_ns=None):
+        '''
+        Times and values of one bin for the spectra starting between
+        start_ns and end_ns, reading only that bin's blocks
+        '''
+        first = self.find(start_ns)
+        last = self.frame_count if end_ns is None else self.find(end_ns + 1)
+        times = []
+        values = array(self.code)
+        i = first
+        while i < last:
+            count = min(self.chunk_frames - i % self.chunk_frames, last - i)
+            times.extend(struct.unpack_from('<%dQ' % count, self.map,
+                                            self._chunk(i) + 8 * (i % self.chunk_frames)))
+            values.extend(self._values(bin, i, count))
+            i += count
+        return times, values
+
+    def spectrum(self, i):
+        '''All bins of spectrum i'''
+        if i < 0 or i >= self.frame_count:
+            raise IndexError(i)
+        return [self._values(b, i, 1)[0] for b in range(self.bins)]
+
+    def close(self):
+        self.map.close()
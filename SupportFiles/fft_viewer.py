@@ -0,0 +1,89 @@
+'''
+Live view of the spectra an acquisition process publishes in a shared
+memory ring (fft_ring.py), such as fft_fanout.py -m or host/fft_gateway -m.
+
+The viewer runs in its own process and only ever reads the newest
+spectrum, at a fixed frame rate: spectra published between two redraws
+are skipped, and a slow or paused window never holds up acquisition.
+Spectra with more bins than the plot has room for are reduced to width
+points, each the largest of the bins it covers so peaks stay visible.
+
+Usage: fft_viewer.py [ring] [frames per second] [width]
+Defaults are fft_spectra, 10 and 512.
+'''
+
+import sys
+import matplotlib.pyplot as plt
+import matplotlib.animation as animation
+import fft_ring
+
+name = 'fft_spectra'
+fps = 10
+width = 512
+
+if len(sys.argv) > 1:
+    name = sys.argv[1]
+if len(sys.argv) > 2:
+    fps = float(sys.argv[2])
+if len(sys.argv) > 3:
+    width = int(sys.argv[3])
+
+
+def decimate(values, width):
+    '''Peak of each of width groups of bins, and the first bin of each'''
+    step = max(1, (len(values) + width - 1) / width)
+    if step == 1:
+        return range(len(values)), list(values)
+    return (range(0, len(values), step),
+            [max(values[k:k + step]) for k in range(0, len(values), step)])
+
+
+def open_ring():
+    print "Waiting for ring " + name
+    while True:
+        try:
+            return fft_ring.Reader(name)
+        except (IOError, OSError, ValueError):
+            plt.pause(0.5)
+
+
+ring = open_ring()
+state = {'shown': None, 'skipped': 0}
+
+fig = plt.figure(1)
+fig.patch.set_facecolor('white')
+ax = plt.gca()
+line, = ax.plot([], [], linewidth=0.5)
+ax.set_ylabel('Magnitude')
+ax.set_xlabel('Frequency (Hz)')
+ax.tick_params(direction='out')
+ax.tick_params(bottom=True, left=True, top=False, right=False)
+
+
+def update(frame):
+    global ring
+    if ring.replaced():
+        ring.close()
+        ring = open_ring()
+        state['shown'] = None
+
+    latest = ring.latest()
+    if latest is None or latest[0] == state['shown']:
+        return line,
+    n, time_ns, source, values = latest
+    if state['shown'] is not None:
+        state['skipped'] += n - state['shown'] - 1
+    state['shown'] = n
+
+    bins, peaks = decimate(values, width)
+    hz = float(ring.sample_rate) / ring.samples
+    line.set_data([b * hz for b in bins], peaks)
+    ax.set_xlim(0, len(values) * hz)
+    ax.set_ylim(0, max(max(peaks), 1) * 1.1)
+    ax.set_title('Spectrum %d from board %d, %d skipped' % (n, source, state['skipped']))
+    return line,
+
+
+anim = animation.FuncAnimation(fig, update, interval=1000.0 / fps)
+plt.show()
+ring.close()
@@ -0,0 +1,123 @@
+/*
+ * One kissFFT build for fft_bench. The including file selects the scalar
+ * type (FIXED_POINT or KISS_FFT_FLOAT) and KISS_NAME(), a prefix that keeps
+ * this copy of the library apart from the other builds linked into the
+ * bench, then gets its engine table from KISS_NAME(Engines).
+ */
+#define kiss_fft_alloc              KISS_NAME(_fft_alloc)
+#define kiss_fft                    KISS_NAME(_fft)
+#define kiss_fft_stride             KISS_NAME(_fft_stride)
+#define kiss_fft_bfp                KISS_NAME(_fft_bfp)
+#define kiss_fft_cleanup            KISS_NAME(_fft_cleanup)
+#define kiss_fft_next_fast_size     KISS_NAME(_fft_next_fast_size)
+#define kiss_fftr_alloc             KISS_NAME(_fftr_alloc)
+#define kiss_fftr                   KISS_NAME(_fftr)
+#define kiss_fftri                  KISS_NAME(_fftri)
+#define kiss_fftr_bfp               KISS_NAME(_fftr_bfp)
+#define kiss_fftr_work              KISS_NAME(_fftr_work)
+#define kiss_fftr_shareable         KISS_NAME(_fftr_shareable)
+#define kiss_fft_overflows          KISS_NAME(_fft_overflows)
+#define kiss_fft_overflow_total     KISS_NAME(_fft_overflow_total)
+#define kiss_fft_overflow_reset     KISS_NAME(_fft_overflow_reset)
+#define kf_overflow_cell            KISS_NAME(_overflow_cell)
+
+#include "kiss_fft.c"
+#include "kiss_fftr.c"
+
+#include "fft_bench.h"
+
+/* Q31 builds take the 16 bit samples as Q15 in the top half, like the
+   firmware, and round the magnitudes back to 16 bits */
+#if defined(FIXED_POINT) && (FIXED_POINT == 32)
+#define SAMPLE_SCALE    65536.0
+#else
+#define SAMPLE_SCALE    1.0
+#endif
+
+static kiss_fftr_cfg cfg;
+static kiss_fft_scalar in[BENCH_MAX_SAMPLES];
+static kiss_fft_cpx out[BENCH_MAX_SAMPLES/2+1];
+static int n;
+#ifdef FIXED_POINT
+static int exponent;
+#endif
+
+static int supports(int size)
+{
+    return (size % 2) == 0;
+}
+
+static void setup(int size)
+{
+    free(cfg);
+    cfg = kiss_fftr_alloc(size, 0, NULL, NULL);
+    n = size;
+}
+
+/* samples arrive as 16 bit words, as over the serial line */
+static void load(const int16_t *x)
+{
+    int i;
+    for (i = 0; i < n; i++)
+        in[i] = (kiss_fft_scalar)(x[i] * SAMPLE_SCALE);
+}
+
+static void run(const int16_t *x)
+{
+    load(x);
+    kiss_fftr(cfg, in, out);
+}
+
+static void result(double *re, double *im, double *mag)
+{
+    int k;
+    for (k = 0; k < n/2; k++) {
+#if defined(FIXED_POINT) && (FIXED_POINT == 32)
+        re[k] = out[k].r / SAMPLE_SCALE;
+        im[k] = out[k].i / SAMPLE_SCALE;
+        mag[k] = floor(hypot(re[k], im[k]) + 0.5);
+#elif defined(FIXED_POINT)
+        re[k] = out[k].r;
+        im[k] = out[k].i;
+        mag[k] = floor(hypot(re[k], im[k]));
+#else
+        re[k] = out[k].r / n;
+        im[k] = out[k].i / n;
+        mag[k] = sqrtf(out[k].r*out[k].r + out[k].i*out[k].i) / n;
+#endif
+    }
+}
+
+#ifdef FIXED_POINT
+static void bfpRun(const int16_t *x)
+{
+    load(x);
+    exponent = kiss_fftr_bfp(cfg, in, out);
+}
+
+static void bfpResult(double *re, double *im, double *mag)
+{
+    int k;
+    for (k = 0; k < n/2; k++) {
+        /* the firmware sends the magnitude and exponent, the host scales */
+        re[k] = ldexp(out[k].r / SAMPLE_SCALE, exponent) / n;
+        im[k] = ldexp(out[k].i / SAMPLE_SCALE, exponent) / n;
+        mag[k] = ldexp(floor(hypot(out[k].r, out[k].i) / SAMPLE_SCALE), exponent) / n;
+    }
+}
+#endif
+
+static size_t memory(int size)
+{
+    size_t len = 0;
+    kiss_fftr_alloc(size, 0, NULL, &len);
+    return len + size*sizeof(kiss_fft_scalar) + (size/2+1)*sizeof(kiss_fft_cpx);
+}
+
+const engine KISS_NAME(Engines)[] = {
+    {KISS_LABEL,            supports, setup, run,    result,    memory},
+#ifdef FIXED_POINT
+    {KISS_LABEL " BFP",     supports, setup, bfpRun, bfpResult, memory},
+#endif
+};
+const int KISS_NAME(EngineCount) = sizeof(KISS_NAME(Engines)) / sizeof(engine);
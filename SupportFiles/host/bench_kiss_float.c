@@ -0,0 +1,5 @@
+/* kissFFT built with KISS_FFT_FLOAT, single precision. See bench_kiss.h. */
+#define KISS_FFT_FLOAT
+#define KISS_NAME(x)    kissFloat##x
+#define KISS_LABEL      "kiss float"
+#include "bench_kiss.h"
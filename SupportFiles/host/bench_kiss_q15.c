@@ -0,0 +1,5 @@
+/* kissFFT as the firmware builds it by default, Q15. See bench_kiss.h. */
+#define FIXED_POINT 16
+#define KISS_NAME(x)    kissQ15##x
+#define KISS_LABEL      "kiss Q15"
+#include "bench_kiss.h"
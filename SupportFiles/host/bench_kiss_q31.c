@@ -0,0 +1,5 @@
+/* kissFFT built with FIXED_POINT 32, Q15 samples in Q31. See bench_kiss.h. */
+#define FIXED_POINT 32
+#define KISS_NAME(x)    kissQ31##x
+#define KISS_LABEL      "kiss Q31"
+#include "bench_kiss.h"
@@ -0,0 +1,145 @@
+/*
+ * StaticFFTR from uart_FFT_kissFFT/staticFFT for fft_bench, in the same
+ * scalar types as the kissFFT builds. Sizes are instantiated from 64 to
+ * 8192; the tables are in flash on the board, so only the buffers count
+ * towards the bytes column.
+ *
+ * setup also runs a full scale square wave through each size and stops the
+ * bench if a harmonic is off: its real split has sums that only fit one
+ * bit up, and one taken in T wraps that bin by a whole full scale.
+ */
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "fft_bench.h"
+#include "static_fft.hpp"
+
+#ifndef M_PI
+#define M_PI    3.14159265358979323846
+#endif
+
+using static_fft::Complex;
+using static_fft::StaticFFTR;
+using static_fft::scalar_format;
+
+namespace {
+
+template <typename T>
+struct Bench {
+    /* the raw scalar as the format StaticFFTR computes in */
+    typedef typename scalar_format<T>::type F;
+
+    static T in[BENCH_MAX_SAMPLES];
+    static Complex<T> out[BENCH_MAX_SAMPLES/2+1];
+    static int n;
+    static void (*fft)(const F *, Complex<F> *);
+
+    /* Q31 takes the samples as Q15 in the top half, like the firmware */
+    static double sampleScale() { return sizeof(T) == 4 && T(0.5) == 0 ? 65536.0 : 1.0; }
+
+    static int supports(int size)
+    {
+        return size >= 64 && size <= 8192 && (size & (size-1)) == 0;
+    }
+
+    static void setup(int size)
+    {
+        n = size;
+        switch (size) {
+        case 64:    fft = StaticFFTR<F, 64>::forward; break;
+        case 128:   fft = StaticFFTR<F, 128>::forward; break;
+        case 256:   fft = StaticFFTR<F, 256>::forward; break;
+        case 512:   fft = StaticFFTR<F, 512>::forward; break;
+        case 1024:  fft = StaticFFTR<F, 1024>::forward; break;
+        case 2048:  fft = StaticFFTR<F, 2048>::forward; break;
+        case 4096:  fft = StaticFFTR<F, 4096>::forward; break;
+        case 8192:  fft = StaticFFTR<F, 8192>::forward; break;
+        }
+        checkFullScale();
+    }
+
+    /* Period 16 between -32768 and 32767, harmonics n/16 * odd; the
+       stages round off a few LSBs, a wrap is 32768 */
+    static void checkFullScale()
+    {
+        static int16_t x[BENCH_MAX_SAMPLES];
+        static double re[BENCH_MAX_SAMPLES/2], im[BENCH_MAX_SAMPLES/2];
+        static double mag[BENCH_MAX_SAMPLES/2];
+
+        for (int i = 0; i < n; i++)
+            x[i] = (i / 8) % 2 ? -32768 : 32767;
+        run(x);
+        result(re, im, mag);
+
+        for (int k = n/16; k < n/2; k += n/8) {
+            double sr = 0, si = 0;
+            for (int i = 0; i < n; i++) {
+                double a = 2*M_PI * (double)((long)k*i % n) / n;
+                sr += x[i] * cos(a);
+                si -= x[i] * sin(a);
+            }
+            double err = hypot(re[k] - sr/n, im[k] - si/n);
+            if (err > 64) {
+                fprintf(stderr, "static %s: bin %d of a full scale square wave is "
+                        "off by %.0f at N = %d\n", name(), k, err, n);
+                exit(1);
+            }
+        }
+    }
+
+    static const char *name()
+    {
+        return sizeof(T) == 2 ? "Q15" : T(0.5) == 0 ? "Q31" : "float";
+    }
+
+    static void run(const int16_t *x)
+    {
+        for (int i = 0; i < n; i++)
+            in[i] = (T)(x[i] * sampleScale());
+        fft(reinterpret_cast<const F *>(in), reinterpret_cast<Complex<F> *>(out));
+    }
+
+    static void result(double *re, double *im, double *mag)
+    {
+        /* fixed point is already divided by N, float is not */
+        double scale = T(0.5) == 0 ? sampleScale() : n;
+        for (int k = 0; k < n/2; k++) {
+            re[k] = out[k].r / scale;
+            im[k] = out[k].i / scale;
+            mag[k] = hypot(re[k], im[k]);
+            if (sizeof(T) == 2)
+                mag[k] = floor(mag[k]);
+            else if (T(0.5) == 0)
+                mag[k] = floor(mag[k] + 0.5);
+        }
+    }
+
+    static size_t memory(int size)
+    {
+        return size*sizeof(T) + (size/2+1)*sizeof(Complex<T>);
+    }
+};
+
+template <typename T> T Bench<T>::in[BENCH_MAX_SAMPLES];
+template <typename T> Complex<T> Bench<T>::out[BENCH_MAX_SAMPLES/2+1];
+template <typename T> int Bench<T>::n;
+template <typename T> void (*Bench<T>::fft)(const typename Bench<T>::F *,
+                                          Complex<typename Bench<T>::F> *);
+
+#define BENCH_ENGINE(name, T) \
+    {name, Bench<T>::supports, Bench<T>::setup, Bench<T>::run, Bench<T>::result, Bench<T>::memory}
+
+}
+
+extern "C" {
+
+const engine staticEngines[] = {
+    BENCH_ENGINE("static Q15", int16_t),
+    BENCH_ENGINE("static Q31", int32_t),
+    BENCH_ENGINE("static float", float),
+};
+const int staticEngineCount = sizeof(staticEngines) / sizeof(engine);
+
+}
@@ -0,0 +1,232 @@
+/*
+ * csv2fcap - convert text samples, such as fft_input.csv, into a capture
+ * file (fft_capture.h) that fft_csv.py and the batch tools map directly.
+ *
+ * Every integer in the input is a sample, whatever separates them: one per
+ * row, or a frame per row. Consecutive samples are cut into frames of N; a
+ * partial frame at the end is dropped with a warning. Frame i gets the
+ * start time i*N/rate. Decimal points are rejected, as the board takes
+ * integer samples in the given Q format.
+ *
+ * The input is mapped and scanned 16 bytes at a time with SSE2: one
+ * compare finds the digits of a block as a bit mask, blocks without digits
+ * are skipped, and each run of set bits is one number, so no byte is
+ * looked at twice. Without SSE2 the masks are built one byte at a time.
+ *
+ * Build from SupportFiles/host:
+ *   gcc -O2 -I. csv2fcap.c fft_capture.c -o csv2fcap
+ *
+ * Usage: csv2fcap [-n samples] [-r rate] [-q fractional bits] input output.fcap
+ * Defaults are 1024 samples at 8192 Hz in Q12, as fft_csv.py uses.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "fft_capture.h"
+
+#define BLOCK   16
+
+/* bit i set if p[i] is a digit, and in *dots if it is a '.' */
+static unsigned scanBlock(const unsigned char *p, unsigned *dots)
+{
+#ifdef __SSE2__
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    __m128i d = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    __m128i digit = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+    *dots = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('.')));
+    return _mm_movemask_epi8(digit);
+#else
+    unsigned mask = 0, i;
+    *dots = 0;
+    for (i = 0; i < BLOCK; i++) {
+        mask |= (unsigned)((unsigned)(p[i] - '0') < 10) << i;
+        *dots |= (unsigned)(p[i] == '.') << i;
+    }
+    return mask;
+#endif
+}
+
+/* saturates well above 16 bits so a long run of digits cannot overflow */
+static long accumulate(long value, unsigned char digit)
+{
+    return value < 1000000 ? value * 10 + (digit - '0') : value;
+}
+
+struct converter {
+    fft_capture_writer *out;
+    uint32_t samples;
+    uint32_t rate;
+    int16_t *frame;
+    uint32_t fill;
+    uint64_t frames;
+};
+
+static int emit(struct converter *c, long value, size_t at)
+{
+    if (value < -32768 || value > 32767) {
+        fprintf(stderr, "sample %ld at byte %lu does not fit 16 bits\n",
+                value, (unsigned long)at);
+        return -1;
+    }
+    c->frame[c->fill++] = (int16_t)value;
+    if (c->fill == c->samples) {
+        uint64_t timeNs = c->frames * c->samples * 1000000000ull / c->rate;
+        if (fft_capture_append(c->out, c->frame, timeNs) != 0) {
+            perror("writing capture");
+            return -1;
+        }
+        c->frames++;
+        c->fill = 0;
+    }
+    return 0;
+}
+
+static int convert(struct converter *c, const unsigned char *text, size_t length)
+{
+    unsigned char tail[BLOCK];
+    long value = 0;
+    int inNumber = 0, negative = 0;
+    unsigned char before = 0;           // byte before the current block
+    size_t pos;
+
+    for (pos = 0; pos < length; pos += BLOCK) {
+        const unsigned char *p = text + pos;
+        unsigned mask, dots;
+
+        /* the last block is copied out so the scan never reads past the map */
+        if (length - pos < BLOCK) {
+            memset(tail, ' ', BLOCK);
+            memcpy(tail, p, length - pos);
+            p = tail;
+        }
+        mask = scanBlock(p, &dots);
+        if (dots) {
+            fprintf(stderr, "decimal point at byte %lu, samples must be integers\n",
+                    (unsigned long)(pos + __builtin_ctz(dots)));
+            return -1;
+        }
+
+        if (mask == 0 && !inNumber) {
+            before = p[BLOCK - 1];
+            continue;
+        }
+
+        /* a number running on from the previous block ends at the first non digit */
+        if (inNumber) {
+            unsigned run = __builtin_ctz(~mask);
+            unsigned i;
+            for (i = 0; i < run; i++)
+                value = accumulate(value, p[i]);
+            if (run == BLOCK)
+                continue;
+            if (emit(c, negative ? -value : value, pos) != 0)
+                return -1;
+            inNumber = 0;
+            mask &= ~0u << run;
+        }
+
+        while (mask) {
+            unsigned start = __builtin_ctz(mask);
+            unsigned run = __builtin_ctz(~(mask >> start));
+            unsigned i;
+
+            negative = (start ? p[start - 1] : before) == '-';
+            value = 0;
+            for (i = start; i < start + run; i++)
+                value = accumulate(value, p[i]);
+
+            if (start + run == BLOCK) {
+                inNumber = 1;
+                break;
+            }
+            if (emit(c, negative ? -value : value, pos + start) != 0)
+                return -1;
+            mask &= ~0u << (start + run);
+        }
+        before = p[BLOCK - 1];
+    }
+    if (inNumber && emit(c, negative ? -value : value, length) != 0)
+        return -1;
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    struct converter c;
+    int qFormat = 12, arg, fd, status;
+    const char *in, *outPath;
+    struct stat st;
+    void *text = NULL;
+
+    memset(&c, 0, sizeof(c));
+    c.samples = 1024;
+    c.rate = 8192;
+
+    for (arg = 1; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+        if (strcmp(argv[arg], "-n") == 0)
+            c.samples = atoi(argv[arg + 1]);
+        else if (strcmp(argv[arg], "-r") == 0)
+            c.rate = atoi(argv[arg + 1]);
+        else if (strcmp(argv[arg], "-q") == 0)
+            qFormat = atoi(argv[arg + 1]);
+        else
+            break;
+    }
+    if (argc - arg != 2 || c.samples == 0 || c.rate == 0 || qFormat < 0 || qFormat > 15) {
+        fprintf(stderr, "usage: csv2fcap [-n samples] [-r rate] [-q fractional bits] input output.fcap\n");
+        return 1;
+    }
+    in = argv[arg];
+    outPath = argv[arg + 1];
+
+    fd = open(in, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror(in);
+        return 1;
+    }
+    if (st.st_size > 0) {
+        text = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (text == MAP_FAILED) {
+            perror(in);
+            return 1;
+        }
+        madvise(text, st.st_size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    c.frame = malloc(sizeof(int16_t) * c.samples);
+    c.out = fft_capture_create(outPath, c.samples, c.rate, (uint8_t)qFormat);
+    if (c.frame == NULL || c.out == NULL) {
+        perror(outPath);
+        return 1;
+    }
+
+    status = convert(&c, (const unsigned char *)text, st.st_size);
+    if (fft_capture_finish(c.out) != 0) {
+        perror(outPath);
+        status = -1;
+    }
+    if (status != 0) {
+        unlink(outPath);
+        return 1;
+    }
+    if (c.fill)
+        fprintf(stderr, "dropped %u samples after the last full frame\n", c.fill);
+    printf("%lu frames of %u samples\n", (unsigned long)c.frames, c.samples);
+
+    if (text != NULL)
+        munmap(text, st.st_size);
+    free(c.frame);
+    return 0;
+}
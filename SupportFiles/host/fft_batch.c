@@ -0,0 +1,202 @@
+/*
+ * Batch firmware pipeline, see fft_batch.h.
+ */
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "kiss_fftr.h"
+#include "fft_batch.h"
+
+#if !defined(FIXED_POINT) || (FIXED_POINT != 16)
+#error "fft_batch reproduces the default firmware build: kissFFT in Q15"
+#endif
+
+/* frames per task at most, few enough to balance the last ones across threads */
+#define BATCH_CHUNK     64
+
+struct fft_batch_scratch {
+    kiss_fft_cpx * tmpbuf;              // samples/2 points, for kiss_fftr_work
+    kiss_fft_cpx * out;                 // samples/2 + 1 points
+    kiss_fftr_cfg cfg;                  // own plan if the shared one is not shareable
+};
+
+struct fft_batch {
+    int samples;
+    fft_pool * pool;
+    kiss_fftr_cfg cfg;
+    int nscratch;
+    struct fft_batch_scratch * scratch; // as many as threads
+    pthread_mutex_t lock;
+    int * scratchFree;                  // stack of unused scratch indices
+    int scratchTop;
+};
+
+struct fft_batch_task {
+    fft_batch * batch;
+    const int16_t * frames;
+    size_t stride;
+    size_t count;
+    int16_t * spectra;
+};
+
+/* _Qmag: sqrt(re^2 + im^2) rounded to nearest, which the Q does not change */
+static int16_t batchMag(kiss_fft_scalar re, kiss_fft_scalar im)
+{
+    uint32_t s = (uint32_t)((int32_t)re*re) + (uint32_t)((int32_t)im*im);
+    uint32_t r = (uint32_t)sqrt((double)s);
+
+    if (s - r*r > r)
+        r++;
+    return (int16_t)r;
+}
+
+/* Scratch sets are taken per task, not per thread: a task can run on any
+   thread of the pool, or on one that is only waiting on it. */
+static int takeScratch(fft_batch * batch)
+{
+    int index = -1;
+
+    while (index < 0) {
+        pthread_mutex_lock(&batch->lock);
+        if (batch->scratchTop > 0)
+            index = batch->scratchFree[--batch->scratchTop];
+        pthread_mutex_unlock(&batch->lock);
+        if (index < 0)
+            sched_yield();
+    }
+    return index;
+}
+
+static void giveScratch(fft_batch * batch, int index)
+{
+    pthread_mutex_lock(&batch->lock);
+    batch->scratchFree[batch->scratchTop++] = index;
+    pthread_mutex_unlock(&batch->lock);
+}
+
+static void batchTask(void * arg)
+{
+    const struct fft_batch_task * task = (const struct fft_batch_task *)arg;
+    fft_batch * batch = task->batch;
+    const int samples = batch->samples;
+    const int index = takeScratch(batch);
+    struct fft_batch_scratch * sc = &batch->scratch[index];
+    size_t f;
+    int k;
+
+    for (f = 0; f < task->count; f++) {
+        const int16_t * x = task->frames + f * task->stride;
+        int16_t * mag = task->spectra + f * (samples/2);
+
+        kiss_fftr_work(sc->cfg ? sc->cfg : batch->cfg, x, sc->out, sc->tmpbuf);
+        for (k = 0; k < samples/2; k++)
+            mag[k] = batchMag(sc->out[k].r, sc->out[k].i);
+    }
+    giveScratch(batch, index);
+}
+
+fft_batch * fft_batch_create(int samples, fft_pool * pool)
+{
+    fft_batch * batch;
+    int i;
+
+    if (samples < 2 || (samples & 1))
+        return NULL;
+    batch = (fft_batch *)calloc(1, sizeof(*batch));
+    if (batch == NULL)
+        return NULL;
+    batch->samples = samples;
+    batch->pool = pool;
+    pthread_mutex_init(&batch->lock, NULL);
+    batch->cfg = kiss_fftr_alloc(samples, 0, NULL, NULL);
+    if (batch->cfg == NULL) {
+        fft_batch_destroy(batch);
+        return NULL;
+    }
+
+    batch->nscratch = fft_pool_threads(pool);
+    batch->scratch = (struct fft_batch_scratch *)calloc(batch->nscratch,
+            sizeof(struct fft_batch_scratch));
+    batch->scratchFree = (int *)calloc(batch->nscratch, sizeof(int));
+    if (batch->scratch == NULL || batch->scratchFree == NULL) {
+        fft_batch_destroy(batch);
+        return NULL;
+    }
+    for (i = 0; i < batch->nscratch; i++) {
+        batch->scratch[i].tmpbuf = malloc(sizeof(kiss_fft_cpx) * (samples/2));
+        batch->scratch[i].out = malloc(sizeof(kiss_fft_cpx) * (samples/2 + 1));
+        if (!kiss_fftr_shareable(batch->cfg))
+            batch->scratch[i].cfg = kiss_fftr_alloc(samples, 0, NULL, NULL);
+        if (batch->scratch[i].tmpbuf == NULL || batch->scratch[i].out == NULL
+                || (!kiss_fftr_shareable(batch->cfg) && batch->scratch[i].cfg == NULL)) {
+            fft_batch_destroy(batch);
+            return NULL;
+        }
+        batch->scratchFree[i] = i;
+    }
+    batch->scratchTop = batch->nscratch;
+    return batch;
+}
+
+void fft_batch_destroy(fft_batch * batch)
+{
+    int i;
+
+    if (batch == NULL)
+        return;
+    if (batch->scratch != NULL) {
+        for (i = 0; i < batch->nscratch; i++) {
+            free(batch->scratch[i].tmpbuf);
+            free(batch->scratch[i].out);
+            kiss_fftr_free(batch->scratch[i].cfg);
+        }
+    }
+    free(batch->scratch);
+    free(batch->scratchFree);
+    kiss_fftr_free(batch->cfg);
+    pthread_mutex_destroy(&batch->lock);
+    free(batch);
+}
+
+/* split in halves down to BATCH_CHUNK frames, so the deques stay shallow
+   and idle threads steal the biggest pieces */
+static void batchSplit(void * arg)
+{
+    const struct fft_batch_task * task = (const struct fft_batch_task *)arg;
+    fft_batch * batch = task->batch;
+    fft_task_group group = FFT_TASK_GROUP_INIT;
+    struct fft_batch_task half[2];
+    size_t first;
+
+    if (task->count <= BATCH_CHUNK) {
+        batchTask(arg);
+        return;
+    }
+
+    first = task->count / 2;
+    half[0] = *task;
+    half[0].count = first;
+    half[1] = *task;
+    half[1].frames += first * task->stride;
+    half[1].spectra += first * (batch->samples/2);
+    half[1].count -= first;
+
+    fft_pool_spawn(batch->pool, &group, batchSplit, &half[1]);
+    batchSplit(&half[0]);
+    fft_pool_wait(batch->pool, &group);
+}
+
+void fft_batch_run(fft_batch * batch, const int16_t * frames, size_t stride,
+                   size_t count, int16_t * spectra)
+{
+    struct fft_batch_task all;
+
+    all.batch = batch;
+    all.frames = frames;
+    all.stride = stride;
+    all.count = count;
+    all.spectra = spectra;
+    batchSplit(&all);
+}
@@ -0,0 +1,40 @@
+/*
+ * Batch version of the firmware pipeline for reprocessing captures on the
+ * host: kiss_fftr in Q15 and _Qmag on every frame, as uart_FFT_kissFFT does
+ * in its default build, so each spectrum is the one the board would send.
+ *
+ * One kiss_fftr plan is shared read only by all threads of an fft_pool;
+ * each thread has its own tmpbuf and output scratch (kiss_fftr_work), so
+ * frames per second grow with the number of cores. Sizes whose half has a
+ * prime factor above 5 need the plan's own scratch, and get one plan per
+ * thread instead.
+ */
+#ifndef FFT_BATCH_H
+#define FFT_BATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "fft_pool.h"
+
+typedef struct fft_batch fft_batch;
+
+/*
+ * Prepare for frames of samples points on the threads of pool. samples
+ * must be even. Returns NULL otherwise or without memory.
+ */
+fft_batch * fft_batch_create(int samples, fft_pool * pool);
+
+void fft_batch_destroy(fft_batch * batch);
+
+/*
+ * Transform count frames of samples 16 bit values each, one every stride
+ * values, into count rows of samples/2 magnitudes. stride is samples for
+ * frames stored back to back, or frameStride/2 of a mapped capture
+ * (fft_capture.h). frames and stride must keep every frame 4 byte
+ * aligned, as kiss_fftr reads the samples as complex pairs.
+ */
+void fft_batch_run(fft_batch * batch, const int16_t * frames, size_t stride,
+                   size_t count, int16_t * spectra);
+
+#endif
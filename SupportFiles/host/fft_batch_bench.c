@@ -0,0 +1,184 @@
+/*
+ * fft_batch_bench - frames per second of fft_batch against the number of
+ * threads, and a check that its spectra are the ones the firmware sends.
+ *
+ * The frames are the fft_bench test signal in Q12 with a different noise
+ * seed per frame, or those of a capture file (csv2fcap), which are mapped
+ * and transformed in place without being read into memory first. Every run is compared with kiss_fftr and _Qmag frame by
+ * frame on one thread, which is what uart_FFT_kissFFT does on the board.
+ *
+ * Build from SupportFiles/host:
+ *   gcc -O2 -I. -I../../uart_FFT_kissFFT/kissFFT fft_batch_bench.c
+ *       fft_batch.c fft_pool.c fft_capture.c ../../uart_FFT_kissFFT/kissFFT/kiss_fft.c
+ *       ../../uart_FFT_kissFFT/kissFFT/kiss_fftr.c -lm -lpthread
+ *       -o fft_batch_bench
+ *
+ * Usage: fft_batch_bench [-t max threads] [-f capture.fcap] [samples] [frames]
+ * max threads defaults to one per online CPU; the run doubles the thread
+ * count from 1 up to it. A capture gives the samples and frames itself.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <ti/iqmathlib/QmathLib.h>
+#include "kiss_fftr.h"
+#include "fft_batch.h"
+#include "fft_capture.h"
+
+#ifndef M_PI
+#define M_PI    3.14159265358979323846
+#endif
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void makeFrames(int16_t *x, int n, size_t count)
+{
+    size_t f;
+    int i;
+
+    srand(1);
+    for (f = 0; f < count; f++, x += n) {
+        for (i = 0; i < n; i++) {
+            double t = (double)i / 8192;
+            double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+            double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+            double noise = 0.1 * sqrt(-2*log(u1)) * cos(2*M_PI*u2);
+            double v = 1.33*cos(128*2*M_PI*t + M_PI*0.5) + 2*cos(512*2*M_PI*t)
+                     + 0.6*cos(2048*2*M_PI*t - M_PI*0.5) + 5*noise;
+            v = floor(v * 4096 + 0.5);
+            x[i] = (int16_t)(v > 32767 ? 32767 : v < -32768 ? -32768 : v);
+        }
+    }
+}
+
+/* the firmware loop: kiss_fftr, then _Qmag of the first n/2 bins */
+static void reference(const int16_t *x, size_t stride, int n, size_t count, int16_t *spectra)
+{
+    kiss_fftr_cfg cfg = kiss_fftr_alloc(n, 0, NULL, NULL);
+    kiss_fft_cpx *out = malloc(sizeof(kiss_fft_cpx) * (n/2 + 1));
+    size_t f;
+    int k;
+
+    for (f = 0; f < count; f++) {
+        kiss_fftr(cfg, x + f*stride, out);
+        for (k = 0; k < n/2; k++)
+            spectra[f*(n/2) + k] = _Qmag(out[k].r, out[k].i);
+    }
+    free(out);
+    kiss_fftr_free(cfg);
+}
+
+int main(int argc, char *argv[])
+{
+    int maxThreads = 0, first = 1, n, threads;
+    size_t count, bins, stride;
+    const char *capturePath = NULL;
+    fft_capture *cap = NULL;
+    int16_t *generated = NULL, *ref, *spectra;
+    const int16_t *frames;
+
+    while (argc > first + 1) {
+        if (strcmp(argv[first], "-t") == 0)
+            maxThreads = atoi(argv[first + 1]);
+        else if (strcmp(argv[first], "-f") == 0)
+            capturePath = argv[first + 1];
+        else
+            break;
+        first += 2;
+    }
+    if (maxThreads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        maxThreads = cpus > 0 ? (int)cpus : 1;
+    }
+    if (capturePath != NULL) {
+        const struct fft_capture_header *info;
+        cap = fft_capture_open(capturePath);
+        if (cap == NULL) {
+            perror(capturePath);
+            return 1;
+        }
+        info = fft_capture_info(cap);
+        n = (int)info->samples;
+        count = (size_t)info->frameCount;
+        stride = info->frameStride / 2;
+    } else {
+        n = argc > first ? atoi(argv[first]) : 1024;
+        count = argc > first + 1 ? (size_t)atol(argv[first + 1]) : 20000;
+        stride = (size_t)n;
+    }
+    if (n < 2 || (n & 1) || count == 0) {
+        fprintf(stderr, "samples must be even and frames at least 1\n");
+        return 1;
+    }
+
+    bins = (size_t)n / 2;
+    if (cap == NULL)
+        generated = malloc(sizeof(int16_t) * n * count);
+    ref = malloc(sizeof(int16_t) * bins * count);
+    spectra = malloc(sizeof(int16_t) * bins * count);
+    if ((cap == NULL && generated == NULL) || ref == NULL || spectra == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    if (cap != NULL) {
+        frames = fft_capture_frame(cap, 0);
+    } else {
+        makeFrames(generated, n, count);
+        frames = generated;
+    }
+    reference(frames, stride, n, count, ref);
+
+    printf("N = %d, %lu frames\n\n", n, (unsigned long)count);
+    printf("%8s %12s %8s %8s\n", "threads", "frames/s", "scaling", "match");
+
+    {
+        double base = 0;
+        for (threads = 1; threads <= maxThreads; ) {
+            fft_pool *pool = fft_pool_create(threads);
+            fft_batch *batch = pool ? fft_batch_create(n, pool) : NULL;
+            double best = INFINITY;
+            int run;
+
+            if (batch == NULL) {
+                fprintf(stderr, "could not set up %d samples on %d threads\n", n, threads);
+                return 1;
+            }
+            for (run = 0; run < 3; run++) {
+                double start = now(), elapsed;
+                memset(spectra, 0, sizeof(int16_t) * bins * count);
+                fft_batch_run(batch, frames, stride, count, spectra);
+                elapsed = now() - start;
+                if (elapsed < best)
+                    best = elapsed;
+            }
+            if (threads == 1)
+                base = count / best;
+            printf("%8d %12.0f %8.2f %8s\n", threads, count / best, count / best / base,
+                   memcmp(spectra, ref, sizeof(int16_t) * bins * count) == 0 ? "yes" : "NO");
+
+            fft_batch_destroy(batch);
+            fft_pool_destroy(pool);
+            /* doubling, and the maximum itself last */
+            if (threads < maxThreads && threads * 2 > maxThreads)
+                threads = maxThreads;
+            else
+                threads *= 2;
+        }
+    }
+
+    free(generated);
+    fft_capture_close(cap);
+    free(ref);
+    free(spectra);
+    return 0;
+}
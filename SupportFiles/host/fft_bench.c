@@ -0,0 +1,247 @@
+/*
+ * fft_bench - accuracy and speed of the firmware FFT engines, run on a PC.
+ *
+ * Every engine transforms the same frame of 16 bit samples and its spectrum
+ * is compared with a double precision DFT on the scale the firmware sends,
+ * abs(fft(x)/N) as in IQmathFFT.m. For each engine it prints
+ *   SNR      error power against the reference over all bins, in dB
+ *   max err  largest magnitude error, in LSBs of the sent values
+ *   bytes    plan and buffers the firmware would need for this size
+ *   us       time per frame on this machine; only useful for comparing
+ *            engines with each other. Cycles on the board are reported by
+ *            its 'T' telemetry command, which fft_csv.py prints.
+ *
+ * The frame is the IQmathFFT.m test signal in Q12, or the first N rows of a
+ * CSV file such as fft_input.csv. Shifting it down by a few bits shows how
+ * the engines cope with small signals.
+ *
+ * kissFFT is linked in once per scalar type, see bench_kiss.h.
+ *
+ * Build from SupportFiles/host:
+ *   g++ -std=c++14 -O2 -I. -I../../uart_FFT_kissFFT/staticFFT
+ *       -c bench_static.cpp
+ *   gcc -O2 -I. -I../../uart_FFT_kissFFT/kissFFT -I../../uart_FFT_kissFFT/qFFT
+ *       fft_bench.c bench_kiss_q15.c bench_kiss_q31.c bench_kiss_float.c
+ *       bench_static.o ../../uart_FFT_kissFFT/qFFT/qfft.c -lm -lstdc++ -o fft_bench
+ *
+ * Usage: fft_bench [samples] [attenuation bits] [input csv]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "fft_bench.h"
+#include "qfft.h"
+
+#ifndef M_PI
+#define M_PI    3.14159265358979323846
+#endif
+
+#define MAX_SAMPLES     BENCH_MAX_SAMPLES
+
+static int n;                           // FFT size of the current run
+
+/*
+ * IQmath radix-2 cFFT (qFFT/), with the samples taken as Q12.
+ */
+static _q qInput[2*MAX_SAMPLES];
+
+static int qSupports(int size)
+{
+    return size >= 2 && (size & (size-1)) == 0 && size <= 32768;
+}
+
+static void qLoad(const int16_t *x)
+{
+    int i;
+    for (i = 0; i < n; i++) {
+        qInput[RE(i)] = x[i];
+        qInput[IM(i)] = 0;
+    }
+}
+
+static void qRun(const int16_t *x)
+{
+    qLoad(x);
+    cFFT(qInput, n);
+}
+
+static void qBfpRun(const int16_t *x)
+{
+    int i, shift, log2n = 0;
+
+    while ((1 << log2n) < n)
+        log2n++;
+
+    /* same rounding back to 1/N as fftEngine/engine_qfft.c */
+    qLoad(x);
+    shift = log2n - cFFTBlockFloat(qInput, n);
+    if (shift > 0) {
+        for (i = 0; i < 2*n; i++) {
+            qInput[i] = (qInput[i] + (1 << (shift-1))) >> shift;
+        }
+    }
+}
+
+static size_t qMemory(int size)
+{
+    return 2*size*sizeof(_q);
+}
+
+static void qResult(double *re, double *im, double *mag)
+{
+    int k;
+    for (k = 0; k < n/2; k++) {
+        re[k] = qInput[RE(k)];
+        im[k] = qInput[IM(k)];
+        mag[k] = _Qmag(qInput[RE(k)], qInput[IM(k)]);
+    }
+}
+
+static const engine qEngines[] = {
+    {"cFFT Q12",        qSupports,    NULL,      qRun,       qResult,    qMemory},
+    {"cFFT Q12 BFP",    qSupports,    NULL,      qBfpRun,    qResult,    qMemory},
+};
+static const int qEngineCount = sizeof(qEngines) / sizeof(engine);
+
+static const struct {
+    const engine *engines;
+    const int *count;
+} groups[] = {
+    {kissQ15Engines,    &kissQ15EngineCount},
+    {kissQ31Engines,    &kissQ31EngineCount},
+    {kissFloatEngines,  &kissFloatEngineCount},
+    {staticEngines,     &staticEngineCount},
+    {qEngines,          &qEngineCount},
+};
+#define GROUP_COUNT     (sizeof(groups)/sizeof(groups[0]))
+
+/* The IQmathFFT.m test signal in Q12, noise from a fixed seed */
+static void makeSignal(int16_t *x, double fs)
+{
+    double T = n / fs;
+    int i;
+
+    srand(1);
+    for (i = 0; i < n; i++) {
+        double t = T * i / (n - 1);
+        double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+        double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+        double noise = 0.1 * sqrt(-2*log(u1)) * cos(2*M_PI*u2);
+        double v = 1.33*cos(128*2*M_PI*t + M_PI*0.5) + 2*cos(512*2*M_PI*t)
+                 + 0.6*cos(2048*2*M_PI*t - M_PI*0.5) + 5*noise
+                 + 0.8*cos(3500*2*M_PI*t - M_PI*0.7) - 0.8*cos(768*2*M_PI*t + M_PI*0.3);
+        v = floor(v * 4096 + 0.5);
+        x[i] = (int16_t)(v > 32767 ? 32767 : v < -32768 ? -32768 : v);
+    }
+}
+
+static int readSignal(int16_t *x, const char *path)
+{
+    FILE *f = fopen(path, "r");
+    int i = 0;
+    long v;
+
+    if (f == NULL)
+        return 0;
+    while (i < n && fscanf(f, " %ld", &v) == 1)
+        x[i++] = (int16_t)v;
+    fclose(f);
+    return i == n;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char *argv[])
+{
+    static int16_t x[MAX_SAMPLES];
+    static double refRe[MAX_SAMPLES/2], refIm[MAX_SAMPLES/2];
+    static double re[MAX_SAMPLES/2], im[MAX_SAMPLES/2], mag[MAX_SAMPLES/2];
+    int attenuation, i, k, e;
+    unsigned g;
+
+    n = argc > 1 ? atoi(argv[1]) : 1024;
+    attenuation = argc > 2 ? atoi(argv[2]) : 0;
+    if (n < 2 || n > MAX_SAMPLES) {
+        fprintf(stderr, "samples must be between 2 and %d\n", MAX_SAMPLES);
+        return 1;
+    }
+
+    if (argc > 3) {
+        if (!readSignal(x, argv[3])) {
+            fprintf(stderr, "could not read %d samples from %s\n", n, argv[3]);
+            return 1;
+        }
+    } else {
+        makeSignal(x, 8192);
+    }
+    for (i = 0; i < n; i++)
+        x[i] >>= attenuation;
+
+    /* reference: double precision DFT divided by N */
+    for (k = 0; k < n/2; k++) {
+        double sr = 0, si = 0;
+        for (i = 0; i < n; i++) {
+            double a = 2*M_PI * (double)((long)k*i % n) / n;
+            sr += x[i] * cos(a);
+            si -= x[i] * sin(a);
+        }
+        refRe[k] = sr / n;
+        refIm[k] = si / n;
+    }
+
+    printf("N = %d, input shifted down %d bits\n\n", n, attenuation);
+    printf("%-16s %9s %9s %9s %10s\n", "engine", "SNR dB", "max err", "bytes", "us");
+
+    for (g = 0; g < GROUP_COUNT; g++)
+    for (e = 0; e < *groups[g].count; e++) {
+        const engine *eng = &groups[g].engines[e];
+        double signal = 0, noise = 0, maxErr = 0, start, elapsed, perFrame;
+        long runs;
+        int batch;
+
+        if (!eng->supports(n)) {
+            printf("%-16s %9s\n", eng->name, "-");
+            continue;
+        }
+        if (eng->setup)
+            eng->setup(n);
+
+        /* best of a few batches, other load on the machine only adds time */
+        perFrame = INFINITY;
+        for (batch = 0; batch < 5; batch++) {
+            runs = 0;
+            start = now();
+            do {
+                eng->run(x);
+                runs++;
+                elapsed = now() - start;
+            } while (elapsed < 0.04);
+            if (elapsed / runs < perFrame)
+                perFrame = elapsed / runs;
+        }
+
+        eng->result(re, im, mag);
+        for (k = 0; k < n/2; k++) {
+            double dr = re[k] - refRe[k], di = im[k] - refIm[k];
+            double err = fabs(mag[k] - hypot(refRe[k], refIm[k]));
+            signal += refRe[k]*refRe[k] + refIm[k]*refIm[k];
+            noise += dr*dr + di*di;
+            if (err > maxErr)
+                maxErr = err;
+        }
+
+        printf("%-16s %9.1f %9.2f %9lu %10.2f\n", eng->name,
+               noise > 0 ? 10*log10(signal / noise) : INFINITY,
+               maxErr, (unsigned long)eng->memory(n), 1e6 * perFrame);
+    }
+    return 0;
+}
@@ -0,0 +1,46 @@
+/*
+ * Engines measured by fft_bench. Each one transforms a frame of 16 bit
+ * samples the way a firmware build would and hands back the spectrum on
+ * the scale the board sends, X/N in sample LSBs.
+ */
+#ifndef FFT_BENCH_H
+#define FFT_BENCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BENCH_MAX_SAMPLES   16384
+
+typedef struct {
+    const char *name;
+    int (*supports)(int n);
+    void (*setup)(int n);           // NULL if there is no plan to build
+    void (*run)(const int16_t *x);
+    /* spectrum of the last run as X/N, and the magnitudes the firmware
+       would send, n/2 bins each */
+    void (*result)(double *re, double *im, double *mag);
+    /* bytes of plan and working buffers the firmware needs at size n */
+    size_t (*memory)(int n);
+} engine;
+
+/* kissFFT variants, from bench_kiss_*.c */
+extern const engine kissQ15Engines[];
+extern const int kissQ15EngineCount;
+extern const engine kissFloatEngines[];
+extern const int kissFloatEngineCount;
+extern const engine kissQ31Engines[];
+extern const int kissQ31EngineCount;
+
+/* StaticFFTR, from bench_static.cpp */
+extern const engine staticEngines[];
+extern const int staticEngineCount;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
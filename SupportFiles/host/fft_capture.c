@@ -0,0 +1,204 @@
+/*
+ * Capture files, see fft_capture.h. The structs are written as they are in
+ * memory, which matches the file on the little endian machines the host
+ * tools run on.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "fft_capture.h"
+
+typedef char fft_capture_header_is_64_bytes[sizeof(struct fft_capture_header) == 64 ? 1 : -1];
+
+struct fft_capture {
+    const unsigned char * map;
+    size_t length;
+    const struct fft_capture_header * header;
+    const uint64_t * index;
+};
+
+struct fft_capture_writer {
+    FILE * file;
+    struct fft_capture_header header;
+    uint64_t * times;
+    uint64_t capacity;
+};
+
+fft_capture * fft_capture_open(const char * path)
+{
+    const struct fft_capture_header * h;
+    fft_capture * cap;
+    struct stat st;
+    void * map;
+    int fd, err;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &st) != 0) {
+        err = errno;
+        close(fd);
+        errno = err;
+        return NULL;
+    }
+    if ((size_t)st.st_size < sizeof(struct fft_capture_header)) {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    err = errno;
+    close(fd);
+    if (map == MAP_FAILED) {
+        errno = err;
+        return NULL;
+    }
+
+    /* everything the accessors rely on is checked once here */
+    h = (const struct fft_capture_header *)map;
+    if (memcmp(h->magic, FFT_CAPTURE_MAGIC, 4) != 0 || h->version != FFT_CAPTURE_VERSION
+            || h->headerSize != sizeof(*h) || h->samples == 0
+            || h->frameStride < 2 * (uint64_t)h->samples || h->frameStride % FFT_CAPTURE_ALIGN
+            || h->framesOffset % FFT_CAPTURE_PAGE
+            || h->indexOffset < h->framesOffset
+            || (h->indexOffset - h->framesOffset) / h->frameStride < h->frameCount
+            || h->indexOffset % 8
+            || h->indexOffset > (uint64_t)st.st_size
+            || ((uint64_t)st.st_size - h->indexOffset) / 8 < h->frameCount) {
+        munmap(map, st.st_size);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    cap = (fft_capture *)malloc(sizeof(*cap));
+    if (cap == NULL) {
+        munmap(map, st.st_size);
+        errno = ENOMEM;
+        return NULL;
+    }
+    cap->map = (const unsigned char *)map;
+    cap->length = st.st_size;
+    cap->header = h;
+    cap->index = (const uint64_t *)(cap->map + h->indexOffset);
+
+    /* frames are read front to back by the batch tools */
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+    return cap;
+}
+
+void fft_capture_close(fft_capture * cap)
+{
+    if (cap == NULL)
+        return;
+    munmap((void *)cap->map, cap->length);
+    free(cap);
+}
+
+const struct fft_capture_header * fft_capture_info(const fft_capture * cap)
+{
+    return cap->header;
+}
+
+const int16_t * fft_capture_frame(const fft_capture * cap, uint64_t i)
+{
+    return (const int16_t *)(cap->map + cap->header->framesOffset
+                             + i * cap->header->frameStride);
+}
+
+uint64_t fft_capture_time(const fft_capture * cap, uint64_t i)
+{
+    return cap->index[i];
+}
+
+uint64_t fft_capture_find(const fft_capture * cap, uint64_t timeNs)
+{
+    uint64_t lo = 0, hi = cap->header->frameCount;
+
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (cap->index[mid] < timeNs)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+fft_capture_writer * fft_capture_create(const char * path, uint32_t samples,
+                                        uint32_t sampleRate, uint8_t qFormat)
+{
+    fft_capture_writer * w;
+
+    if (samples == 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    w = (fft_capture_writer *)calloc(1, sizeof(*w));
+    if (w == NULL)
+        return NULL;
+    w->file = fopen(path, "wb");
+    if (w->file == NULL) {
+        free(w);
+        return NULL;
+    }
+
+    memcpy(w->header.magic, FFT_CAPTURE_MAGIC, 4);
+    w->header.version = FFT_CAPTURE_VERSION;
+    w->header.headerSize = sizeof(w->header);
+    w->header.samples = samples;
+    w->header.sampleRate = sampleRate;
+    w->header.qFormat = qFormat;
+    w->header.frameStride = (2*samples + FFT_CAPTURE_ALIGN - 1) / FFT_CAPTURE_ALIGN * FFT_CAPTURE_ALIGN;
+    w->header.framesOffset = FFT_CAPTURE_PAGE;
+
+    /* the header is written again by fft_capture_finish; frames start on a page */
+    if (fwrite(&w->header, sizeof(w->header), 1, w->file) != 1
+            || fseek(w->file, FFT_CAPTURE_PAGE, SEEK_SET) != 0) {
+        fclose(w->file);
+        free(w);
+        return NULL;
+    }
+    return w;
+}
+
+int fft_capture_append(fft_capture_writer * w, const int16_t * frame, uint64_t timeNs)
+{
+    static const unsigned char zeros[FFT_CAPTURE_ALIGN];
+    size_t bytes = 2 * (size_t)w->header.samples;
+    size_t pad = w->header.frameStride - bytes;
+
+    if (w->header.frameCount == w->capacity) {
+        uint64_t capacity = w->capacity ? 2 * w->capacity : 1024;
+        uint64_t * times = (uint64_t *)realloc(w->times, capacity * sizeof(uint64_t));
+        if (times == NULL)
+            return -1;
+        w->times = times;
+        w->capacity = capacity;
+    }
+    if (fwrite(frame, 1, bytes, w->file) != bytes
+            || (pad && fwrite(zeros, 1, pad, w->file) != pad))
+        return -1;
+    w->times[w->header.frameCount++] = timeNs;
+    return 0;
+}
+
+int fft_capture_finish(fft_capture_writer * w)
+{
+    int ok;
+
+    w->header.indexOffset = w->header.framesOffset
+                          + w->header.frameCount * w->header.frameStride;
+    ok = fwrite(w->times, sizeof(uint64_t), w->header.frameCount, w->file) == w->header.frameCount
+      && fseek(w->file, 0, SEEK_SET) == 0
+      && fwrite(&w->header, sizeof(w->header), 1, w->file) == 1;
+    ok = (fclose(w->file) == 0) && ok;
+    free(w->times);
+    free(w);
+    return ok ? 0 : -1;
+}
@@ -0,0 +1,71 @@
+/*
+ * Binary capture files (.fcap): frames of 16 bit samples laid out so the
+ * host tools can mmap them and hand them to an FFT without parsing.
+ *
+ *   offset 0     header, struct fft_capture_header
+ *   framesOffset frameCount frames of samples int16 values each, one every
+ *                frameStride bytes; framesOffset is page aligned and
+ *                frameStride a multiple of FFT_CAPTURE_ALIGN
+ *   indexOffset  frameCount uint64 start times, in ns from the start of
+ *                the capture, in increasing order
+ *
+ * Everything is little endian. fft_capture.py reads the same format.
+ */
+#ifndef FFT_CAPTURE_H
+#define FFT_CAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FFT_CAPTURE_MAGIC       "FCAP"
+#define FFT_CAPTURE_VERSION     1
+#define FFT_CAPTURE_ALIGN       64
+#define FFT_CAPTURE_PAGE        4096
+
+struct fft_capture_header {
+    char magic[4];              // FFT_CAPTURE_MAGIC
+    uint16_t version;           // FFT_CAPTURE_VERSION
+    uint16_t headerSize;        // sizeof(struct fft_capture_header)
+    uint32_t samples;           // N, samples per frame
+    uint32_t sampleRate;        // Hz
+    uint8_t qFormat;            // fractional bits of the samples, 12 for Q12
+    uint8_t reserved[3];
+    uint32_t frameStride;       // bytes from one frame to the next
+    uint64_t frameCount;
+    uint64_t framesOffset;
+    uint64_t indexOffset;
+    uint8_t pad[16];
+};
+
+typedef struct fft_capture fft_capture;
+typedef struct fft_capture_writer fft_capture_writer;
+
+/*
+ * Map a capture file read only. Returns NULL with errno set if it cannot
+ * be opened, or EINVAL if it is not a capture this code understands.
+ */
+fft_capture * fft_capture_open(const char * path);
+void fft_capture_close(fft_capture * cap);
+
+const struct fft_capture_header * fft_capture_info(const fft_capture * cap);
+
+/* samples of frame i, valid until fft_capture_close */
+const int16_t * fft_capture_frame(const fft_capture * cap, uint64_t i);
+
+/* start time of frame i in ns */
+uint64_t fft_capture_time(const fft_capture * cap, uint64_t i);
+
+/* first frame that starts at or after timeNs, frameCount if none */
+uint64_t fft_capture_find(const fft_capture * cap, uint64_t timeNs);
+
+/*
+ * Write a capture. Frames are appended in order; fft_capture_finish writes
+ * the index and the final header and closes the file. NULL or -1 with
+ * errno set on failure.
+ */
+fft_capture_writer * fft_capture_create(const char * path, uint32_t samples,
+                                        uint32_t sampleRate, uint8_t qFormat);
+int fft_capture_append(fft_capture_writer * w, const int16_t * frame, uint64_t timeNs);
+int fft_capture_finish(fft_capture_writer * w);
+
+#endif
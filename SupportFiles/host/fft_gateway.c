@@ -0,0 +1,816 @@
+/*
+ * fft_gateway - owns the serial links to one or more boards and shares
+ * them with any number of local clients over TCP and a Unix socket, so a
+ * plotter, a logger and an alarm service can all watch the same board.
+ *
+ * Clients send frames and receive every spectrum of every board:
+ *
+ *   client to gateway   'F', board (byte), count (word), count samples
+ *                       (words); count must be the board's N
+ *   gateway to client   struct fft_gateway_message, then bins values,
+ *                       int16 or float32 as valueType says
+ *
+ * All little endian. A frame is queued for its board, at most -q frames
+ * deep (further frames are dropped), and sent with the protocol of
+ * uart_FFT_kissFFT.c when the board is idle; plain, DIFF_OUTPUT,
+ * BFP_OUTPUT and float builds are all understood and published as plain
+ * spectra on the board's scale. With -f the gateway also feeds the frames
+ * of a capture file (csv2fcap) to the boards itself.
+ *
+ * Each spectrum is built once in a reference counted buffer; a client's
+ * queue holds pointers to those buffers and is written with writev, so
+ * fanning out to many clients copies nothing. A client's queue holds at
+ * most -q spectra. When it is full the policy (-p) drops the oldest
+ * spectrum not yet being written, drops the new one, or disconnects the
+ * client. Clients see drops as gaps in seq.
+ *
+ * With -m the spectra also go into a shared memory ring (fft_ring.h) for
+ * viewers on the same machine, which cost the gateway nothing however
+ * slowly they read. The ring holds float32 values if any board sends
+ * them, int16 otherwise.
+ *
+ * Everything runs in one thread around poll(). SIGINT or SIGTERM prints
+ * the counters and exits.
+ *
+ * Build from SupportFiles/host:
+ *   gcc -O2 -I. fft_gateway.c fft_capture.c fft_ring.c -lm -lrt -o fft_gateway
+ *
+ * Usage: fft_gateway [-n samples] [-s fs] [-b baud] [-t tcp port] [-u unix path]
+ *                    [-q depth] [-p oldest|newest|disconnect] [-f capture.fcap]
+ *                    [-m ring] device ...
+ * Defaults are 1024 points at 8192 Hz, 9600 baud, port 5555, depth 16,
+ * dropping the oldest. fft_sim gives boards on ptys for trying it out,
+ * and fft_gateway.py is a client.
+ */
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+#include "fft_capture.h"
+#include "fft_ring.h"
+
+#define MAX_DEVICES     8
+#define MAX_CLIENTS     64
+#define MAX_SAMPLES     1200
+#define REPLY_TIMEOUT_MS 5000
+
+/* as in uart_FFT_kissFFT.c */
+#define CAP_DIFF_OUTPUT         0x01
+#define CAP_BFP_OUTPUT          0x02
+#define CAP_FLOAT_OUTPUT        0x04
+
+#define VALUE_INT16     0
+#define VALUE_FLOAT32   1
+
+struct fft_gateway_message {
+    char type;                  // 'S'
+    uint8_t device;             // index of the board on the command line
+    uint8_t valueType;          // VALUE_INT16 or VALUE_FLOAT32
+    uint8_t reserved;
+    uint16_t samples;
+    uint16_t bins;
+    uint32_t seq;               // per board, gaps are spectra dropped for this client
+    uint32_t pad;
+    uint64_t timeNs;            // CLOCK_REALTIME when the spectrum was complete
+};
+
+typedef char fft_gateway_message_is_24_bytes[sizeof(struct fft_gateway_message) == 24 ? 1 : -1];
+
+/* one published spectrum, shared by every client queue it is on */
+struct message {
+    int refs;
+    size_t length;
+    unsigned char data[];
+};
+
+struct frame {
+    int16_t samples[MAX_SAMPLES];
+};
+
+struct device {
+    const char *path;
+    int fd;
+    uint8_t flags;
+    uint16_t samples;
+    /* frames waiting, a ring of queueDepth */
+    struct frame *frames;
+    int head, count;
+    /* the frame being sent, then the reply being read */
+    unsigned char out[1 + 2*MAX_SAMPLES];
+    size_t outLength, outDone;
+    int busy;
+    int dead;
+    uint64_t sentAt;
+    unsigned char reply[1 + 3 + 4*MAX_SAMPLES];
+    size_t replyLength;
+    int16_t last[MAX_SAMPLES/2];        // for DIFF_OUTPUT
+    int haveKey;
+    uint32_t seq;
+    unsigned long spectra, framesDropped, timeouts;
+};
+
+struct client {
+    int fd;
+    struct message **queue;             // ring of queueDepth
+    int head, count;
+    size_t offset;                      // bytes of the head message written
+    unsigned char in[4 + 2*MAX_SAMPLES];
+    size_t inLength;
+    unsigned long dropped, sent;
+};
+
+enum policy { DROP_OLDEST, DROP_NEWEST, DISCONNECT };
+
+static struct device devices[MAX_DEVICES];
+static int deviceCount;
+static struct client clients[MAX_CLIENTS];
+static int queueDepth = 16;
+static enum policy dropPolicy = DROP_OLDEST;
+static fft_ring *ring;
+static volatile sig_atomic_t stop;
+
+static uint64_t monotonicMs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static uint64_t realtimeNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static void onSignal(int sig)
+{
+    (void)sig;
+    stop = 1;
+}
+
+static uint16_t word(const unsigned char *p)
+{
+    return p[0] | (uint16_t)p[1] << 8;
+}
+
+/* ---- serial setup, blocking, before the loop starts ---- */
+
+static speed_t baudConstant(long baud)
+{
+    switch (baud) {
+    case 9600:   return B9600;
+    case 19200:  return B19200;
+    case 38400:  return B38400;
+    case 57600:  return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    default:     return 0;
+    }
+}
+
+static int writeAll(int fd, const void *data, size_t length)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    while (length) {
+        ssize_t n = write(fd, p, length);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN) {
+                struct pollfd pfd = { fd, POLLOUT, 0 };
+                poll(&pfd, 1, REPLY_TIMEOUT_MS);
+                continue;
+            }
+            return -1;
+        }
+        p += n;
+        length -= n;
+    }
+    return 0;
+}
+
+static int readExact(int fd, void *data, size_t length)
+{
+    unsigned char *p = (unsigned char *)data;
+    while (length) {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        ssize_t n;
+        if (poll(&pfd, 1, REPLY_TIMEOUT_MS) <= 0)
+            return -1;
+        n = read(fd, p, length);
+        if (n < 0 && (errno == EINTR || errno == EAGAIN))
+            continue;
+        if (n <= 0)
+            return -1;
+        p += n;
+        length -= n;
+    }
+    return 0;
+}
+
+/* 'N' or 'S' with a word, expecting 'A' and the same word back */
+static int setWord(struct device *d, char command, uint16_t value)
+{
+    unsigned char msg[3] = { (unsigned char)command, value & 0xFF, value >> 8 };
+    unsigned char reply[3];
+
+    if (writeAll(d->fd, msg, 3) != 0 || readExact(d->fd, reply, 1) != 0)
+        return -1;
+    if (reply[0] == 'E') {
+        readExact(d->fd, reply + 1, 1);
+        fprintf(stderr, "%s: '%c' %u refused with error %u\n", d->path, command, value, reply[1]);
+        return -1;
+    }
+    if (reply[0] != 'A' || readExact(d->fd, reply + 1, 2) != 0 || word(reply + 1) != value)
+        return -1;
+    return 0;
+}
+
+static int openDevice(struct device *d, long baud, uint16_t samples, uint16_t fs)
+{
+    unsigned char caps[10], plans[2*32];
+    struct termios tio;
+
+    d->fd = open(d->path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (d->fd < 0 || tcgetattr(d->fd, &tio) != 0) {
+        perror(d->path);
+        return -1;
+    }
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, baudConstant(baud));
+    cfsetospeed(&tio, baudConstant(baud));
+    tcsetattr(d->fd, TCSANOW, &tio);
+    tcflush(d->fd, TCIOFLUSH);
+
+    /* 'C', version, flags, N, fs, max fs, plan count, plans */
+    if (writeAll(d->fd, "?", 1) != 0 || readExact(d->fd, caps, 10) != 0 || caps[0] != 'C'
+            || caps[9] > 32 || readExact(d->fd, plans, 2*caps[9]) != 0) {
+        fprintf(stderr, "%s: no capabilities reply\n", d->path);
+        return -1;
+    }
+    d->flags = caps[2];
+    if (samples > MAX_SAMPLES || setWord(d, 'N', samples) != 0 || setWord(d, 'S', fs) != 0) {
+        fprintf(stderr, "%s: cannot set %u points at %u Hz\n", d->path, samples, fs);
+        return -1;
+    }
+    d->samples = samples;
+    d->frames = (struct frame *)malloc(sizeof(struct frame) * queueDepth);
+    return d->frames ? 0 : -1;
+}
+
+/* ---- publishing ---- */
+
+static void unref(struct message *m)
+{
+    if (--m->refs == 0)
+        free(m);
+}
+
+static void closeClient(struct client *c)
+{
+    while (c->count) {
+        unref(c->queue[c->head]);
+        c->head = (c->head + 1) % queueDepth;
+        c->count--;
+    }
+    fprintf(stderr, "client %d closed, %lu spectra sent, %lu dropped\n", c->fd, c->sent, c->dropped);
+    close(c->fd);
+    free(c->queue);
+    c->fd = -1;
+}
+
+static void enqueue(struct client *c, struct message *m)
+{
+    if (c->count == queueDepth) {
+        if (dropPolicy == DISCONNECT) {
+            closeClient(c);
+            return;
+        }
+        c->dropped++;
+        if (dropPolicy == DROP_NEWEST || (c->offset && c->count == 1))
+            return;
+        /* oldest not yet started: the head unless it is part written */
+        {
+            int victim = c->offset ? (c->head + 1) % queueDepth : c->head;
+            int i;
+            unref(c->queue[victim]);
+            for (i = victim; i != (c->head + c->count - 1) % queueDepth; i = (i + 1) % queueDepth)
+                c->queue[i] = c->queue[(i + 1) % queueDepth];
+            c->count--;
+        }
+    }
+    m->refs++;
+    c->queue[(c->head + c->count) % queueDepth] = m;
+    c->count++;
+}
+
+static void publish(struct device *d, const void *values, int valueType)
+{
+    size_t bins = d->samples / 2, size = valueType == VALUE_INT16 ? 2 : 4;
+    struct message *m = (struct message *)malloc(sizeof(*m) + sizeof(struct fft_gateway_message)
+                                                 + bins * size);
+    struct fft_gateway_message h;
+    int i;
+
+    if (m == NULL)
+        return;
+    memset(&h, 0, sizeof(h));
+    h.type = 'S';
+    h.device = (uint8_t)(d - devices);
+    h.valueType = (uint8_t)valueType;
+    h.samples = d->samples;
+    h.bins = (uint16_t)bins;
+    h.seq = d->seq++;
+    h.timeNs = realtimeNs();
+    m->refs = 1;
+    m->length = sizeof(h) + bins * size;
+    memcpy(m->data, &h, sizeof(h));
+    memcpy(m->data + sizeof(h), values, bins * size);
+
+    for (i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i].fd >= 0)
+            enqueue(&clients[i], m);
+    }
+    unref(m);
+    d->spectra++;
+
+    if (ring != NULL) {
+        float widened[MAX_SAMPLES/2];
+        size_t k;
+
+        if (fft_ring_info(ring)->valueType == FFT_RING_FLOAT32 && valueType == VALUE_INT16) {
+            for (k = 0; k < bins; k++)
+                widened[k] = ((const int16_t *)values)[k];
+            values = widened;
+        }
+        fft_ring_publish(ring, values, h.timeNs, h.device);
+    }
+}
+
+/* write as much of the queue as the socket takes, without copying */
+static void flushClient(struct client *c)
+{
+    while (c->count) {
+        struct iovec iov[16];
+        int n = 0, i = c->head;
+        ssize_t written;
+
+        while (n < c->count && n < 16) {
+            struct message *m = c->queue[i];
+            iov[n].iov_base = m->data + (n == 0 ? c->offset : 0);
+            iov[n].iov_len = m->length - (n == 0 ? c->offset : 0);
+            n++;
+            i = (i + 1) % queueDepth;
+        }
+        written = writev(c->fd, iov, n);
+        if (written < 0) {
+            if (errno == EAGAIN || errno == EINTR)
+                return;
+            closeClient(c);
+            return;
+        }
+        while (written > 0) {
+            struct message *m = c->queue[c->head];
+            size_t left = m->length - c->offset;
+            if ((size_t)written < left) {
+                c->offset += written;
+                break;
+            }
+            written -= left;
+            c->offset = 0;
+            unref(m);
+            c->head = (c->head + 1) % queueDepth;
+            c->count--;
+            c->sent++;
+        }
+    }
+}
+
+/* ---- boards ---- */
+
+static void queueFrame(struct device *d, const int16_t *samples)
+{
+    if (d->count == queueDepth) {
+        d->framesDropped++;
+        return;
+    }
+    memcpy(d->frames[(d->head + d->count) % queueDepth].samples, samples,
+           sizeof(int16_t) * d->samples);
+    d->count++;
+}
+
+static void startFrame(struct device *d)
+{
+    const int16_t *x = d->frames[d->head].samples;
+    int i;
+
+    d->out[0] = 'F';
+    for (i = 0; i < d->samples; i++) {
+        d->out[1 + 2*i] = (uint16_t)x[i] & 0xFF;
+        d->out[2 + 2*i] = (uint16_t)x[i] >> 8;
+    }
+    d->outLength = 1 + 2 * (size_t)d->samples;
+    d->outDone = 0;
+    d->replyLength = 0;
+    d->busy = 1;
+    d->sentAt = monotonicMs();
+    d->head = (d->head + 1) % queueDepth;
+    d->count--;
+}
+
+/*
+ * Decode the reply so far. Returns its length once it is complete and
+ * published, 0 if more bytes are needed, -1 if it makes no sense.
+ */
+static long decodeReply(struct device *d)
+{
+    const unsigned char *p = d->reply;
+    size_t have = d->replyLength, bins = d->samples / 2, k;
+
+    if (d->flags & CAP_FLOAT_OUTPUT) {
+        if (have < 4 * bins)
+            return 0;
+        publish(d, p, VALUE_FLOAT32);
+        return (long)(4 * bins);
+    }
+    if (d->flags & CAP_BFP_OUTPUT) {
+        float values[MAX_SAMPLES/2];
+        float scale;
+        if (have < 2 + 2 * bins)
+            return 0;
+        if (p[0] != 'B')
+            return -1;
+        scale = ldexpf(1.0f, (int8_t)p[1]) / d->samples;
+        for (k = 0; k < bins; k++)
+            values[k] = word(p + 2 + 2*k) * scale;
+        publish(d, values, VALUE_FLOAT32);
+        return (long)(2 + 2 * bins);
+    }
+    if (d->flags & CAP_DIFF_OUTPUT) {
+        size_t at, runs, r;
+        if (have < 1)
+            return 0;
+        if (p[0] == 'K') {
+            if (have < 1 + 2 * bins)
+                return 0;
+            for (k = 0; k < bins; k++)
+                d->last[k] = (int16_t)word(p + 1 + 2*k);
+            d->haveKey = 1;
+            publish(d, d->last, VALUE_INT16);
+            return (long)(1 + 2 * bins);
+        }
+        if (p[0] != 'D' || !d->haveKey)
+            return -1;
+        /* walk the runs to find the end before changing anything */
+        if (have < 3)
+            return 0;
+        runs = word(p + 1);
+        at = 3;
+        for (r = 0; r < runs; r++) {
+            if (have < at + 4)
+                return 0;
+            if (word(p + at) + (size_t)word(p + at + 2) > bins)
+                return -1;
+            at += 4 + 2 * (size_t)word(p + at + 2);
+        }
+        if (have < at)
+            return 0;
+        at = 3;
+        for (r = 0; r < runs; r++) {
+            size_t start = word(p + at), length = word(p + at + 2);
+            for (k = 0; k < length; k++)
+                d->last[start + k] = (int16_t)word(p + at + 4 + 2*k);
+            at += 4 + 2 * length;
+        }
+        publish(d, d->last, VALUE_INT16);
+        return (long)at;
+    }
+    if (have < 2 * bins)
+        return 0;
+    {
+        int16_t values[MAX_SAMPLES/2];
+        for (k = 0; k < bins; k++)
+            values[k] = (int16_t)word(p + 2*k);
+        publish(d, values, VALUE_INT16);
+    }
+    return (long)(2 * bins);
+}
+
+static void loseDevice(struct device *d)
+{
+    fprintf(stderr, "%s: link lost\n", d->path);
+    close(d->fd);
+    d->dead = 1;
+    d->busy = 0;
+}
+
+static void readDevice(struct device *d)
+{
+    ssize_t n = read(d->fd, d->reply + d->replyLength, sizeof(d->reply) - d->replyLength);
+    long done;
+
+    if (n <= 0) {
+        if (n < 0 && (errno == EAGAIN || errno == EINTR))
+            return;
+        loseDevice(d);
+        return;
+    }
+    if (!d->busy)
+        return;                         // nothing was asked, ignore it
+    d->replyLength += n;
+    done = decodeReply(d);
+    if (done < 0) {
+        fprintf(stderr, "%s: reply does not decode, resynchronising\n", d->path);
+        d->haveKey = 0;
+        tcflush(d->fd, TCIFLUSH);
+        d->busy = 0;
+    } else if (done > 0) {
+        d->busy = 0;
+    }
+}
+
+static void writeDevice(struct device *d)
+{
+    ssize_t n = write(d->fd, d->out + d->outDone, d->outLength - d->outDone);
+    if (n > 0)
+        d->outDone += n;
+    else if (n < 0 && errno != EAGAIN && errno != EINTR)
+        loseDevice(d);
+}
+
+/* ---- clients ---- */
+
+static void readClient(struct client *c)
+{
+    ssize_t n = read(c->fd, c->in + c->inLength, sizeof(c->in) - c->inLength);
+
+    if (n <= 0) {
+        if (n < 0 && (errno == EAGAIN || errno == EINTR))
+            return;
+        closeClient(c);
+        return;
+    }
+    c->inLength += n;
+
+    /* 'F', board, count, samples */
+    while (c->inLength >= 4) {
+        unsigned board = c->in[1], count = word(c->in + 2);
+        size_t length = 4 + 2 * (size_t)count;
+        int16_t samples[MAX_SAMPLES];
+        unsigned i;
+
+        if (c->in[0] != 'F' || board >= (unsigned)deviceCount || count != devices[board].samples) {
+            fprintf(stderr, "client %d sent a bad frame, closing\n", c->fd);
+            closeClient(c);
+            return;
+        }
+        if (c->inLength < length)
+            return;
+        for (i = 0; i < count; i++)
+            samples[i] = (int16_t)word(c->in + 4 + 2*i);
+        queueFrame(&devices[board], samples);
+        memmove(c->in, c->in + length, c->inLength - length);
+        c->inLength -= length;
+    }
+}
+
+static void acceptClient(int listener)
+{
+    int fd = accept(listener, NULL, NULL);
+    int sendBuffer = 16384, i;
+
+    if (fd < 0)
+        return;
+    for (i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i].fd < 0)
+            break;
+    }
+    if (i == MAX_CLIENTS || (clients[i].queue = calloc(queueDepth, sizeof(struct message *))) == NULL) {
+        close(fd);
+        return;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    /* keep the kernel's share of the backlog small, so the queue and the
+       drop policy decide what a slow client gets */
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer));
+    clients[i].fd = fd;
+    clients[i].head = clients[i].count = 0;
+    clients[i].offset = clients[i].inLength = 0;
+    clients[i].dropped = clients[i].sent = 0;
+    fprintf(stderr, "client %d connected\n", fd);
+}
+
+static int listenTcp(int port)
+{
+    struct sockaddr_in addr;
+    int one = 1, fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);      // local clients only
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0) {
+        perror("tcp");
+        return -1;
+    }
+    return fd;
+}
+
+static int listenUnix(const char *path)
+{
+    struct sockaddr_un addr;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+    unlink(path);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0) {
+        perror(path);
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, char *argv[])
+{
+    int samples = 1024, fs = 8192, port = 5555, arg, i;
+    long baud = 9600;
+    const char *unixPath = NULL, *capturePath = NULL, *ringName = NULL;
+    fft_capture *cap = NULL;
+    uint64_t nextCaptureFrame = 0;
+    int listeners[2] = { -1, -1 };
+
+    for (arg = 1; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+        const char *v = argv[arg + 1];
+        switch (argv[arg][1]) {
+        case 'n': samples = atoi(v); break;
+        case 's': fs = atoi(v); break;
+        case 'b': baud = atol(v); break;
+        case 't': port = atoi(v); break;
+        case 'u': unixPath = v; break;
+        case 'q': queueDepth = atoi(v); break;
+        case 'f': capturePath = v; break;
+        case 'm': ringName = v; break;
+        case 'p':
+            dropPolicy = strcmp(v, "newest") == 0 ? DROP_NEWEST
+                       : strcmp(v, "disconnect") == 0 ? DISCONNECT : DROP_OLDEST;
+            break;
+        default: arg = argc; break;
+        }
+    }
+    deviceCount = argc - arg;
+    if (deviceCount < 1 || deviceCount > MAX_DEVICES || queueDepth < 1
+            || baudConstant(baud) == 0 || samples < 2 || samples > MAX_SAMPLES) {
+        fprintf(stderr, "usage: fft_gateway [-n samples] [-s fs] [-b baud] [-t tcp port] [-u unix path]\n"
+                        "                   [-q depth] [-p oldest|newest|disconnect] [-f capture.fcap]\n"
+                        "                   [-m ring] device ...\n");
+        return 1;
+    }
+
+    for (i = 0; i < MAX_CLIENTS; i++)
+        clients[i].fd = -1;
+    for (i = 0; i < deviceCount; i++) {
+        devices[i].path = argv[arg + i];
+        if (openDevice(&devices[i], baud, (uint16_t)samples, (uint16_t)fs) != 0)
+            return 1;
+    }
+    if (capturePath != NULL) {
+        cap = fft_capture_open(capturePath);
+        if (cap == NULL || fft_capture_info(cap)->samples != (uint32_t)samples) {
+            fprintf(stderr, "%s: no capture of %d samples\n", capturePath, samples);
+            return 1;
+        }
+    }
+    if (ringName != NULL) {
+        uint8_t type = FFT_RING_INT16;
+        for (i = 0; i < deviceCount; i++) {
+            if (devices[i].flags & (CAP_BFP_OUTPUT | CAP_FLOAT_OUTPUT))
+                type = FFT_RING_FLOAT32;
+        }
+        ring = fft_ring_create(ringName, 64, samples, fs, samples / 2, type);
+        if (ring == NULL) {
+            perror(ringName);
+            return 1;
+        }
+    }
+    if (port > 0 && (listeners[0] = listenTcp(port)) < 0)
+        return 1;
+    if (unixPath != NULL && (listeners[1] = listenUnix(unixPath)) < 0)
+        return 1;
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    fprintf(stderr, "serving %d boards\n", deviceCount);
+
+    while (!stop) {
+        struct pollfd pfd[2 + MAX_DEVICES + MAX_CLIENTS];
+        int owner[2 + MAX_DEVICES + MAX_CLIENTS];
+        int n = 0;
+        uint64_t now = monotonicMs();
+        int live = 0;
+
+        for (i = 0; i < deviceCount; i++) {
+            struct device *d = &devices[i];
+
+            if (d->dead)
+                continue;
+            live++;
+
+            /* the capture feeds any board with nothing else to do */
+            if (cap != NULL && !d->busy && d->count == 0
+                    && nextCaptureFrame < fft_capture_info(cap)->frameCount) {
+                queueFrame(d, fft_capture_frame(cap, nextCaptureFrame++));
+            }
+            if (d->busy && now - d->sentAt > REPLY_TIMEOUT_MS) {
+                fprintf(stderr, "%s: no reply, frame dropped\n", d->path);
+                d->timeouts++;
+                d->busy = 0;
+                d->haveKey = 0;
+                /* a late reply would be taken for the next one */
+                tcflush(d->fd, TCIFLUSH);
+            }
+            if (!d->busy && d->count)
+                startFrame(d);
+            pfd[n].fd = d->fd;
+            pfd[n].events = POLLIN | (d->busy && d->outDone < d->outLength ? POLLOUT : 0);
+            owner[n++] = -1 - i;
+        }
+        if (live == 0) {
+            fprintf(stderr, "no board left\n");
+            break;
+        }
+        for (i = 0; i < 2; i++) {
+            if (listeners[i] >= 0) {
+                pfd[n].fd = listeners[i];
+                pfd[n].events = POLLIN;
+                owner[n++] = -100 - i;
+            }
+        }
+        for (i = 0; i < MAX_CLIENTS; i++) {
+            if (clients[i].fd >= 0) {
+                pfd[n].fd = clients[i].fd;
+                pfd[n].events = POLLIN | (clients[i].count ? POLLOUT : 0);
+                owner[n++] = i;
+            }
+        }
+
+        if (poll(pfd, n, 100) < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("poll");
+            break;
+        }
+        for (i = 0; i < n; i++) {
+            if (pfd[i].revents == 0)
+                continue;
+            if (owner[i] <= -100) {
+                acceptClient(pfd[i].fd);
+            } else if (owner[i] < 0) {
+                struct device *d = &devices[-1 - owner[i]];
+                if (pfd[i].revents & POLLOUT)
+                    writeDevice(d);
+                if (!d->dead && (pfd[i].revents & (POLLIN | POLLHUP | POLLERR)))
+                    readDevice(d);
+            } else {
+                struct client *c = &clients[owner[i]];
+                if (c->fd >= 0 && (pfd[i].revents & POLLOUT))
+                    flushClient(c);
+                if (c->fd >= 0 && (pfd[i].revents & (POLLIN | POLLHUP | POLLERR)))
+                    readClient(c);
+            }
+        }
+    }
+
+    for (i = 0; i < deviceCount; i++) {
+        fprintf(stderr, "%s: %lu spectra, %lu frames dropped, %lu timeouts\n", devices[i].path,
+                devices[i].spectra, devices[i].framesDropped, devices[i].timeouts);
+    }
+    for (i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i].fd >= 0)
+            closeClient(&clients[i]);
+    }
+    if (unixPath != NULL)
+        unlink(unixPath);
+    fft_capture_close(cap);
+    fft_ring_close(ring);
+    return 0;
+}
@@ -0,0 +1,172 @@
+/*
+ * fft_large_bench - recursive kiss_fft against the Stockham kiss_ffts and
+ * the task parallel kiss_fftp for large complex transforms on the host, in
+ * single precision float.
+ *
+ * For each size it prints
+ *   kiss us     kiss_fft out of place, plan made once
+ *   ffts us     kiss_ffts out of place, plan from the cache
+ *   in place    kiss_ffts with fin == fout
+ *   par us      kiss_fftp on a pool of the given number of threads
+ *   speedup     kiss us / ffts us
+ *   par x       ffts us / par us
+ *   max diff    largest difference from the kiss_fft result, relative to
+ *               the largest output value
+ *
+ * Times are the best of a few batches, see fft_bench.c.
+ *
+ * Build from SupportFiles/host:
+ *   gcc -O2 -DKISS_FFT_FLOAT -I. -I../../uart_FFT_kissFFT/kissFFT
+ *       fft_large_bench.c kiss_ffts.c kiss_fftp.c fft_pool.c
+ *       fft_plan_cache.c ../../uart_FFT_kissFFT/kissFFT/kiss_fft.c
+ *       -lm -lpthread -o fft_large_bench
+ *
+ * Usage: fft_large_bench [-t threads] [size ...]
+ * threads defaults to one per online CPU.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "kiss_fft.h"
+#include "kiss_ffts.h"
+#include "kiss_fftp.h"
+
+static const int defaultSizes[] = {
+    256, 1024, 4096, 16384, 65536, 262144, 1048576, 4194304,
+    1000, 6000, 48000, 100000, 3*65536, 5*5*5*4096,
+};
+#define DEFAULT_SIZE_COUNT  (sizeof(defaultSizes)/sizeof(defaultSizes[0]))
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* bigger frames get fewer, longer batches so the whole run stays short */
+#define TIME_RUN(perFrame, call)                                \
+    do {                                                        \
+        int batch_;                                             \
+        perFrame = INFINITY;                                    \
+        for (batch_ = 0; batch_ < 5; batch_++) {                \
+            long runs_ = 0;                                     \
+            double start_ = now(), elapsed_;                    \
+            do {                                                \
+                call;                                           \
+                runs_++;                                        \
+                elapsed_ = now() - start_;                      \
+            } while (elapsed_ < 0.05);                          \
+            if (elapsed_ / runs_ < perFrame)                    \
+                perFrame = elapsed_ / runs_;                    \
+        }                                                       \
+    } while (0)
+
+static fft_pool *pool;
+
+static void bench(int n)
+{
+    kiss_fft_cpx *in = malloc(sizeof(kiss_fft_cpx) * n);
+    kiss_fft_cpx *ref = malloc(sizeof(kiss_fft_cpx) * n);
+    kiss_fft_cpx *out = malloc(sizeof(kiss_fft_cpx) * n);
+    kiss_fft_cpx *inplace = malloc(sizeof(kiss_fft_cpx) * n);
+    kiss_fft_cpx *work = malloc(sizeof(kiss_fft_cpx) * n);
+    kiss_fft_cfg kcfg = kiss_fft_alloc(n, 0, NULL, NULL);
+    kiss_fft_cpx *par = malloc(sizeof(kiss_fft_cpx) * n);
+    kiss_ffts_cfg scfg = kiss_ffts_plan(n, 0);
+    kiss_fftp_cfg pcfg = kiss_fftp_plan(n, 0);
+    double tKiss, tStock, tInplace, tPar, peak = 0, diff = 0;
+    int i;
+
+    if (in == NULL || ref == NULL || out == NULL || inplace == NULL
+            || work == NULL || par == NULL || kcfg == NULL) {
+        printf("%9d  out of memory\n", n);
+        goto done;
+    }
+    if (scfg == NULL || pcfg == NULL) {
+        printf("%9d  prime factor too large for kiss_ffts\n", n);
+        goto done;
+    }
+
+    srand(1);
+    for (i = 0; i < n; i++) {
+        in[i].r = (float)rand() / RAND_MAX - 0.5f;
+        in[i].i = (float)rand() / RAND_MAX - 0.5f;
+    }
+
+    kiss_fft(kcfg, in, ref);
+    kiss_ffts_work(scfg, in, out, work);
+    for (i = 0; i < n; i++)
+        inplace[i] = in[i];
+    kiss_ffts_work(scfg, inplace, inplace, work);
+    if (kiss_fftp(pcfg, pool, in, par) != 0) {
+        printf("%9d  out of memory\n", n);
+        goto done;
+    }
+
+    for (i = 0; i < n; i++) {
+        double m = hypot(ref[i].r, ref[i].i);
+        double d1 = hypot(out[i].r - ref[i].r, out[i].i - ref[i].i);
+        double d2 = hypot(inplace[i].r - ref[i].r, inplace[i].i - ref[i].i);
+        double d3 = hypot(par[i].r - ref[i].r, par[i].i - ref[i].i);
+        if (m > peak)
+            peak = m;
+        if (d1 > diff)
+            diff = d1;
+        if (d2 > diff)
+            diff = d2;
+        if (d3 > diff)
+            diff = d3;
+    }
+
+    TIME_RUN(tKiss, kiss_fft(kcfg, in, out));
+    TIME_RUN(tStock, kiss_ffts_work(scfg, in, out, work));
+    TIME_RUN(tInplace, kiss_ffts_work(scfg, inplace, inplace, work));
+    TIME_RUN(tPar, kiss_fftp(pcfg, pool, in, par));
+
+    printf("%9d %11.1f %11.1f %11.1f %11.1f %8.2f %7.2f %10.1e\n", n,
+           1e6 * tKiss, 1e6 * tStock, 1e6 * tInplace, 1e6 * tPar,
+           tKiss / tStock, tStock / tPar, diff / peak);
+
+done:
+    free(in);
+    free(ref);
+    free(out);
+    free(inplace);
+    free(work);
+    free(par);
+    free(kcfg);
+}
+
+int main(int argc, char *argv[])
+{
+    int threads = 0, first = 1;
+    unsigned i;
+
+    if (argc > 2 && strcmp(argv[1], "-t") == 0) {
+        threads = atoi(argv[2]);
+        first = 3;
+    }
+    pool = fft_pool_create(threads);
+    if (pool == NULL) {
+        fprintf(stderr, "could not start the thread pool\n");
+        return 1;
+    }
+
+    printf("%d threads\n\n", fft_pool_threads(pool));
+    printf("%9s %11s %11s %11s %11s %8s %7s %10s\n", "N", "kiss us",
+           "ffts us", "in place", "par us", "speedup", "par x", "max diff");
+    if (argc > first) {
+        for (i = first; i < (unsigned)argc; i++)
+            bench(atoi(argv[i]));
+    } else {
+        for (i = 0; i < DEFAULT_SIZE_COUNT; i++)
+            bench(defaultSizes[i]);
+    }
+    fft_pool_destroy(pool);
+    kiss_ffts_cleanup();
+    return 0;
+}
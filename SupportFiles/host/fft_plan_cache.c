@@ -0,0 +1,90 @@
+/*
+ * Plan cache, see fft_plan_cache.h. A short list is enough: tools use a
+ * handful of sizes, and the lookup happens once per batch, not per frame.
+ */
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "fft_plan_cache.h"
+
+struct fft_plan_entry {
+    int nfft;
+    int inverse;
+    int scalar;
+    fft_plan_build build;
+    void * plan;
+    fft_plan_free destroy;
+    struct fft_plan_entry * next;
+};
+
+static struct fft_plan_entry * plans = NULL;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* call with the lock held */
+static void * lookup(int nfft, int inverse, int scalar, fft_plan_build build)
+{
+    struct fft_plan_entry * e;
+
+    for (e = plans; e != NULL; e = e->next) {
+        if (e->nfft == nfft && e->inverse == inverse && e->scalar == scalar
+                && e->build == build)
+            return e->plan;
+    }
+    return NULL;
+}
+
+void * fft_plan_cache_get(int nfft, int inverse, int scalar,
+                          fft_plan_build build, fft_plan_free destroy)
+{
+    struct fft_plan_entry * e;
+    void * plan, * cached;
+
+    inverse = inverse != 0;
+
+    pthread_mutex_lock(&lock);
+    plan = lookup(nfft, inverse, scalar, build);
+    pthread_mutex_unlock(&lock);
+    if (plan != NULL)
+        return plan;
+
+    /* Built without the lock, as a plan may be made of cached plans itself.
+       If another thread got there first, its plan is kept. */
+    plan = build(nfft, inverse);
+    if (plan == NULL)
+        return NULL;
+    e = (struct fft_plan_entry *)malloc(sizeof(*e));
+
+    pthread_mutex_lock(&lock);
+    cached = lookup(nfft, inverse, scalar, build);
+    if (cached == NULL && e != NULL) {
+        e->nfft = nfft;
+        e->inverse = inverse;
+        e->scalar = scalar;
+        e->build = build;
+        e->plan = plan;
+        e->destroy = destroy;
+        e->next = plans;
+        plans = e;
+        e = NULL;
+    }
+    pthread_mutex_unlock(&lock);
+
+    if (e != NULL || cached != NULL) {
+        free(e);
+        destroy(plan);
+        plan = cached;
+    }
+    return plan;
+}
+
+void fft_plan_cache_clear(void)
+{
+    pthread_mutex_lock(&lock);
+    while (plans != NULL) {
+        struct fft_plan_entry * e = plans;
+        plans = e->next;
+        e->destroy(e->plan);
+        free(e);
+    }
+    pthread_mutex_unlock(&lock);
+}
@@ -0,0 +1,32 @@
+/*
+ * Process wide cache of FFT plans for the host tools.
+ *
+ * Plans are looked up by (nfft, direction, scalar type, build function),
+ * built on first use and kept until fft_plan_cache_clear. The build
+ * function tells apart the engines that share a scalar type. A cached plan
+ * must be treated as read only, so any number of threads can share it.
+ */
+#ifndef FFT_PLAN_CACHE_H
+#define FFT_PLAN_CACHE_H
+
+/* Scalar type part of the key; each engine build passes its own */
+#define FFT_SCALAR_Q15      1
+#define FFT_SCALAR_Q31      2
+#define FFT_SCALAR_FLOAT    3
+#define FFT_SCALAR_DOUBLE   4
+
+typedef void * (*fft_plan_build)(int nfft, int inverse);
+typedef void (*fft_plan_free)(void * plan);
+
+/*
+ * Return the cached plan for the key, building it with build() if there
+ * is none yet. destroy() is kept for fft_plan_cache_clear. Returns NULL
+ * if build() does, without caching anything.
+ */
+void * fft_plan_cache_get(int nfft, int inverse, int scalar,
+                          fft_plan_build build, fft_plan_free destroy);
+
+/* Free every cached plan. No plan from the cache may be in use. */
+void fft_plan_cache_clear(void);
+
+#endif
@@ -0,0 +1,253 @@
+/*
+ * Work stealing pool, see fft_pool.h. Tasks are coarse (whole sub
+ * transforms or thousands of butterflies), so each deque is a ring behind
+ * its own mutex rather than a lock free deque. Thieves peek at head and
+ * tail without the lock, so those are written with atomic stores even
+ * though only the lock holder writes them.
+ */
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "fft_pool.h"
+
+#define DEQUE_SIZE      1024            // power of 2
+
+struct fft_task {
+    fft_task_fn fn;
+    void * arg;
+    fft_task_group * group;
+};
+
+struct fft_deque {
+    pthread_mutex_t lock;
+    unsigned head;                      // next to steal
+    unsigned tail;                      // next free slot
+    struct fft_task tasks[DEQUE_SIZE];
+};
+
+struct fft_pool {
+    int threads;
+    struct fft_deque * deques;          // one per thread, [0] for non workers
+    pthread_t * workers;                // threads - 1 of them
+    int started;
+
+    pthread_mutex_t idleLock;
+    pthread_cond_t idle;
+    int sleeping;
+    int stop;
+    int queued;                         // tasks in all deques
+};
+
+/* the pool and deque of the current thread, if it is a worker */
+static __thread fft_pool * selfPool;
+static __thread int selfIndex;
+
+struct fft_worker_start {
+    fft_pool * pool;
+    int index;
+};
+
+static int takeTask(fft_pool * pool, int index, struct fft_task * task)
+{
+    int i;
+
+    /* own deque from the back */
+    {
+        struct fft_deque * d = &pool->deques[index];
+        pthread_mutex_lock(&d->lock);
+        if (d->tail != d->head) {
+            unsigned tail = d->tail - 1;
+            *task = d->tasks[tail % DEQUE_SIZE];
+            __atomic_store_n(&d->tail, tail, __ATOMIC_RELAXED);
+            pthread_mutex_unlock(&d->lock);
+            __atomic_sub_fetch(&pool->queued, 1, __ATOMIC_RELAXED);
+            return 1;
+        }
+        pthread_mutex_unlock(&d->lock);
+    }
+
+    /* the others from the front */
+    for (i = 1; i < pool->threads; i++) {
+        struct fft_deque * d = &pool->deques[(index + i) % pool->threads];
+        if (__atomic_load_n(&d->tail, __ATOMIC_RELAXED)
+                == __atomic_load_n(&d->head, __ATOMIC_RELAXED))
+            continue;
+        pthread_mutex_lock(&d->lock);
+        if (d->tail != d->head) {
+            *task = d->tasks[d->head % DEQUE_SIZE];
+            __atomic_store_n(&d->head, d->head + 1, __ATOMIC_RELAXED);
+            pthread_mutex_unlock(&d->lock);
+            __atomic_sub_fetch(&pool->queued, 1, __ATOMIC_RELAXED);
+            return 1;
+        }
+        pthread_mutex_unlock(&d->lock);
+    }
+    return 0;
+}
+
+static void runTask(const struct fft_task * task)
+{
+    task->fn(task->arg);
+    __atomic_sub_fetch(&task->group->pending, 1, __ATOMIC_RELEASE);
+}
+
+static void * workerMain(void * arg)
+{
+    struct fft_worker_start * start = (struct fft_worker_start *)arg;
+    fft_pool * pool = start->pool;
+    int index = start->index;
+    struct fft_task task;
+
+    free(start);
+    selfPool = pool;
+    selfIndex = index;
+
+    for (;;) {
+        if (takeTask(pool, index, &task)) {
+            runTask(&task);
+            continue;
+        }
+        /* sleeping goes up before queued is checked, and fft_pool_spawn
+           raises queued before checking sleeping: one of them sees the other */
+        pthread_mutex_lock(&pool->idleLock);
+        __atomic_add_fetch(&pool->sleeping, 1, __ATOMIC_SEQ_CST);
+        while (!pool->stop && __atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST) == 0)
+            pthread_cond_wait(&pool->idle, &pool->idleLock);
+        __atomic_sub_fetch(&pool->sleeping, 1, __ATOMIC_SEQ_CST);
+        if (pool->stop) {
+            pthread_mutex_unlock(&pool->idleLock);
+            break;
+        }
+        pthread_mutex_unlock(&pool->idleLock);
+    }
+    return NULL;
+}
+
+fft_pool * fft_pool_create(int threads)
+{
+    fft_pool * pool;
+    int i;
+
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+
+    pool = (fft_pool *)calloc(1, sizeof(*pool));
+    if (pool == NULL)
+        return NULL;
+    pool->threads = threads;
+    pool->deques = (struct fft_deque *)calloc(threads, sizeof(struct fft_deque));
+    pool->workers = (pthread_t *)calloc(threads, sizeof(pthread_t));
+    if (pool->deques == NULL || pool->workers == NULL) {
+        /* no locks to destroy yet */
+        free(pool->deques);
+        free(pool->workers);
+        free(pool);
+        return NULL;
+    }
+    for (i = 0; i < threads; i++)
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+    pthread_mutex_init(&pool->idleLock, NULL);
+    pthread_cond_init(&pool->idle, NULL);
+
+    for (i = 1; i < threads; i++) {
+        struct fft_worker_start * start = malloc(sizeof(*start));
+        if (start == NULL)
+            break;
+        start->pool = pool;
+        start->index = i;
+        if (pthread_create(&pool->workers[i - 1], NULL, workerMain, start) != 0) {
+            free(start);
+            break;
+        }
+        pool->started++;
+    }
+    if (pool->started != threads - 1) {
+        fft_pool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void fft_pool_destroy(fft_pool * pool)
+{
+    int i;
+
+    if (pool == NULL)
+        return;
+    if (pool->started > 0) {
+        pthread_mutex_lock(&pool->idleLock);
+        pool->stop = 1;
+        pthread_cond_broadcast(&pool->idle);
+        pthread_mutex_unlock(&pool->idleLock);
+        for (i = 0; i < pool->started; i++)
+            pthread_join(pool->workers[i], NULL);
+    }
+    if (pool->deques != NULL) {
+        for (i = 0; i < pool->threads; i++)
+            pthread_mutex_destroy(&pool->deques[i].lock);
+        pthread_mutex_destroy(&pool->idleLock);
+        pthread_cond_destroy(&pool->idle);
+    }
+    free(pool->deques);
+    free(pool->workers);
+    free(pool);
+}
+
+int fft_pool_threads(const fft_pool * pool)
+{
+    return pool->threads;
+}
+
+void fft_pool_spawn(fft_pool * pool, fft_task_group * group,
+                    fft_task_fn fn, void * arg)
+{
+    int index = selfPool == pool ? selfIndex : 0;
+    struct fft_deque * d = &pool->deques[index];
+    int full;
+
+    __atomic_add_fetch(&group->pending, 1, __ATOMIC_RELAXED);
+
+    pthread_mutex_lock(&d->lock);
+    full = d->tail - d->head == DEQUE_SIZE;
+    if (!full) {
+        struct fft_task * task = &d->tasks[d->tail % DEQUE_SIZE];
+        task->fn = fn;
+        task->arg = arg;
+        task->group = group;
+        __atomic_store_n(&d->tail, d->tail + 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+    }
+    pthread_mutex_unlock(&d->lock);
+
+    if (full) {
+        struct fft_task task;
+        task.fn = fn;
+        task.arg = arg;
+        task.group = group;
+        runTask(&task);
+        return;
+    }
+
+    if (__atomic_load_n(&pool->sleeping, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&pool->idleLock);
+        pthread_cond_signal(&pool->idle);
+        pthread_mutex_unlock(&pool->idleLock);
+    }
+}
+
+void fft_pool_wait(fft_pool * pool, fft_task_group * group)
+{
+    int index = selfPool == pool ? selfIndex : 0;
+    struct fft_task task;
+
+    while (__atomic_load_n(&group->pending, __ATOMIC_ACQUIRE) > 0) {
+        if (takeTask(pool, index, &task))
+            runTask(&task);
+        else
+            sched_yield();
+    }
+}
@@ -0,0 +1,50 @@
+/*
+ * Work stealing thread pool for the host tools.
+ *
+ * Every worker has a deque of tasks. It pushes and pops its own tasks at
+ * the back, so it carries on with the task it spawned last while the data
+ * is still in its cache; idle workers steal from the front, where the
+ * oldest and usually largest tasks are. Threads that are not workers of
+ * the pool, such as the one that created it, push onto the first deque.
+ *
+ * A thread waiting for a group runs tasks itself until the group is done,
+ * so tasks can spawn subtasks and wait for them to any depth without
+ * blocking a worker.
+ */
+#ifndef FFT_POOL_H
+#define FFT_POOL_H
+
+typedef struct fft_pool fft_pool;
+typedef void (*fft_task_fn)(void * arg);
+
+/* Tasks a thread waits for together; start each group at FFT_TASK_GROUP_INIT */
+typedef struct {
+    int pending;
+} fft_task_group;
+#define FFT_TASK_GROUP_INIT     {0}
+
+/*
+ * Start a pool for threads threads, or one per online CPU for 0. The count
+ * includes the thread that waits, so threads - 1 workers are started and
+ * fft_pool_create(1) runs every task in fft_pool_wait.
+ * Returns NULL if the workers could not be started.
+ */
+fft_pool * fft_pool_create(int threads);
+
+/* Stop and join the workers. No task may be pending. */
+void fft_pool_destroy(fft_pool * pool);
+
+/* number of threads, including the waiting one */
+int fft_pool_threads(const fft_pool * pool);
+
+/*
+ * Queue fn(arg) as part of group. arg must stay valid until the group has
+ * been waited for. If the deque is full the task runs at once instead.
+ */
+void fft_pool_spawn(fft_pool * pool, fft_task_group * group,
+                    fft_task_fn fn, void * arg);
+
+/* Run tasks until every task of group has finished */
+void fft_pool_wait(fft_pool * pool, fft_task_group * group);
+
+#endif
@@ -0,0 +1,217 @@
+/*
+ * Shared memory ring of spectra, see fft_ring.h.
+ */
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "fft_ring.h"
+
+typedef char fft_ring_header_is_64_bytes[sizeof(struct fft_ring_header) == 64 ? 1 : -1];
+
+struct fft_ring {
+    unsigned char * map;
+    size_t length;
+    const struct fft_ring_header * header;
+    uint64_t * head;
+    size_t valueBytes;
+    char name[64];              // set for the writer, which removes it
+};
+
+static size_t valueSize(uint8_t valueType)
+{
+    return valueType == FFT_RING_INT16 ? 2 : valueType == FFT_RING_FLOAT32 ? 4 : 0;
+}
+
+static int shmName(char * out, size_t size, const char * name)
+{
+    return snprintf(out, size, "/%s", name) < (int)size ? 0 : -1;
+}
+
+static size_t ringLength(uint32_t slots, uint32_t slotStride)
+{
+    return FFT_RING_PAGE + (size_t)slots * slotStride;
+}
+
+static unsigned char * slot(const fft_ring * ring, uint64_t n)
+{
+    return ring->map + FFT_RING_PAGE + (n % ring->header->slots) * ring->header->slotStride;
+}
+
+fft_ring * fft_ring_create(const char * name, uint32_t slots, uint32_t samples,
+                           uint32_t sampleRate, uint32_t bins, uint8_t valueType)
+{
+    struct fft_ring_header h;
+    struct timespec ts;
+    fft_ring * ring;
+    size_t size = valueSize(valueType);
+    void * map;
+    int fd, err;
+
+    if (size == 0 || slots == 0 || bins == 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    ring = (fft_ring *)calloc(1, sizeof(*ring));
+    if (ring == NULL)
+        return NULL;
+    if (shmName(ring->name, sizeof(ring->name), name) != 0) {
+        free(ring);
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, FFT_RING_MAGIC, 4);
+    h.version = FFT_RING_VERSION;
+    h.headerSize = sizeof(h);
+    h.slots = slots;
+    h.slotStride = (uint32_t)((FFT_RING_SLOT_HEADER + bins * size + 63) / 64 * 64);
+    h.samples = samples;
+    h.bins = bins;
+    h.valueType = valueType;
+    h.sampleRate = sampleRate;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    h.epoch = (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+
+    /* a new object, so readers of an old ring keep theirs until they reopen */
+    shm_unlink(ring->name);
+    fd = shm_open(ring->name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        free(ring);
+        return NULL;
+    }
+    ring->length = ringLength(h.slots, h.slotStride);
+    if (ftruncate(fd, ring->length) != 0
+            || (map = mmap(NULL, ring->length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0))
+               == MAP_FAILED) {
+        err = errno;
+        close(fd);
+        shm_unlink(ring->name);
+        free(ring);
+        errno = err;
+        return NULL;
+    }
+    close(fd);
+
+    ring->map = (unsigned char *)map;
+    memcpy(ring->map, &h, sizeof(h));
+    ring->header = (const struct fft_ring_header *)ring->map;
+    ring->head = (uint64_t *)(ring->map + 64);
+    ring->valueBytes = bins * size;
+    return ring;
+}
+
+fft_ring * fft_ring_open(const char * name)
+{
+    const struct fft_ring_header * h;
+    char shm[64];
+    fft_ring * ring;
+    struct stat st;
+    void * map;
+    int fd, err;
+
+    if (shmName(shm, sizeof(shm), name) != 0) {
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
+    fd = shm_open(shm, O_RDONLY, 0);
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < FFT_RING_PAGE) {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    err = errno;
+    close(fd);
+    if (map == MAP_FAILED) {
+        errno = err;
+        return NULL;
+    }
+
+    h = (const struct fft_ring_header *)map;
+    if (memcmp(h->magic, FFT_RING_MAGIC, 4) != 0 || h->version != FFT_RING_VERSION
+            || h->headerSize != sizeof(*h) || h->slots == 0 || valueSize(h->valueType) == 0
+            || h->slotStride < FFT_RING_SLOT_HEADER + (uint64_t)h->bins * valueSize(h->valueType)
+            || ringLength(h->slots, h->slotStride) > (size_t)st.st_size) {
+        munmap(map, st.st_size);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    ring = (fft_ring *)calloc(1, sizeof(*ring));
+    if (ring == NULL) {
+        munmap(map, st.st_size);
+        errno = ENOMEM;
+        return NULL;
+    }
+    ring->map = (unsigned char *)map;
+    ring->length = st.st_size;
+    ring->header = h;
+    ring->head = (uint64_t *)(ring->map + 64);
+    ring->valueBytes = h->bins * valueSize(h->valueType);
+    return ring;
+}
+
+void fft_ring_close(fft_ring * ring)
+{
+    if (ring == NULL)
+        return;
+    munmap(ring->map, ring->length);
+    if (ring->name[0])
+        shm_unlink(ring->name);
+    free(ring);
+}
+
+const struct fft_ring_header * fft_ring_info(const fft_ring * ring)
+{
+    return ring->header;
+}
+
+void fft_ring_publish(fft_ring * ring, const void * values, uint64_t timeNs,
+                      uint32_t source)
+{
+    uint64_t n = __atomic_load_n(ring->head, __ATOMIC_RELAXED);
+    unsigned char * s = slot(ring, n);
+    uint64_t * seq = (uint64_t *)s;
+
+    /* odd while the values are being replaced */
+    __atomic_store_n(seq, 2*n + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(s + 8, &timeNs, 8);
+    memcpy(s + 16, &source, 4);
+    memcpy(s + FFT_RING_SLOT_HEADER, values, ring->valueBytes);
+    __atomic_store_n(seq, 2*n + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(ring->head, n + 1, __ATOMIC_RELEASE);
+}
+
+uint64_t fft_ring_head(const fft_ring * ring)
+{
+    return __atomic_load_n(ring->head, __ATOMIC_ACQUIRE);
+}
+
+int fft_ring_read(const fft_ring * ring, uint64_t n, void * values, uint64_t * timeNs,
+                  uint32_t * source)
+{
+    const unsigned char * s = slot(ring, n);
+    uint64_t * seq = (uint64_t *)s;
+    uint64_t before = __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+
+    if (before != 2*n + 2)
+        return -1;
+    memcpy(timeNs, s + 8, 8);
+    memcpy(source, s + 16, 4);
+    memcpy(values, s + FFT_RING_SLOT_HEADER, ring->valueBytes);
+    /* the copy must be done before the sequence is looked at again */
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(seq, __ATOMIC_RELAXED) == before ? 0 : -1;
+}
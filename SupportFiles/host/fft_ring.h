@@ -0,0 +1,85 @@
+/*
+ * Shared memory ring of spectra, one writer and any number of readers in
+ * other processes, so a viewer can follow acquisition without ever making
+ * it wait.
+ *
+ * The ring lives in /dev/shm under its name:
+ *
+ *   offset 0            struct fft_ring_header
+ *   offset 64           head, the number of spectra published (uint64)
+ *   offset 4096         slots, one every slotStride bytes: sequence
+ *                       (uint64), start time in ns (uint64), source
+ *                       (uint32, the board a gateway had it from), 12
+ *                       bytes reserved, then bins values
+ *
+ * Spectrum n goes to slot n % slots. The writer sets the slot's sequence
+ * to 2n+1 while it writes and to 2n+2 once the values are complete, then
+ * advances head. A reader copies the values and checks the sequence was
+ * 2n+2 both before and after; if not, the writer lapped it and the
+ * spectrum is gone. Readers write nothing, so no reader can hold up the
+ * writer or another reader.
+ *
+ * fft_ring.py reads and writes the same layout.
+ */
+#ifndef FFT_RING_H
+#define FFT_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FFT_RING_MAGIC          "FRNG"
+#define FFT_RING_VERSION        1
+#define FFT_RING_PAGE           4096
+#define FFT_RING_SLOT_HEADER    32
+
+/* valueType, as in fft_store.h */
+#define FFT_RING_INT16          0
+#define FFT_RING_FLOAT32        1
+
+struct fft_ring_header {
+    char magic[4];              // FFT_RING_MAGIC
+    uint16_t version;           // FFT_RING_VERSION
+    uint16_t headerSize;        // sizeof(struct fft_ring_header)
+    uint32_t slots;
+    uint32_t slotStride;        // bytes, a multiple of 64
+    uint32_t samples;           // N of the transform
+    uint32_t bins;              // values per spectrum
+    uint8_t valueType;
+    uint8_t reserved[3];
+    uint32_t sampleRate;        // Hz
+    uint64_t epoch;             // changes whenever the ring is created again
+    uint8_t pad[24];
+};
+
+typedef struct fft_ring fft_ring;
+
+/*
+ * Create the ring, replacing any ring of that name. NULL with errno set
+ * on failure.
+ */
+fft_ring * fft_ring_create(const char * name, uint32_t slots, uint32_t samples,
+                           uint32_t sampleRate, uint32_t bins, uint8_t valueType);
+
+/* map an existing ring for reading, NULL with errno set on failure */
+fft_ring * fft_ring_open(const char * name);
+
+/* unmap; the writer also removes the name */
+void fft_ring_close(fft_ring * ring);
+
+const struct fft_ring_header * fft_ring_info(const fft_ring * ring);
+
+/* writer: add a spectrum of bins values */
+void fft_ring_publish(fft_ring * ring, const void * values, uint64_t timeNs,
+                      uint32_t source);
+
+/* number of spectra published so far */
+uint64_t fft_ring_head(const fft_ring * ring);
+
+/*
+ * Copy spectrum n, which must be below fft_ring_head. Returns 0, or -1 if
+ * it has already been overwritten.
+ */
+int fft_ring_read(const fft_ring * ring, uint64_t n, void * values, uint64_t * timeNs,
+                  uint32_t * source);
+
+#endif
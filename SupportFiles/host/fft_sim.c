@@ -0,0 +1,558 @@
+/*
+ * fft_sim - a stand-in for a board running uart_FFT_kissFFT in its
+ * default build, on a pseudo terminal, so the host scripts can be run and
+ * measured without hardware.
+ *
+ * It speaks the protocol of uart_FFT_kissFFT.c ('F', 'N', 'S', 'E', '?',
+ * 'T') with the same plan sizes, and answers a frame with the board's own
+ * FFT engines (fftEngine/), kissFFT in Q15 and IQmath cFFT, so spectra are
+ * the ones the board sends. Like the board it reads one command at a time
+ * and ignores anything that arrives while it is answering.
+ *
+ * Bytes in both directions are paced to the given baud rate (10 bits a
+ * byte, 0 for as fast as the pty goes), and -c adds a fixed compute time
+ * per frame, so a rig of slow and fast boards can be imitated. Telemetry
+ * reports host time: TEL_MCLK_HZ is 1e9, so the cycle counts are ns.
+ * Built with -DCHECK_OVERFLOW it also reports the overflow counters, as
+ * the board does in that build.
+ *
+ * The memory telemetry is the host's: frames are computed on a stack of
+ * COMPUTE_STACK bytes painted at start up, so TEL_STACK_PEAK is how deep
+ * the engine and the magnitudes go with this compiler, and TEL_PLAN_BYTES
+ * and TEL_PLAN_MEMORY come from the engines as on the board, with 64 bit
+ * pointers. There is no fixed heap or spare SRAM, both read 0. The
+ * sim sleeps in read() between frames, so TEL_WAIT_CYCLES is 0.
+ *
+ * The pty path is printed on the first line of stdout; -l also links it
+ * to a fixed name.
+ *
+ * Built with -DLARGE_FRAMES it has the sizes up to 16384 and the in place
+ * engine of the board's LARGE_FRAMES build, and like the board offers the
+ * other engines only the sizes that fit its work buffer; the heap is not
+ * checked. Add ../../uart_FFT_kissFFT/fftEngine/engine_inplace.c and
+ * ../../uart_FFT_kissFFT/staticFFT/inplace_fftr.cpp, the latter compiled
+ * with g++ -std=c++14, and link with -lstdc++.
+ *
+ * Build from SupportFiles/host:
+ *   gcc -O2 -I. -I../../uart_FFT_kissFFT/fftEngine fft_sim.c
+ *       ../../uart_FFT_kissFFT/fftEngine/fft_engine.c
+ *       ../../uart_FFT_kissFFT/fftEngine/engine_kiss.c
+ *       ../../uart_FFT_kissFFT/fftEngine/engine_qfft.c
+ *       ../../uart_FFT_kissFFT/kissFFT/kiss_fft.c
+ *       ../../uart_FFT_kissFFT/kissFFT/kiss_fftr.c
+ *       ../../uart_FFT_kissFFT/qFFT/qfft.c -lm -o fft_sim
+ *
+ * Usage: fft_sim [-b baud] [-c compute us] [-l link]
+ * baud defaults to 9600, as the board's UART.
+ */
+#define _XOPEN_SOURCE 600
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include "fft_engine.h"
+
+#define SAMPLES         1024
+#define SAMPLE_FREQ     8192
+#define SAMPLE_FREQ_MAX 16384
+#ifdef LARGE_FRAMES
+#define MAX_SAMPLES     16384
+#define WORK_BYTES      INPLACE_WORK_BYTES(MAX_SAMPLES)
+
+static const uint16_t planSizes[] = {64, 128, 256, 512, 1000, 1024, 1200,
+                                     2048, 4096, 8192, 16384};
+#else
+#define MAX_SAMPLES     1200
+#define WORK_BYTES      ((FFT_WORK_BYTES(MAX_SAMPLES) + 3) & ~3)
+
+static const uint16_t planSizes[] = {64, 128, 256, 512, 1000, 1024, 1200};
+#endif
+#define PLAN_COUNT      (sizeof(planSizes)/sizeof(planSizes[0]))
+
+/* as in uart_FFT_kissFFT.c */
+#define PROTOCOL_VERSION        1
+#define TEL_FFT_CYCLES          1
+#define TEL_MAGNITUDE_CYCLES    2
+#define TEL_MCLK_HZ             3
+#define TEL_OVERFLOWS           4
+#define TEL_OVERFLOW_BASE       0x40
+#define TEL_STACK_PEAK          5
+#define TEL_STACK_SIZE          6
+#define TEL_SRAM_FREE           7
+#define TEL_PLAN_BYTES          8
+#define TEL_PLAN_MEMORY         9
+#define TEL_HEAP_SIZE           10
+#define TEL_IDLE_MCLK_HZ        11
+#define TEL_WAIT_CYCLES         12
+#define TEL_ENGINE              13
+#define TEL_ENGINES             14
+#define TELEMETRY_COUNT         13
+#define ERR_UNKNOWN_COMMAND     1
+#define ERR_UNSUPPORTED_SIZE    2
+#define ERR_BAD_SAMPLE_FREQ     3
+#define ERR_UNSUPPORTED_ENGINE  4
+
+/* stack frames are computed on, painted as the board paints its stack */
+#define COMPUTE_STACK           (64 * 1024)
+#define STACK_PAINT             0xA5C3A5C3u
+
+struct board {
+    int fd;                             // pty master
+    long baud;
+    long computeUs;
+    uint16_t samples;
+    uint16_t sampleFreq;
+    const fft_engine *engine;
+    int engineId;
+    void *plan;
+    void *planMemory;
+    uint32_t fftCycles;
+    uint32_t magnitudeCycles;
+    size_t planBytes;
+    size_t planMemorySize;              // largest plan's need
+    uint32_t *stack;
+    ucontext_t caller, compute;
+    const int16_t *in;                  // frame being computed
+    unsigned char reply[4 * MAX_SAMPLES];
+    size_t replyLength;
+};
+
+static uint64_t nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static void sleepUntil(uint64_t ns)
+{
+    struct timespec ts;
+    ts.tv_sec = ns / 1000000000u;
+    ts.tv_nsec = ns % 1000000000u;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ;
+}
+
+/* time the UART needs for count bytes */
+static uint64_t wireNs(const struct board *b, size_t count)
+{
+    return b->baud ? (uint64_t)count * 10 * 1000000000u / b->baud : 0;
+}
+
+static void put(struct board *b, uint8_t byte)
+{
+    b->reply[b->replyLength++] = byte;
+}
+
+static void putWord(struct board *b, uint16_t word)
+{
+    put(b, word % 256);
+    put(b, word / 256);
+}
+
+static void putLong(struct board *b, uint32_t value)
+{
+    putWord(b, value & 0xFFFF);
+    putWord(b, value >> 16);
+}
+
+static void putError(struct board *b, uint8_t code)
+{
+    put(b, 'E');
+    put(b, code);
+}
+
+/* write the reply no faster than the UART would send it */
+static int sendReply(struct board *b)
+{
+    size_t done = 0, chunk = b->baud ? (size_t)(b->baud / 10 / 1000) : b->replyLength;
+    uint64_t start = nowNs();
+
+    if (chunk == 0)
+        chunk = 1;
+    while (done < b->replyLength) {
+        size_t count = b->replyLength - done < chunk ? b->replyLength - done : chunk;
+        ssize_t n;
+
+        /* each chunk leaves when the one before it is on the wire */
+        sleepUntil(start + wireNs(b, done));
+        n = write(b->fd, b->reply + done, count);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        done += n;
+    }
+    b->replyLength = 0;
+    return 0;
+}
+
+/* the engine has a plan for size and its work buffer fits */
+static int engineFits(const fft_engine *e, uint16_t size)
+{
+    return e->planSize(size) != 0 && e->workSize(size) <= WORK_BYTES;
+}
+
+static int selectPlan(struct board *b, uint16_t size)
+{
+    unsigned p;
+    size_t len;
+
+    for (p = 0; p < PLAN_COUNT; p++) {
+        if (planSizes[p] == size)
+            break;
+    }
+    if (p == PLAN_COUNT || !engineFits(b->engine, size))
+        return 0;
+    len = b->engine->planSize(size);
+    b->plan = b->engine->plan(size, b->planMemory);
+    b->planBytes = len;
+    b->samples = size;
+    return 1;
+}
+
+/* switch engine keeping the size, or keep the current one */
+static int selectEngine(struct board *b, int id)
+{
+    const fft_engine *previous = b->engine;
+
+    if (id >= FFT_ENGINE_COUNT || fftEngines[id] == NULL)
+        return 0;
+    b->engine = fftEngines[id];
+    if (!selectPlan(b, b->samples)) {
+        b->engine = previous;
+        return 0;
+    }
+    b->engineId = id;
+    return 1;
+}
+
+/* the engine and the magnitudes of b->in, run on b->stack */
+static struct board *computing;
+
+static void computeFrame(void)
+{
+    struct board *b = computing;
+    uint32_t work[WORK_BYTES / 4];
+    const fft_magnitude *mag = (const fft_magnitude *)work;
+    uint64_t start;
+    int i;
+
+    /* the board's interrupt writes the samples straight into work */
+    memcpy(work, b->in, 2 * (size_t)b->samples);
+    start = nowNs();
+    b->engine->execute(b->plan, b->samples, work);
+    b->fftCycles = (uint32_t)(nowNs() - start);
+
+    start = nowNs();
+    b->engine->magnitude(b->plan, b->samples, work);
+    b->magnitudeCycles = (uint32_t)(nowNs() - start);
+    for (i = 0; i < b->samples/2; i++)
+        putWord(b, (uint16_t)mag[i]);
+}
+
+/* paint the compute stack and size the plan memory, as the board at reset */
+static int setupMemory(struct board *b)
+{
+    unsigned p;
+    int e;
+
+    b->stack = malloc(COMPUTE_STACK);
+    if (b->stack == NULL)
+        return -1;
+    for (p = 0; p < COMPUTE_STACK / sizeof(uint32_t); p++)
+        b->stack[p] = STACK_PAINT;
+
+    b->planMemorySize = 0;
+    for (e = 0; e < FFT_ENGINE_COUNT; e++) {
+        if (fftEngines[e] == NULL)
+            continue;
+        for (p = 0; p < PLAN_COUNT; p++) {
+            size_t len = fftEngines[e]->planSize(planSizes[p]);
+            if (engineFits(fftEngines[e], planSizes[p]) && len > b->planMemorySize)
+                b->planMemorySize = len;
+        }
+    }
+    b->planMemory = malloc(b->planMemorySize);
+    if (b->planMemory == NULL)
+        return -1;
+    b->engine = fftEngines[FFT_ENGINE_DEFAULT];
+    b->engineId = FFT_ENGINE_DEFAULT;
+    return 0;
+}
+
+/* deepest the compute stack has been, from its top */
+static uint32_t stackPeak(const struct board *b)
+{
+    size_t p = 0;
+
+    while (p < COMPUTE_STACK / sizeof(uint32_t) && b->stack[p] == STACK_PAINT)
+        p++;
+    return (uint32_t)(COMPUTE_STACK - p * sizeof(uint32_t));
+}
+
+static void answerFrame(struct board *b, const int16_t *in)
+{
+    uint64_t frameStart = nowNs();
+
+    b->in = in;
+    computing = b;
+    getcontext(&b->compute);
+    b->compute.uc_stack.ss_sp = b->stack;
+    b->compute.uc_stack.ss_size = COMPUTE_STACK;
+    b->compute.uc_link = &b->caller;
+    makecontext(&b->compute, computeFrame, 0);
+    swapcontext(&b->caller, &b->compute);
+
+    if (b->computeUs)
+        sleepUntil(frameStart + (uint64_t)b->computeUs * 1000);
+}
+
+static void answer(struct board *b, uint8_t command, const uint8_t *args)
+{
+    uint16_t word = args[0] + 256*args[1];
+    unsigned p, count;
+    uint32_t engines;
+    int e;
+
+    switch (command) {
+    case 'F':
+        answerFrame(b, (const int16_t *)args);
+        break;
+
+    case 'N':
+        if (selectPlan(b, word)) {
+            put(b, 'A');
+            putWord(b, b->samples);
+        } else {
+            putError(b, ERR_UNSUPPORTED_SIZE);
+        }
+        break;
+
+    case 'E':
+        if (selectEngine(b, args[0])) {
+            put(b, 'A');
+            put(b, (uint8_t)b->engineId);
+        } else {
+            putError(b, ERR_UNSUPPORTED_ENGINE);
+        }
+        break;
+
+    case 'S':
+        if (word >= 1 && word <= SAMPLE_FREQ_MAX) {
+            b->sampleFreq = word;
+            put(b, 'A');
+            putWord(b, b->sampleFreq);
+        } else {
+            putError(b, ERR_BAD_SAMPLE_FREQ);
+        }
+        break;
+
+    case '?':
+        put(b, 'C');
+        put(b, PROTOCOL_VERSION);
+        put(b, 0);
+        putWord(b, b->samples);
+        putWord(b, b->sampleFreq);
+        putWord(b, SAMPLE_FREQ_MAX);
+        count = 0;
+        for (p = 0; p < PLAN_COUNT; p++)
+            count += engineFits(b->engine, planSizes[p]);
+        put(b, (uint8_t)count);
+        for (p = 0; p < PLAN_COUNT; p++)
+            if (engineFits(b->engine, planSizes[p]))
+                putWord(b, planSizes[p]);
+        break;
+
+    case 'T':
+        put(b, 'T');
+#ifdef CHECK_OVERFLOW
+        {
+            int r, s, count = TELEMETRY_COUNT + 1;
+            for (r = 0; r < KISS_OVERFLOW_RADIXES; r++)
+                for (s = 0; s < KISS_OVERFLOW_STAGES; s++)
+                    count += kiss_fft_overflows.count[r][s] != 0;
+            put(b, (uint8_t)count);
+        }
+#else
+        put(b, TELEMETRY_COUNT);
+#endif
+        put(b, TEL_FFT_CYCLES);
+        putLong(b, b->fftCycles);
+        put(b, TEL_MAGNITUDE_CYCLES);
+        putLong(b, b->magnitudeCycles);
+        put(b, TEL_MCLK_HZ);
+        putLong(b, 1000000000u);
+        put(b, TEL_STACK_PEAK);
+        putLong(b, stackPeak(b));
+        put(b, TEL_STACK_SIZE);
+        putLong(b, COMPUTE_STACK);
+        put(b, TEL_SRAM_FREE);
+        putLong(b, 0);
+        put(b, TEL_PLAN_BYTES);
+        putLong(b, (uint32_t)b->planBytes);
+        put(b, TEL_PLAN_MEMORY);
+        putLong(b, (uint32_t)b->planMemorySize);
+        put(b, TEL_HEAP_SIZE);
+        putLong(b, 0);
+        put(b, TEL_IDLE_MCLK_HZ);
+        putLong(b, 1000000000u);
+        put(b, TEL_WAIT_CYCLES);
+        putLong(b, 0);
+        put(b, TEL_ENGINE);
+        putLong(b, (uint32_t)b->engineId);
+        engines = 0;
+        for (e = 0; e < FFT_ENGINE_COUNT; e++)
+            if (fftEngines[e] != NULL)
+                engines |= 1u << e;
+        put(b, TEL_ENGINES);
+        putLong(b, engines);
+#ifdef CHECK_OVERFLOW
+        put(b, TEL_OVERFLOWS);
+        putLong(b, kiss_fft_overflow_total());
+        {
+            int r, s;
+            for (r = 0; r < KISS_OVERFLOW_RADIXES; r++)
+                for (s = 0; s < KISS_OVERFLOW_STAGES; s++)
+                    if (kiss_fft_overflows.count[r][s]) {
+                        put(b, (uint8_t)(TEL_OVERFLOW_BASE + r*8 + s));
+                        putLong(b, kiss_fft_overflows.count[r][s]);
+                    }
+        }
+#endif
+        break;
+
+    default:
+        putError(b, ERR_UNKNOWN_COMMAND);
+        break;
+    }
+}
+
+static int openPty(char *path, size_t size, int *slave)
+{
+    struct termios tio;
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0)
+        return -1;
+    snprintf(path, size, "%s", ptsname(fd));
+
+    /* keep the other end open and raw, so reads do not fail between
+       clients and the line discipline passes every byte through */
+    *slave = open(path, O_RDWR | O_NOCTTY);
+    if (*slave < 0 || tcgetattr(*slave, &tio) != 0)
+        return -1;
+    cfmakeraw(&tio);
+    tcsetattr(*slave, TCSANOW, &tio);
+    return fd;
+}
+
+int main(int argc, char *argv[])
+{
+    static union {
+        int16_t samples[MAX_SAMPLES];
+        uint8_t bytes[2 * MAX_SAMPLES];
+    } args;
+    struct board b;
+    const char *link = NULL;
+    char path[64];
+    int arg, slave;
+    uint8_t command = 0;
+    size_t bytes = 0, payloadSize = 0;
+    uint64_t firstByte = 0;
+
+    memset(&b, 0, sizeof(b));
+    b.baud = 9600;
+    for (arg = 1; arg + 1 < argc; arg += 2) {
+        if (strcmp(argv[arg], "-b") == 0)
+            b.baud = atol(argv[arg + 1]);
+        else if (strcmp(argv[arg], "-c") == 0)
+            b.computeUs = atol(argv[arg + 1]);
+        else if (strcmp(argv[arg], "-l") == 0)
+            link = argv[arg + 1];
+        else
+            break;
+    }
+    if (arg != argc || b.baud < 0 || b.computeUs < 0) {
+        fprintf(stderr, "usage: fft_sim [-b baud] [-c compute us] [-l link]\n");
+        return 1;
+    }
+
+    b.fd = openPty(path, sizeof(path), &slave);
+    if (b.fd < 0) {
+        perror("pty");
+        return 1;
+    }
+    if (link != NULL) {
+        unlink(link);
+        if (symlink(path, link) != 0) {
+            perror(link);
+            return 1;
+        }
+    }
+    signal(SIGPIPE, SIG_IGN);
+    b.sampleFreq = SAMPLE_FREQ;
+    if (setupMemory(&b) < 0) {
+        perror("fft_sim");
+        return 1;
+    }
+    selectPlan(&b, SAMPLES);
+    printf("%s\n", path);
+    fflush(stdout);
+
+    for (;;) {
+        uint8_t in[256];
+        ssize_t n = read(b.fd, in, sizeof(in));
+        ssize_t i;
+
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("read");
+            return 1;
+        }
+
+        /* the receive interrupt of uart_FFT_kissFFT.c, a byte at a time */
+        for (i = 0; i < n; i++) {
+            if (command == 0) {
+                command = in[i];
+                bytes = 0;
+                firstByte = nowNs();
+                switch (command) {
+                case 'F': payloadSize = 2 * (size_t)b.samples; break;
+                case 'N':
+                case 'S': payloadSize = 2; break;
+                case 'E': payloadSize = 1; break;
+                default:  payloadSize = 0; break;
+                }
+            } else {
+                args.bytes[bytes++] = in[i];
+            }
+
+            if (bytes == payloadSize) {
+                /* the last byte cannot have arrived before the wire brought it */
+                sleepUntil(firstByte + wireNs(&b, payloadSize + 1));
+                answer(&b, command, args.bytes);
+
+                /* the board drops what came in while it was busy */
+                tcflush(b.fd, TCIFLUSH);
+                if (sendReply(&b) != 0) {
+                    perror("write");
+                    return 1;
+                }
+                command = 0;
+                break;
+            }
+        }
+    }
+}
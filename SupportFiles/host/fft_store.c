@@ -0,0 +1,324 @@
+/*
+ * Spectrum stores, see fft_store.h. As in fft_capture.c the structs are
+ * written as they are in memory, which matches the file on the little
+ * endian machines the host tools run on.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "fft_store.h"
+
+typedef char fft_store_header_is_64_bytes[sizeof(struct fft_store_header) == 64 ? 1 : -1];
+
+struct fft_store {
+    const unsigned char * map;
+    size_t length;
+    struct fft_store_header header;     // as it was at open, see fft_store_open
+    size_t valueSize;
+};
+
+struct fft_store_writer {
+    FILE * file;
+    struct fft_store_header header;
+    size_t valueSize;
+    unsigned char * chunk;      // the chunk being filled, laid out as on disk
+    uint32_t fill;              // frames in it
+    uint64_t chunkIndex;
+};
+
+static size_t valueSize(uint8_t valueType)
+{
+    switch (valueType) {
+    case FFT_STORE_INT16:   return 2;
+    case FFT_STORE_FLOAT32: return 4;
+    default:                return 0;
+    }
+}
+
+/* bytes of times and values in a chunk, before the page padding */
+static uint64_t chunkUsed(uint32_t bins, uint32_t chunkFrames, size_t size)
+{
+    return (uint64_t)chunkFrames * (8 + (uint64_t)bins * size);
+}
+
+fft_store * fft_store_open(const char * path)
+{
+    struct fft_store_header h;
+    fft_store * store;
+    struct stat st;
+    uint64_t chunks;
+    size_t size;
+    void * map;
+    int fd, err;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &st) != 0) {
+        err = errno;
+        close(fd);
+        errno = err;
+        return NULL;
+    }
+    if ((size_t)st.st_size < sizeof(struct fft_store_header)) {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    err = errno;
+    close(fd);
+    if (map == MAP_FAILED) {
+        errno = err;
+        return NULL;
+    }
+
+    /* A writer rewrites the header after every chunk. Take it once, so
+       frameCount cannot grow past the chunks that were in the file when
+       it was mapped. */
+    memcpy(&h, map, sizeof(h));
+    size = valueSize(h.valueType);
+    chunks = h.chunkFrames ? (h.frameCount + h.chunkFrames - 1) / h.chunkFrames : 0;
+    if (memcmp(h.magic, FFT_STORE_MAGIC, 4) != 0 || h.version != FFT_STORE_VERSION
+            || h.headerSize != sizeof(h) || size == 0
+            || h.bins == 0 || h.chunkFrames == 0
+            || h.chunkBytes < chunkUsed(h.bins, h.chunkFrames, size)
+            || h.chunkBytes % FFT_STORE_PAGE || h.dataOffset % FFT_STORE_PAGE
+            || (chunks && (h.dataOffset > (uint64_t)st.st_size
+                || ((uint64_t)st.st_size - h.dataOffset) / h.chunkBytes < chunks))) {
+        munmap(map, st.st_size);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    store = (fft_store *)malloc(sizeof(*store));
+    if (store == NULL) {
+        munmap(map, st.st_size);
+        errno = ENOMEM;
+        return NULL;
+    }
+    store->map = (const unsigned char *)map;
+    store->length = st.st_size;
+    store->header = h;
+    store->valueSize = size;
+
+    /* queries pick a few bins out of each chunk, read ahead would be wasted */
+    madvise(map, st.st_size, MADV_RANDOM);
+    return store;
+}
+
+void fft_store_close(fft_store * store)
+{
+    if (store == NULL)
+        return;
+    munmap((void *)store->map, store->length);
+    free(store);
+}
+
+const struct fft_store_header * fft_store_info(const fft_store * store)
+{
+    return &store->header;
+}
+
+/*
+ * The bytes at offset into chunk of frame i, or NULL if i is not a frame
+ * of the store or they are not all inside the map.
+ */
+static const unsigned char * chunkAt(const fft_store * store, uint64_t i,
+                                     uint64_t offset, uint64_t bytes)
+{
+    const struct fft_store_header * h = &store->header;
+    uint64_t start;
+
+    if (i >= h->frameCount || offset + bytes > h->chunkBytes)
+        return NULL;
+    start = h->dataOffset + i / h->chunkFrames * h->chunkBytes + offset;
+    if (start > store->length || store->length - start < bytes)
+        return NULL;
+    return store->map + start;
+}
+
+uint64_t fft_store_time(const fft_store * store, uint64_t i)
+{
+    const unsigned char * t = chunkAt(store, i, i % store->header.chunkFrames * 8, 8);
+    uint64_t time;
+
+    if (t == NULL)
+        return UINT64_MAX;
+    memcpy(&time, t, sizeof(time));
+    return time;
+}
+
+uint64_t fft_store_find(const fft_store * store, uint64_t timeNs)
+{
+    uint64_t lo = 0, hi = store->header.frameCount;
+
+    /* the first probes land on chunk time blocks far apart, the last
+       ones all within one page of times */
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (fft_store_time(store, mid) < timeNs)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+const void * fft_store_column(const fft_store * store, uint32_t bin, uint64_t i,
+                              size_t * count)
+{
+    const struct fft_store_header * h = &store->header;
+    uint64_t offset, left;
+    const unsigned char * values;
+
+    *count = 0;
+    if (i >= h->frameCount || bin >= h->bins)
+        return NULL;
+    offset = i % h->chunkFrames;
+    left = h->frameCount - i;
+    left = h->chunkFrames - offset < left ? h->chunkFrames - offset : left;
+    values = chunkAt(store, i, (uint64_t)h->chunkFrames * 8
+                     + ((uint64_t)bin * h->chunkFrames + offset) * store->valueSize,
+                     left * store->valueSize);
+    if (values != NULL)
+        *count = (size_t)left;
+    return values;
+}
+
+void fft_store_read(const fft_store * store, uint64_t first, size_t frames,
+                    uint32_t firstBin, uint32_t bins, float * out)
+{
+    uint32_t b;
+
+    for (b = 0; b < bins; b++) {
+        float * row = out + (size_t)b * frames;
+        size_t done = 0;
+
+        while (done < frames) {
+            size_t count, k;
+            const void * column = fft_store_column(store, firstBin + b, first + done, &count);
+
+            if (column == NULL) {
+                /* outside the store, leave the rest of the row as 0 */
+                memset(row + done, 0, (frames - done) * sizeof(float));
+                break;
+            }
+            if (count > frames - done)
+                count = frames - done;
+            if (store->header.valueType == FFT_STORE_INT16) {
+                const int16_t * v = (const int16_t *)column;
+                for (k = 0; k < count; k++)
+                    row[done + k] = v[k];
+            } else {
+                memcpy(row + done, column, count * sizeof(float));
+            }
+            done += count;
+        }
+    }
+}
+
+fft_store_writer * fft_store_create(const char * path, uint32_t samples,
+                                    uint32_t sampleRate, uint32_t bins,
+                                    uint32_t chunkFrames, uint8_t valueType)
+{
+    fft_store_writer * w;
+    size_t size = valueSize(valueType);
+    uint64_t chunkBytes;
+
+    if (size == 0 || bins == 0 || chunkFrames == 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    chunkBytes = (chunkUsed(bins, chunkFrames, size) + FFT_STORE_PAGE - 1)
+               / FFT_STORE_PAGE * FFT_STORE_PAGE;
+    if (chunkBytes > UINT32_MAX) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    w = (fft_store_writer *)calloc(1, sizeof(*w));
+    if (w == NULL)
+        return NULL;
+    w->chunk = (unsigned char *)calloc(1, (size_t)chunkBytes);
+    w->file = w->chunk ? fopen(path, "wb") : NULL;
+    if (w->file == NULL) {
+        free(w->chunk);
+        free(w);
+        return NULL;
+    }
+
+    memcpy(w->header.magic, FFT_STORE_MAGIC, 4);
+    w->header.version = FFT_STORE_VERSION;
+    w->header.headerSize = sizeof(w->header);
+    w->header.samples = samples;
+    w->header.sampleRate = sampleRate;
+    w->header.bins = bins;
+    w->header.chunkFrames = chunkFrames;
+    w->header.valueType = valueType;
+    w->header.chunkBytes = (uint32_t)chunkBytes;
+    w->header.dataOffset = FFT_STORE_PAGE;
+    w->valueSize = size;
+
+    if (fwrite(&w->header, sizeof(w->header), 1, w->file) != 1) {
+        fclose(w->file);
+        free(w->chunk);
+        free(w);
+        return NULL;
+    }
+    return w;
+}
+
+/* write the chunk being filled, then the header that makes it visible */
+static int flushChunk(fft_store_writer * w)
+{
+    return fseek(w->file, (long)(w->header.dataOffset + w->chunkIndex * w->header.chunkBytes),
+                 SEEK_SET) == 0
+        && fwrite(w->chunk, w->header.chunkBytes, 1, w->file) == 1
+        && fseek(w->file, 0, SEEK_SET) == 0
+        && fwrite(&w->header, sizeof(w->header), 1, w->file) == 1
+        && fflush(w->file) == 0 ? 0 : -1;
+}
+
+int fft_store_append(fft_store_writer * w, const void * spectrum, uint64_t timeNs)
+{
+    const uint32_t frames = w->header.chunkFrames;
+    unsigned char * values = w->chunk + (size_t)frames * 8 + w->fill * w->valueSize;
+    const unsigned char * in = (const unsigned char *)spectrum;
+    uint32_t b;
+
+    ((uint64_t *)w->chunk)[w->fill] = timeNs;
+    for (b = 0; b < w->header.bins; b++)
+        memcpy(values + (size_t)b * frames * w->valueSize, in + b * w->valueSize, w->valueSize);
+
+    w->fill++;
+    w->header.frameCount++;
+    if (w->fill == frames) {
+        if (flushChunk(w) != 0)
+            return -1;
+        memset(w->chunk, 0, w->header.chunkBytes);
+        w->fill = 0;
+        w->chunkIndex++;
+    }
+    return 0;
+}
+
+int fft_store_finish(fft_store_writer * w)
+{
+    int ok = w->fill == 0 || flushChunk(w) == 0;
+
+    /* an empty store still gets its final header */
+    if (ok && w->header.frameCount == 0)
+        ok = fseek(w->file, 0, SEEK_SET) == 0
+          && fwrite(&w->header, sizeof(w->header), 1, w->file) == 1;
+    ok = (fclose(w->file) == 0) && ok;
+    free(w->chunk);
+    free(w);
+    return ok ? 0 : -1;
+}
@@ -0,0 +1,99 @@
+/*
+ * Spectrum stores (.fspec): spectra kept by bin rather than by frame, so
+ * the history of a few bins over a long run can be read without touching
+ * the rest.
+ *
+ *   offset 0                 header, struct fft_store_header, one page
+ *   dataOffset + c*chunkBytes chunk c
+ *
+ * A chunk holds chunkFrames consecutive spectra:
+ *
+ *   chunkFrames uint64 start times in ns, in increasing order
+ *   bins blocks of chunkFrames values, one block per bin
+ *
+ * padded to a page. Only the first frameCount frames of the store are
+ * valid; the last chunk may be partly filled. The header is rewritten
+ * after every chunk, so a store that is still being written can be read
+ * up to the last chunk written before it was opened; fft_store_open takes
+ * the header once, and frames added later need the store opened again.
+ *
+ * Everything is little endian. fft_store.py reads and writes the same
+ * format.
+ */
+#ifndef FFT_STORE_H
+#define FFT_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FFT_STORE_MAGIC         "FSPC"
+#define FFT_STORE_VERSION       1
+#define FFT_STORE_PAGE          4096
+
+/* valueType */
+#define FFT_STORE_INT16         0       // magnitudes as the board sends them
+#define FFT_STORE_FLOAT32       1       // BFP or float engine spectra
+
+struct fft_store_header {
+    char magic[4];              // FFT_STORE_MAGIC
+    uint16_t version;           // FFT_STORE_VERSION
+    uint16_t headerSize;        // sizeof(struct fft_store_header)
+    uint32_t samples;           // N of the transform
+    uint32_t sampleRate;        // Hz
+    uint32_t bins;              // values per spectrum, normally N/2
+    uint32_t chunkFrames;       // spectra per chunk
+    uint8_t valueType;          // FFT_STORE_INT16 or FFT_STORE_FLOAT32
+    uint8_t reserved[3];
+    uint32_t chunkBytes;        // bytes from one chunk to the next
+    uint64_t frameCount;
+    uint64_t dataOffset;
+    uint8_t pad[16];
+};
+
+typedef struct fft_store fft_store;
+typedef struct fft_store_writer fft_store_writer;
+
+/*
+ * Map a store read only. Returns NULL with errno set if it cannot be
+ * opened, or EINVAL if it is not a store this code understands.
+ */
+fft_store * fft_store_open(const char * path);
+void fft_store_close(fft_store * store);
+
+const struct fft_store_header * fft_store_info(const fft_store * store);
+
+/* start time of frame i in ns, UINT64_MAX if there is no frame i */
+uint64_t fft_store_time(const fft_store * store, uint64_t i);
+
+/* first frame that starts at or after timeNs, frameCount if none */
+uint64_t fft_store_find(const fft_store * store, uint64_t timeNs);
+
+/*
+ * The values of bin in the chunk holding frame i, from frame i to the end
+ * of that chunk or of the store, whichever is first; their number goes to
+ * *count. Points into the map, valid until fft_store_close. NULL with
+ * *count 0 if bin or frame i is not in the store.
+ */
+const void * fft_store_column(const fft_store * store, uint32_t bin, uint64_t i,
+                              size_t * count);
+
+/*
+ * Copy frames [first, first+frames) of bins [firstBin, firstBin+bins) to
+ * out as floats, one row of frames values per bin. Only the pages of
+ * those bins in those chunks are read. Values outside the store read 0.
+ */
+void fft_store_read(const fft_store * store, uint64_t first, size_t frames,
+                    uint32_t firstBin, uint32_t bins, float * out);
+
+/*
+ * Write a new store. Spectra are appended in time order and gathered into
+ * bin-major chunks in memory; fft_store_finish writes the last partial
+ * chunk and closes the file. NULL or -1 with errno set on failure.
+ */
+fft_store_writer * fft_store_create(const char * path, uint32_t samples,
+                                    uint32_t sampleRate, uint32_t bins,
+                                    uint32_t chunkFrames, uint8_t valueType);
+int fft_store_append(fft_store_writer * w, const void * spectrum, uint64_t timeNs);
+int fft_store_finish(fft_store_writer * w);
+
+#endif
@@ -0,0 +1,477 @@
+/*
+ * fft_verify - check spectra returned by a board against a double precision
+ * reference of the same input frames.
+ *
+ * Each input frame is transformed again with kissFFT in double and put on
+ * the scale the firmware sends, abs(fft(x)/N), which is what both cFFT and
+ * kiss_fftr + _Qmag produce. For every frame it finds
+ *   SNR      reference power over the power of the magnitude error, in dB
+ *   max err  largest magnitude error, in LSBs of the sent values, and the
+ *            bin where it is
+ * and for every bin the RMS error over groups of frames, which -m writes as
+ * a heatmap of rows of frames by bins; a bin that drifts or a stretch of
+ * frames that goes wrong stands out at a glance.
+ *
+ * Frames are split into tasks for an fft_pool, every one with its own
+ * kiss_fftr tmpbuf; one core gets through close to two million frames a
+ * minute at N = 1024.
+ *
+ * Input frames come from a capture (csv2fcap) or a CSV of samples, frames
+ * back to back as fft_fanout.py cuts them. Spectra come from a spectrum
+ * store (fspec, fft_fanout.py, fft_csv.py) or a CSV of magnitudes, N/2
+ * per frame, as fft_output.csv. Spectrum i is checked against frame i.
+ *
+ * The exit status is 2 if any frame is worse than -e or -s allow, so the
+ * check can gate a change to the fixed point code.
+ *
+ * Build from SupportFiles/host:
+ *   gcc -O2 -DKISS_FFT_FLOAT -Dkiss_fft_scalar=double -I.
+ *       -I../../uart_FFT_kissFFT/kissFFT fft_verify.c fft_capture.c
+ *       fft_store.c fft_pool.c ../../uart_FFT_kissFFT/kissFFT/kiss_fft.c
+ *       ../../uart_FFT_kissFFT/kissFFT/kiss_fftr.c -lm -lpthread -o fft_verify
+ *
+ * Usage: fft_verify [-t threads] [-n samples] [-e max err] [-s min SNR]
+ *                   [-f frames.csv] [-m heatmap.csv] [-r heatmap rows]
+ *                   input spectra
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "kiss_fftr.h"
+#include "fft_capture.h"
+#include "fft_store.h"
+#include "fft_pool.h"
+
+typedef char kiss_fft_scalar_is_double[sizeof(kiss_fft_scalar) == sizeof(double) ? 1 : -1];
+
+/* frames per task at most */
+#define VERIFY_CHUNK    256
+
+struct verify_task {
+    uint64_t first;
+    size_t count;
+    int row;                            // heatmap row the frames belong to
+    double * errSq;                     // bins, squared errors summed over the frames
+};
+
+static int samples, bins;
+static uint64_t frameCount;
+
+/* input frames: a mapped capture or the rows of a CSV */
+static fft_capture *cap;
+static int16_t *csvFrames;
+
+/* returned spectra: a spectrum store or the rows of a CSV */
+static fft_store *store;
+static float *csvSpectra;
+
+static kiss_fftr_cfg sharedCfg;
+
+/* per frame results */
+static double *frameSnr;
+static float *frameMaxErr;
+static int *frameWorstBin;
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int endsWith(const char *s, const char *suffix)
+{
+    size_t n = strlen(s), m = strlen(suffix);
+    return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+/*
+ * The first column of every row of a CSV file, as doubles. Returns NULL if
+ * the file cannot be read or a row does not start with a number.
+ */
+static double *readCsv(const char *path, size_t *count)
+{
+    FILE *f = fopen(path, "r");
+    char line[256];
+    double *values = NULL, *grown;
+    size_t size = 0, n = 0;
+    long row = 0;
+
+    if (f == NULL) {
+        perror(path);
+        return NULL;
+    }
+    while (fgets(line, sizeof(line), f) != NULL) {
+        char *end;
+        double v;
+
+        row++;
+        if (line[strspn(line, " \t\r\n")] == '\0')
+            continue;
+        v = strtod(line, &end);
+        if (end == line) {
+            fprintf(stderr, "%s:%ld: not a number\n", path, row);
+            free(values);
+            fclose(f);
+            return NULL;
+        }
+        if (n == size) {
+            size = size ? 2 * size : 4096;
+            grown = (double *)realloc(values, sizeof(double) * size);
+            if (grown == NULL) {
+                fprintf(stderr, "out of memory\n");
+                free(values);
+                fclose(f);
+                return NULL;
+            }
+            values = grown;
+        }
+        values[n++] = v;
+    }
+    fclose(f);
+    *count = n;
+    return values;
+}
+
+static const int16_t *frameAt(uint64_t i)
+{
+    return cap ? fft_capture_frame(cap, i) : csvFrames + i * samples;
+}
+
+/* spectra first to first+count into out, one row of count values per bin */
+static void loadSpectra(uint64_t first, size_t count, float *out)
+{
+    size_t f;
+    int b;
+
+    if (store) {
+        fft_store_read(store, first, count, 0, (uint32_t)bins, out);
+        return;
+    }
+    for (f = 0; f < count; f++)
+        for (b = 0; b < bins; b++)
+            out[b * count + f] = csvSpectra[(first + f) * bins + b];
+}
+
+static void verifyTask(void *arg)
+{
+    struct verify_task *t = (struct verify_task *)arg;
+    kiss_fftr_cfg cfg = sharedCfg ? sharedCfg : kiss_fftr_alloc(samples, 0, NULL, NULL);
+    kiss_fft_scalar *in = (kiss_fft_scalar *)malloc(sizeof(kiss_fft_scalar) * samples);
+    kiss_fft_cpx *out = (kiss_fft_cpx *)malloc(sizeof(kiss_fft_cpx) * (samples/2 + 1));
+    kiss_fft_cpx *tmpbuf = (kiss_fft_cpx *)malloc(sizeof(kiss_fft_cpx) * (samples/2));
+    float *got = (float *)malloc(sizeof(float) * t->count * bins);
+    size_t f;
+    int i, b;
+
+    if (cfg == NULL || in == NULL || out == NULL || tmpbuf == NULL || got == NULL) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    loadSpectra(t->first, t->count, got);
+
+    for (f = 0; f < t->count; f++) {
+        const int16_t *x = frameAt(t->first + f);
+        double signal = 0, noise = 0, maxErr = 0;
+        int worst = 0;
+
+        for (i = 0; i < samples; i++)
+            in[i] = x[i];
+        kiss_fftr_work(cfg, in, out, tmpbuf);
+
+        for (b = 0; b < bins; b++) {
+            double ref = hypot(out[b].r, out[b].i) / samples;
+            double err = got[b * t->count + f] - ref;
+
+            signal += ref * ref;
+            noise += err * err;
+            t->errSq[b] += err * err;
+            if (fabs(err) > maxErr) {
+                maxErr = fabs(err);
+                worst = b;
+            }
+        }
+        frameSnr[t->first + f] = noise > 0 ? 10 * log10(signal / noise) : INFINITY;
+        frameMaxErr[t->first + f] = (float)maxErr;
+        frameWorstBin[t->first + f] = worst;
+    }
+
+    free(got);
+    free(tmpbuf);
+    free(out);
+    free(in);
+    if (cfg != sharedCfg)
+        free(cfg);
+}
+
+static int openInput(const char *path)
+{
+    double *values;
+    size_t count, i;
+
+    if (endsWith(path, ".fcap")) {
+        const struct fft_capture_header *h;
+
+        cap = fft_capture_open(path);
+        if (cap == NULL) {
+            perror(path);
+            return -1;
+        }
+        h = fft_capture_info(cap);
+        if (samples != 0 && (uint32_t)samples != h->samples) {
+            fprintf(stderr, "%s has frames of %u samples\n", path, h->samples);
+            return -1;
+        }
+        samples = (int)h->samples;
+        frameCount = h->frameCount;
+        return 0;
+    }
+
+    values = readCsv(path, &count);
+    if (values == NULL)
+        return -1;
+    csvFrames = (int16_t *)malloc(sizeof(int16_t) * (count ? count : 1));
+    if (csvFrames == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return -1;
+    }
+    for (i = 0; i < count; i++) {
+        if (values[i] < -32768 || values[i] > 32767 || values[i] != floor(values[i])) {
+            fprintf(stderr, "%s: sample %lu is not a 16 bit integer\n", path, (unsigned long)i);
+            return -1;
+        }
+        csvFrames[i] = (int16_t)values[i];
+    }
+    free(values);
+    frameCount = count / samples;
+    return 0;
+}
+
+static int openSpectra(const char *path)
+{
+    double *values;
+    size_t count, i;
+    uint64_t spectra;
+
+    if (endsWith(path, ".fspec")) {
+        const struct fft_store_header *h;
+
+        store = fft_store_open(path);
+        if (store == NULL) {
+            perror(path);
+            return -1;
+        }
+        h = fft_store_info(store);
+        if (h->samples != (uint32_t)samples || h->bins != (uint32_t)bins) {
+            fprintf(stderr, "%s holds %u bins of N = %u, not %d of N = %d\n",
+                    path, h->bins, h->samples, bins, samples);
+            return -1;
+        }
+        spectra = h->frameCount;
+    } else {
+        values = readCsv(path, &count);
+        if (values == NULL)
+            return -1;
+        csvSpectra = (float *)malloc(sizeof(float) * (count ? count : 1));
+        if (csvSpectra == NULL) {
+            fprintf(stderr, "out of memory\n");
+            return -1;
+        }
+        for (i = 0; i < count; i++)
+            csvSpectra[i] = (float)values[i];
+        free(values);
+        spectra = count / bins;
+    }
+
+    if (spectra != frameCount)
+        fprintf(stderr, "%lu frames but %lu spectra, checking the first %lu\n",
+                (unsigned long)frameCount, (unsigned long)spectra,
+                (unsigned long)(spectra < frameCount ? spectra : frameCount));
+    if (spectra < frameCount)
+        frameCount = spectra;
+    return 0;
+}
+
+static int compareSnr(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+int main(int argc, char *argv[])
+{
+    int threads = 0, rows = 64, arg, r, b;
+    double maxAllowed = INFINITY, minSnr = -INFINITY, start, elapsed;
+    const char *framesPath = NULL, *heatmapPath = NULL;
+    struct verify_task *tasks;
+    fft_task_group group = FFT_TASK_GROUP_INIT;
+    fft_pool *pool;
+    double *errSq, *binErrSq, *sortedSnr, snrSum = 0;
+    uint64_t *rowFrames, f, rowSize, worstFrame = 0, failed = 0, finite = 0;
+    size_t ntasks = 0, t;
+
+    for (arg = 1; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+        const char *v = argv[arg + 1];
+        switch (argv[arg][1]) {
+        case 't': threads = atoi(v); break;
+        case 'n': samples = atoi(v); break;
+        case 'e': maxAllowed = atof(v); break;
+        case 's': minSnr = atof(v); break;
+        case 'f': framesPath = v; break;
+        case 'm': heatmapPath = v; break;
+        case 'r': rows = atoi(v); break;
+        default: arg = argc; break;
+        }
+    }
+    if (argc - arg != 2 || rows < 1 || samples < 0 || samples % 2) {
+        fprintf(stderr, "usage: fft_verify [-t threads] [-n samples] [-e max err] [-s min SNR]\n"
+                        "                  [-f frames.csv] [-m heatmap.csv] [-r heatmap rows]\n"
+                        "                  input spectra\n");
+        return 1;
+    }
+
+    /* a CSV input takes its frame size from -n, else from the store */
+    if (samples == 0 && !endsWith(argv[arg], ".fcap") && endsWith(argv[arg + 1], ".fspec")) {
+        fft_store *s = fft_store_open(argv[arg + 1]);
+        if (s != NULL) {
+            samples = (int)fft_store_info(s)->samples;
+            fft_store_close(s);
+        }
+    }
+    if (samples == 0 && !endsWith(argv[arg], ".fcap"))
+        samples = 1024;
+    if (openInput(argv[arg]) != 0)
+        return 1;
+    bins = samples / 2;
+    if (openSpectra(argv[arg + 1]) != 0)
+        return 1;
+    if (frameCount == 0) {
+        fprintf(stderr, "nothing to check\n");
+        return 1;
+    }
+
+    /* heatmap rows of rowSize frames, each split into tasks */
+    if ((uint64_t)rows > frameCount)
+        rows = (int)frameCount;
+    rowSize = (frameCount + rows - 1) / rows;
+    rows = (int)((frameCount + rowSize - 1) / rowSize);
+    for (r = 0; r < rows; r++) {
+        uint64_t n = frameCount - r * rowSize < rowSize ? frameCount - r * rowSize : rowSize;
+        ntasks += (size_t)((n + VERIFY_CHUNK - 1) / VERIFY_CHUNK);
+    }
+
+    tasks = (struct verify_task *)calloc(ntasks, sizeof(*tasks));
+    errSq = (double *)calloc(ntasks * bins, sizeof(double));
+    binErrSq = (double *)calloc((size_t)rows * bins, sizeof(double));
+    rowFrames = (uint64_t *)calloc(rows, sizeof(uint64_t));
+    frameSnr = (double *)malloc(sizeof(double) * frameCount);
+    frameMaxErr = (float *)malloc(sizeof(float) * frameCount);
+    frameWorstBin = (int *)malloc(sizeof(int) * frameCount);
+    sortedSnr = (double *)malloc(sizeof(double) * frameCount);
+    pool = fft_pool_create(threads);
+    sharedCfg = kiss_fftr_alloc(samples, 0, NULL, NULL);
+    if (tasks == NULL || errSq == NULL || binErrSq == NULL || rowFrames == NULL
+            || frameSnr == NULL || frameMaxErr == NULL || frameWorstBin == NULL
+            || sortedSnr == NULL || pool == NULL || sharedCfg == NULL) {
+        fprintf(stderr, "could not set up %lu frames of %d samples\n",
+                (unsigned long)frameCount, samples);
+        return 1;
+    }
+    /* one plan for all unless kiss_fftr_work would write to it */
+    if (!kiss_fftr_shareable(sharedCfg)) {
+        free(sharedCfg);
+        sharedCfg = NULL;
+    }
+
+    t = 0;
+    for (r = 0; r < rows; r++) {
+        uint64_t end = (r + 1) * rowSize < frameCount ? (r + 1) * rowSize : frameCount;
+        for (f = r * rowSize; f < end; f += VERIFY_CHUNK, t++) {
+            tasks[t].first = f;
+            tasks[t].count = (size_t)(end - f < VERIFY_CHUNK ? end - f : VERIFY_CHUNK);
+            tasks[t].row = r;
+            tasks[t].errSq = errSq + t * bins;
+        }
+    }
+
+    start = now();
+    for (t = 0; t < ntasks; t++)
+        fft_pool_spawn(pool, &group, verifyTask, &tasks[t]);
+    fft_pool_wait(pool, &group);
+    elapsed = now() - start;
+
+    for (t = 0; t < ntasks; t++) {
+        rowFrames[tasks[t].row] += tasks[t].count;
+        for (b = 0; b < bins; b++)
+            binErrSq[tasks[t].row * bins + b] += tasks[t].errSq[b];
+    }
+
+    for (f = 0; f < frameCount; f++) {
+        if (frameMaxErr[f] > frameMaxErr[worstFrame])
+            worstFrame = f;
+        if (frameMaxErr[f] > maxAllowed || frameSnr[f] < minSnr)
+            failed++;
+        if (isfinite(frameSnr[f])) {
+            snrSum += frameSnr[f];
+            finite++;
+        }
+        sortedSnr[f] = frameSnr[f];
+    }
+    qsort(sortedSnr, frameCount, sizeof(double), compareSnr);
+
+    printf("%lu frames of N = %d in %.2f s on %d threads, %.0f frames/min\n",
+           (unsigned long)frameCount, samples, elapsed, fft_pool_threads(pool),
+           60 * frameCount / elapsed);
+    printf("SNR dB     min %.1f  median %.1f  mean %.1f\n", sortedSnr[0],
+           sortedSnr[frameCount / 2], finite ? snrSum / finite : INFINITY);
+    printf("max err    %.2f LSB in frame %lu bin %d\n", frameMaxErr[worstFrame],
+           (unsigned long)worstFrame, frameWorstBin[worstFrame]);
+    if (maxAllowed != INFINITY || minSnr != -INFINITY)
+        printf("%lu frames outside max err %g LSB / min SNR %g dB\n",
+               (unsigned long)failed, maxAllowed, minSnr);
+
+    if (framesPath != NULL) {
+        FILE *out = fopen(framesPath, "w");
+        if (out == NULL) {
+            perror(framesPath);
+            return 1;
+        }
+        fprintf(out, "frame,snr_db,max_err,worst_bin\n");
+        for (f = 0; f < frameCount; f++)
+            fprintf(out, "%lu,%.2f,%.3f,%d\n", (unsigned long)f, frameSnr[f],
+                    frameMaxErr[f], frameWorstBin[f]);
+        fclose(out);
+    }
+
+    if (heatmapPath != NULL) {
+        FILE *out = fopen(heatmapPath, "w");
+        if (out == NULL) {
+            perror(heatmapPath);
+            return 1;
+        }
+        /* RMS error of every bin over every row of frames */
+        fprintf(out, "first_frame");
+        for (b = 0; b < bins; b++)
+            fprintf(out, ",%d", b);
+        fprintf(out, "\n");
+        for (r = 0; r < rows; r++) {
+            fprintf(out, "%lu", (unsigned long)(r * rowSize));
+            for (b = 0; b < bins; b++)
+                fprintf(out, ",%.3f", sqrt(binErrSq[r * bins + b] / rowFrames[r]));
+            fprintf(out, "\n");
+        }
+        fclose(out);
+    }
+
+    fft_pool_destroy(pool);
+    free(sharedCfg);
+    if (cap)
+        fft_capture_close(cap);
+    if (store)
+        fft_store_close(store);
+    return failed ? 2 : 0;
+}
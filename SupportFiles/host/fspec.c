@@ -0,0 +1,203 @@
+/*
+ * fspec - build and query spectrum stores (fft_store.h).
+ *
+ *   fspec build [-t threads] [-c chunk frames] capture.fcap out.fspec
+ *       transform every frame of a capture (csv2fcap) as the firmware
+ *       would, with fft_batch, and store the spectra with the capture's
+ *       frame times
+ *   fspec info store.fspec
+ *   fspec query store.fspec from to firstBin lastBin
+ *       print the spectra between from and to seconds, limited to bins
+ *       firstBin to lastBin, as CSV rows of time then one value per bin
+ *
+ * A query maps the store and reads only the time blocks its binary search
+ * lands on and the blocks of the requested bins in the chunks it spans,
+ * which it reports on stderr.
+ *
+ * Build from SupportFiles/host:
+ *   gcc -O2 -I. -I../../uart_FFT_kissFFT/kissFFT fspec.c fft_store.c
+ *       fft_capture.c fft_batch.c fft_pool.c
+ *       ../../uart_FFT_kissFFT/kissFFT/kiss_fft.c
+ *       ../../uart_FFT_kissFFT/kissFFT/kiss_fftr.c -lm -lpthread -o fspec
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "fft_batch.h"
+#include "fft_capture.h"
+#include "fft_store.h"
+
+static int usage(void)
+{
+    fprintf(stderr, "usage: fspec build [-t threads] [-c chunk frames] capture.fcap out.fspec\n"
+                    "       fspec info store.fspec\n"
+                    "       fspec query store.fspec from to firstBin lastBin\n");
+    return 1;
+}
+
+static int build(int argc, char *argv[])
+{
+    int threads = 0, chunkFrames = 256, arg;
+    const struct fft_capture_header *info;
+    fft_capture *cap;
+    fft_pool *pool;
+    fft_batch *batch;
+    fft_store_writer *w;
+    int16_t *spectra;
+    uint64_t f;
+    size_t bins;
+
+    for (arg = 0; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+        if (strcmp(argv[arg], "-t") == 0)
+            threads = atoi(argv[arg + 1]);
+        else if (strcmp(argv[arg], "-c") == 0)
+            chunkFrames = atoi(argv[arg + 1]);
+        else
+            return usage();
+    }
+    if (argc - arg != 2 || chunkFrames <= 0)
+        return usage();
+
+    cap = fft_capture_open(argv[arg]);
+    if (cap == NULL) {
+        perror(argv[arg]);
+        return 1;
+    }
+    info = fft_capture_info(cap);
+    bins = info->samples / 2;
+
+    pool = fft_pool_create(threads);
+    batch = pool ? fft_batch_create((int)info->samples, pool) : NULL;
+    spectra = (int16_t *)malloc(sizeof(int16_t) * bins * chunkFrames);
+    if (batch == NULL || spectra == NULL) {
+        fprintf(stderr, "could not set up %u samples\n", info->samples);
+        return 1;
+    }
+    w = fft_store_create(argv[arg + 1], info->samples, info->sampleRate, (uint32_t)bins,
+                         (uint32_t)chunkFrames, FFT_STORE_INT16);
+    if (w == NULL) {
+        perror(argv[arg + 1]);
+        return 1;
+    }
+
+    /* a chunk's worth of frames at a time, straight from the map */
+    for (f = 0; f < info->frameCount; f += chunkFrames) {
+        size_t count = info->frameCount - f < (uint64_t)chunkFrames
+                     ? (size_t)(info->frameCount - f) : (size_t)chunkFrames;
+        size_t k;
+
+        fft_batch_run(batch, fft_capture_frame(cap, f), info->frameStride / 2, count, spectra);
+        for (k = 0; k < count; k++) {
+            if (fft_store_append(w, spectra + k * bins, fft_capture_time(cap, f + k)) != 0) {
+                perror(argv[arg + 1]);
+                return 1;
+            }
+        }
+    }
+    if (fft_store_finish(w) != 0) {
+        perror(argv[arg + 1]);
+        return 1;
+    }
+    printf("%lu spectra of %lu bins\n", (unsigned long)info->frameCount, (unsigned long)bins);
+
+    free(spectra);
+    fft_batch_destroy(batch);
+    fft_pool_destroy(pool);
+    fft_capture_close(cap);
+    return 0;
+}
+
+static fft_store *openStore(const char *path)
+{
+    fft_store *store = fft_store_open(path);
+    if (store == NULL)
+        perror(path);
+    return store;
+}
+
+static int showInfo(int argc, char *argv[])
+{
+    const struct fft_store_header *h;
+    fft_store *store;
+
+    if (argc != 1)
+        return usage();
+    store = openStore(argv[0]);
+    if (store == NULL)
+        return 1;
+    h = fft_store_info(store);
+    printf("N = %u at %u Hz, %u bins of %s\n", h->samples, h->sampleRate, h->bins,
+           h->valueType == FFT_STORE_INT16 ? "int16" : "float32");
+    printf("%lu spectra in chunks of %u, %u bytes each\n",
+           (unsigned long)h->frameCount, h->chunkFrames, h->chunkBytes);
+    if (h->frameCount)
+        printf("%.6f s to %.6f s\n", fft_store_time(store, 0) * 1e-9,
+               fft_store_time(store, h->frameCount - 1) * 1e-9);
+    fft_store_close(store);
+    return 0;
+}
+
+static int query(int argc, char *argv[])
+{
+    const struct fft_store_header *h;
+    fft_store *store;
+    uint64_t first, last, f;
+    uint32_t firstBin, lastBin, b, nbins;
+    size_t frames, valueBytes;
+    float *values;
+
+    if (argc != 5)
+        return usage();
+    store = openStore(argv[0]);
+    if (store == NULL)
+        return 1;
+    h = fft_store_info(store);
+
+    first = fft_store_find(store, (uint64_t)(atof(argv[1]) * 1e9 + 0.5));
+    last = fft_store_find(store, (uint64_t)(atof(argv[2]) * 1e9 + 0.5) + 1);
+    firstBin = (uint32_t)atol(argv[3]);
+    lastBin = (uint32_t)atol(argv[4]);
+    if (lastBin >= h->bins || firstBin > lastBin) {
+        fprintf(stderr, "bins must be within 0 to %u\n", h->bins - 1);
+        return 1;
+    }
+    nbins = lastBin - firstBin + 1;
+    frames = (size_t)(last - first);
+
+    values = (float *)malloc(sizeof(float) * (frames ? frames : 1) * nbins);
+    if (values == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    fft_store_read(store, first, frames, firstBin, nbins, values);
+
+    for (f = 0; f < frames; f++) {
+        printf("%.6f", fft_store_time(store, first + f) * 1e-9);
+        for (b = 0; b < nbins; b++)
+            printf(",%g", values[b * frames + f]);
+        printf("\n");
+    }
+
+    valueBytes = h->valueType == FFT_STORE_INT16 ? 2 : 4;
+    fprintf(stderr, "%lu spectra, %lu of %lu value bytes in their chunks read\n",
+            (unsigned long)frames, (unsigned long)(frames * nbins * valueBytes),
+            (unsigned long)(frames * h->bins * valueBytes));
+    free(values);
+    fft_store_close(store);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+        return usage();
+    if (strcmp(argv[1], "build") == 0)
+        return build(argc - 2, argv + 2);
+    if (strcmp(argv[1], "info") == 0)
+        return showInfo(argc - 2, argv + 2);
+    if (strcmp(argv[1], "query") == 0)
+        return query(argc - 2, argv + 2);
+    return usage();
+}
@@ -0,0 +1,331 @@
+/*
+ * Task parallel kiss_fft, see kiss_fftp.h.
+ *
+ * Level i of a plan splits a transform of n = p*m points the way kf_work
+ * does: sub transform k takes every p-th input from offset k and writes
+ * fout[k*m .. k*m+m). The butterfly for index u then combines the p values
+ * fout[u + k*m], multiplied by W_n^(u*k), with a p point DFT. Butterflies
+ * for different u are independent, which is what the recombination tasks
+ * split on.
+ */
+#include <string.h>
+
+#include "_kiss_fft_guts.h"
+#include "kiss_fftp.h"
+#include "kiss_ffts.h"
+#include "fft_plan_cache.h"
+
+/* butterflies per recombination task, and at most this many tasks */
+#define KISS_FFTP_CHUNK     2048
+#define KISS_FFTP_MAX_CHUNKS 64
+
+struct kiss_fftp_level {
+    int p;                      /* radix */
+    int m;                      /* length of the sub transforms */
+    kiss_fft_cpx * tw;          /* W_(p*m)^(u*k) at [u*(p-1) + k-1] */
+    kiss_fft_cpx * roots;       /* W_p^k */
+};
+
+struct kiss_fftp_state {
+    int nfft;
+    int inverse;
+    int nlevels;
+    struct kiss_fftp_level levels[MAXFACTORS];
+    kiss_ffts_cfg leaf;         /* sub transforms below the last level */
+    int leafn;
+    kiss_fft_cpx twiddles[1];
+};
+
+struct kf_par_job {
+    kiss_fftp_cfg st;
+    fft_pool * pool;
+    int level;
+    const kiss_fft_cpx * fin;
+    size_t fstride;
+    kiss_fft_cpx * fout;
+    kiss_fft_cpx * work;        /* the part of the call's buffer beside fout */
+};
+
+struct kf_par_bfly {
+    const struct kiss_fftp_level * lv;
+    kiss_fft_cpx * fout;
+    int inverse;
+    int u0, u1;
+};
+
+static void kf_par_bfly2(const struct kf_par_bfly * b)
+{
+    const int m = b->lv->m;
+    kiss_fft_cpx * F = b->fout;
+    int u;
+
+    for (u = b->u0; u < b->u1; ++u) {
+        kiss_fft_cpx t;
+        C_FIXDIV(F[u],2); C_FIXDIV(F[u+m],2);
+        C_MUL(t, F[u+m], b->lv->tw[u]);
+        C_SUB(F[u+m], F[u], t);
+        C_ADDTO(F[u], t);
+    }
+}
+
+/* kf_bfly4 for one range of u */
+static void kf_par_bfly4(const struct kf_par_bfly * b)
+{
+    const int m = b->lv->m, m2 = 2*m, m3 = 3*m;
+    const kiss_fft_cpx * tw = b->lv->tw;
+    kiss_fft_cpx * F = b->fout;
+    int u;
+
+    for (u = b->u0; u < b->u1; ++u) {
+        kiss_fft_cpx scratch[6];
+
+        C_FIXDIV(F[u],4); C_FIXDIV(F[u+m],4); C_FIXDIV(F[u+m2],4); C_FIXDIV(F[u+m3],4);
+
+        C_MUL(scratch[0], F[u+m], tw[3*u]);
+        C_MUL(scratch[1], F[u+m2], tw[3*u+1]);
+        C_MUL(scratch[2], F[u+m3], tw[3*u+2]);
+
+        C_SUB(scratch[5], F[u], scratch[1]);
+        C_ADDTO(F[u], scratch[1]);
+        C_ADD(scratch[3], scratch[0], scratch[2]);
+        C_SUB(scratch[4], scratch[0], scratch[2]);
+        C_SUB(F[u+m2], F[u], scratch[3]);
+        C_ADDTO(F[u], scratch[3]);
+
+        if (b->inverse) {
+            F[u+m].r = scratch[5].r - scratch[4].i;
+            F[u+m].i = scratch[5].i + scratch[4].r;
+            F[u+m3].r = scratch[5].r + scratch[4].i;
+            F[u+m3].i = scratch[5].i - scratch[4].r;
+        } else {
+            F[u+m].r = scratch[5].r + scratch[4].i;
+            F[u+m].i = scratch[5].i - scratch[4].r;
+            F[u+m3].r = scratch[5].r - scratch[4].i;
+            F[u+m3].i = scratch[5].i + scratch[4].r;
+        }
+    }
+}
+
+static void kf_par_bfly_generic(const struct kf_par_bfly * b)
+{
+    const int p = b->lv->p, m = b->lv->m;
+    const kiss_fft_cpx * tw = b->lv->tw;
+    const kiss_fft_cpx * roots = b->lv->roots;
+    kiss_fft_cpx * F = b->fout;
+    kiss_fft_cpx y[KISS_FFT_MAX_GENERIC_RADIX];
+    int u, k, q;
+
+    for (u = b->u0; u < b->u1; ++u) {
+        y[0] = F[u];
+        C_FIXDIV(y[0],p);
+        for (k = 1; k < p; ++k) {
+            kiss_fft_cpx t = F[u + k*m];
+            C_FIXDIV(t,p);
+            C_MUL(y[k], t, tw[u*(p-1) + k-1]);
+        }
+        for (q = 0; q < p; ++q) {
+            kiss_fft_cpx sum = y[0], t;
+            int idx = 0;
+            for (k = 1; k < p; ++k) {
+                idx += q;
+                if (idx >= p)
+                    idx -= p;
+                C_MUL(t, y[k], roots[idx]);
+                C_ADDTO(sum, t);
+            }
+            F[u + q*m] = sum;
+        }
+    }
+}
+
+static void kf_par_bfly(void * arg)
+{
+    const struct kf_par_bfly * b = (const struct kf_par_bfly *)arg;
+
+    switch (b->lv->p) {
+        case 2: kf_par_bfly2(b); break;
+        case 4: kf_par_bfly4(b); break;
+        default: kf_par_bfly_generic(b); break;
+    }
+}
+
+static void kf_par_leaf(const struct kf_par_job * job)
+{
+    const kiss_fftp_cfg st = job->st;
+    int t;
+
+    if (job->fstride == 1) {
+        kiss_ffts_work(st->leaf, job->fin, job->fout, job->work);
+    } else {
+        /* gather the decimated input into place and transform it there */
+        for (t = 0; t < st->leafn; ++t)
+            job->fout[t] = job->fin[t * job->fstride];
+        kiss_ffts_work(st->leaf, job->fout, job->fout, job->work);
+    }
+}
+
+static void kf_par_work(void * arg)
+{
+    const struct kf_par_job * job = (const struct kf_par_job *)arg;
+    const kiss_fftp_cfg st = job->st;
+    const struct kiss_fftp_level * lv;
+    struct kf_par_job sub[KISS_FFT_MAX_GENERIC_RADIX];
+    struct kf_par_bfly bfly[KISS_FFTP_MAX_CHUNKS];
+    fft_task_group group = FFT_TASK_GROUP_INIT;
+    int k, nchunks, per;
+
+    if (job->level == st->nlevels) {
+        kf_par_leaf(job);
+        return;
+    }
+    lv = &st->levels[job->level];
+
+    /* the sub transforms, the last one on this thread */
+    for (k = 0; k < lv->p; ++k) {
+        sub[k] = *job;
+        sub[k].level = job->level + 1;
+        sub[k].fin = job->fin + k * job->fstride;
+        sub[k].fstride = job->fstride * lv->p;
+        sub[k].fout = job->fout + k * lv->m;
+        sub[k].work = job->work + k * lv->m;
+        if (k < lv->p - 1)
+            fft_pool_spawn(job->pool, &group, kf_par_work, &sub[k]);
+    }
+    kf_par_work(&sub[lv->p - 1]);
+    fft_pool_wait(job->pool, &group);
+
+    /* then their recombination */
+    nchunks = (lv->m + KISS_FFTP_CHUNK - 1) / KISS_FFTP_CHUNK;
+    if (nchunks > KISS_FFTP_MAX_CHUNKS)
+        nchunks = KISS_FFTP_MAX_CHUNKS;
+    per = (lv->m + nchunks - 1) / nchunks;
+    for (k = 0; k < nchunks; ++k) {
+        bfly[k].lv = lv;
+        bfly[k].fout = job->fout;
+        bfly[k].inverse = st->inverse;
+        bfly[k].u0 = k * per;
+        bfly[k].u1 = (k + 1) * per < lv->m ? (k + 1) * per : lv->m;
+        if (k < nchunks - 1)
+            fft_pool_spawn(job->pool, &group, kf_par_bfly, &bfly[k]);
+    }
+    kf_par_bfly(&bfly[nchunks - 1]);
+    fft_pool_wait(job->pool, &group);
+}
+
+static void * kf_par_build(int nfft, int inverse)
+{
+    const double pi=3.141592653589793238462643383279502884197169399375105820974944;
+    int radices[MAXFACTORS];
+    int nlevels = 0, i, u, k, n, p;
+    size_t ntw = 0;
+    kiss_ffts_cfg leaf;
+    kiss_fftp_cfg st;
+    kiss_fft_cpx * tw;
+
+    if (nfft < 1)
+        return NULL;
+
+    /* peel radices off in kf_factor order until the rest fits a leaf */
+    for (n = nfft; n > KISS_FFTP_LEAF; n /= p) {
+        p = 4;
+        while (n % p) {
+            p = (p == 4) ? 2 : (p == 2) ? 3 : p + 2;
+            if ((double)p * p > n)
+                p = n;
+        }
+        if (p > KISS_FFT_MAX_GENERIC_RADIX)
+            return NULL;
+        radices[nlevels++] = p;
+        ntw += (size_t)(n / p) * (p - 1) + p;
+    }
+    leaf = kiss_ffts_plan(n, inverse);
+    if (leaf == NULL)
+        return NULL;
+
+    st = (kiss_fftp_cfg)KISS_FFT_MALLOC(sizeof(struct kiss_fftp_state)
+            + sizeof(kiss_fft_cpx)*ntw);
+    if (st == NULL)
+        return NULL;
+    st->nfft = nfft;
+    st->inverse = inverse;
+    st->nlevels = nlevels;
+    st->leaf = leaf;
+    st->leafn = n;
+
+    tw = st->twiddles;
+    for (i = 0, n = nfft; i < nlevels; ++i) {
+        struct kiss_fftp_level * lv = &st->levels[i];
+        lv->p = radices[i];
+        lv->m = n / lv->p;
+
+        lv->tw = tw;
+        for (u = 0; u < lv->m; ++u) {
+            for (k = 1; k < lv->p; ++k) {
+                double phase = -2*pi*((double)u*k) / n;
+                if (inverse)
+                    phase *= -1;
+                kf_cexp(tw, phase);
+                ++tw;
+            }
+        }
+        lv->roots = tw;
+        for (k = 0; k < lv->p; ++k) {
+            double phase = -2*pi*k / lv->p;
+            if (inverse)
+                phase *= -1;
+            kf_cexp(tw, phase);
+            ++tw;
+        }
+        n = lv->m;
+    }
+    return st;
+}
+
+/* the leaf plan belongs to the cache, not to this plan */
+static void kf_par_free(void * plan)
+{
+    KISS_FFT_FREE(plan);
+}
+
+static int kf_scalar_type(void)
+{
+#ifdef FIXED_POINT
+    return (FIXED_POINT == 32) ? FFT_SCALAR_Q31 : FFT_SCALAR_Q15;
+#else
+    return sizeof(kiss_fft_scalar) == sizeof(double) ? FFT_SCALAR_DOUBLE : FFT_SCALAR_FLOAT;
+#endif
+}
+
+kiss_fftp_cfg kiss_fftp_plan(int nfft,int inverse)
+{
+    return (kiss_fftp_cfg)fft_plan_cache_get(nfft, inverse, kf_scalar_type(),
+            kf_par_build, kf_par_free);
+}
+
+int kiss_fftp(kiss_fftp_cfg st,fft_pool *pool,const kiss_fft_cpx *fin,kiss_fft_cpx *fout)
+{
+    struct kf_par_job job;
+    kiss_fft_cpx * work;
+
+    /* every leaf works in the nfft point buffer beside its part of fout;
+       in place the input is copied behind that */
+    work = (kiss_fft_cpx*)KISS_FFT_MALLOC(sizeof(kiss_fft_cpx)*st->nfft*(fin == fout ? 2 : 1));
+    if (work == NULL)
+        return -1;
+    if (fin == fout) {
+        memcpy(work + st->nfft, fin, sizeof(kiss_fft_cpx)*st->nfft);
+        fin = work + st->nfft;
+    }
+
+    job.st = st;
+    job.pool = pool;
+    job.level = 0;
+    job.fin = fin;
+    job.fstride = 1;
+    job.fout = fout;
+    job.work = work;
+    kf_par_work(&job);
+
+    KISS_FFT_FREE(work);
+    return 0;
+}
@@ -0,0 +1,53 @@
+#ifndef KISS_FFTP_H
+#define KISS_FFTP_H
+
+#include "kiss_fft.h"
+#include "fft_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Task parallel kiss_fft for large transforms on the host.
+ *
+ * The decomposition is the one kiss_fft recurses through: nfft = p*m is p
+ * transforms of m points on the decimated input, then m radix p
+ * butterflies that recombine them. Here every sub transform is a task on a
+ * work stealing pool, split again until it is at most KISS_FFTP_LEAF
+ * points, where one thread finishes it with kiss_ffts. The butterflies of
+ * each recombination are split into tasks too, so the last pass over the
+ * whole array also runs on every thread instead of one.
+ *
+ * Scaling is that of kiss_fft for the same scalar type.
+ */
+
+/* sub transforms up to this size run on a single thread */
+#define KISS_FFTP_LEAF      8192
+
+typedef struct kiss_fftp_state * kiss_fftp_cfg;
+
+/*
+ * kiss_fftp_plan(nfft,inverse)
+ *
+ * Returns the plan for nfft points from the process wide plan cache, like
+ * kiss_ffts_plan, or NULL if nfft has a prime factor above
+ * KISS_FFT_MAX_GENERIC_RADIX. Plans do not depend on the pool, and one
+ * plan can be used by several threads at once.
+ * */
+kiss_fftp_cfg kiss_fftp_plan(int nfft,int inverse);
+
+/*
+ * kiss_fftp(cfg,pool,fin,fout)
+ *
+ * Transform fin into fout on the threads of pool. fin may equal fout, at
+ * the cost of a copy of the input. Returns 0, or -1 with fout untouched
+ * if there was no memory for the work buffer.
+ * */
+int kiss_fftp(kiss_fftp_cfg cfg,fft_pool *pool,const kiss_fft_cpx *fin,kiss_fft_cpx *fout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,401 @@
+/*
+ * Stockham autosort kiss_fft for the host, see kiss_ffts.h.
+ *
+ * A stage of radix p works on sub transforms of length n = p*m, s = nfft/n
+ * of them interleaved. It reads x[j + s*(q + r*m)] for r < p and writes the
+ * p point DFT, times W_n^(q*k), to y[j + s*(p*q + k)]. j is the innermost
+ * loop, so both buffers are walked in order; the next stage continues with
+ * length m and stride s*p. After the stage with m == 1 the result is in
+ * natural order.
+ *
+ * The stage with m == 1 reads and writes the same p elements for each j,
+ * so it can run in place. That is what lets fin == fout end up in fout
+ * without a copy when the number of stages is odd.
+ */
+#include "_kiss_fft_guts.h"
+#include "kiss_ffts.h"
+#include "fft_plan_cache.h"
+
+struct kiss_ffts_stage {
+    int p;                      /* radix */
+    int m;                      /* length of the sub transforms it produces */
+    int s;                      /* stride, nfft/(p*m) */
+    kiss_fft_cpx * tw;          /* W_(p*m)^(q*k) at [q*(p-1) + k-1] */
+    kiss_fft_cpx * roots;       /* W_p^k, for the generic butterfly */
+};
+
+struct kiss_ffts_state {
+    int nfft;
+    int inverse;
+    int nstages;
+    struct kiss_ffts_stage stages[MAXFACTORS];
+    kiss_fft_cpx twiddles[1];
+};
+
+static void kf_stockham2(const struct kiss_ffts_stage * sp,
+        const kiss_fft_cpx * x, kiss_fft_cpx * y)
+{
+    const int m = sp->m, s = sp->s;
+    int q, j;
+
+    for (q = 0; q < m; ++q) {
+        const kiss_fft_cpx * x0 = x + s*q;
+        const kiss_fft_cpx * x1 = x0 + s*m;
+        kiss_fft_cpx * y0 = y + s*2*q;
+        kiss_fft_cpx * y1 = y0 + s;
+        const kiss_fft_cpx w = sp->tw[q];
+
+        for (j = 0; j < s; ++j) {
+            kiss_fft_cpx a = x0[j], b = x1[j], t;
+            C_FIXDIV(a,2); C_FIXDIV(b,2);
+            C_ADD(y0[j], a, b);
+            C_SUB(t, a, b);
+            if (q)
+                C_MUL(y1[j], t, w);
+            else
+                y1[j] = t;
+        }
+    }
+}
+
+static void kf_stockham4(const struct kiss_ffts_stage * sp,
+        const kiss_fft_cpx * x, kiss_fft_cpx * y, int inverse)
+{
+    const int m = sp->m, s = sp->s;
+    int q, j;
+
+    for (q = 0; q < m; ++q) {
+        const kiss_fft_cpx * x0 = x + s*q;
+        const kiss_fft_cpx * x1 = x0 + s*m;
+        const kiss_fft_cpx * x2 = x1 + s*m;
+        const kiss_fft_cpx * x3 = x2 + s*m;
+        kiss_fft_cpx * y0 = y + s*4*q;
+        kiss_fft_cpx * y1 = y0 + s;
+        kiss_fft_cpx * y2 = y1 + s;
+        kiss_fft_cpx * y3 = y2 + s;
+        const kiss_fft_cpx w1 = sp->tw[3*q], w2 = sp->tw[3*q+1], w3 = sp->tw[3*q+2];
+
+        for (j = 0; j < s; ++j) {
+            kiss_fft_cpx a0 = x0[j], a1 = x1[j], a2 = x2[j], a3 = x3[j];
+            kiss_fft_cpx t0, t1, t2, t3, b1, b3;
+
+            C_FIXDIV(a0,4); C_FIXDIV(a1,4); C_FIXDIV(a2,4); C_FIXDIV(a3,4);
+            C_ADD(t0, a0, a2);
+            C_SUB(t1, a0, a2);
+            C_ADD(t2, a1, a3);
+            C_SUB(t3, a1, a3);
+
+            /* t1 -/+ j*t3, the sign flips for the inverse */
+            if (inverse) {
+                b1.r = t1.r - t3.i; b1.i = t1.i + t3.r;
+                b3.r = t1.r + t3.i; b3.i = t1.i - t3.r;
+            } else {
+                b1.r = t1.r + t3.i; b1.i = t1.i - t3.r;
+                b3.r = t1.r - t3.i; b3.i = t1.i + t3.r;
+            }
+
+            C_ADD(y0[j], t0, t2);
+            C_SUB(t0, t0, t2);
+            if (q) {
+                C_MUL(y1[j], b1, w1);
+                C_MUL(y2[j], t0, w2);
+                C_MUL(y3[j], b3, w3);
+            } else {
+                y1[j] = b1;
+                y2[j] = t0;
+                y3[j] = b3;
+            }
+        }
+    }
+}
+
+/* radix 3 and 5 follow kf_bfly3 and kf_bfly5, with the twiddles moved to the outputs */
+static void kf_stockham3(const struct kiss_ffts_stage * sp,
+        const kiss_fft_cpx * x, kiss_fft_cpx * y)
+{
+    const int m = sp->m, s = sp->s;
+    const kiss_fft_cpx epi3 = sp->roots[1];
+    int q, j;
+
+    for (q = 0; q < m; ++q) {
+        const kiss_fft_cpx * x0 = x + s*q;
+        const kiss_fft_cpx * x1 = x0 + s*m;
+        const kiss_fft_cpx * x2 = x1 + s*m;
+        kiss_fft_cpx * y0 = y + s*3*q;
+        kiss_fft_cpx * y1 = y0 + s;
+        kiss_fft_cpx * y2 = y1 + s;
+        const kiss_fft_cpx w1 = sp->tw[2*q], w2 = sp->tw[2*q+1];
+
+        for (j = 0; j < s; ++j) {
+            kiss_fft_cpx a0 = x0[j], a1 = x1[j], a2 = x2[j];
+            kiss_fft_cpx sum, dif, b1, b2;
+
+            C_FIXDIV(a0,3); C_FIXDIV(a1,3); C_FIXDIV(a2,3);
+            C_ADD(sum, a1, a2);
+            C_SUB(dif, a1, a2);
+            C_MULBYSCALAR(dif, epi3.i);
+
+            b1.r = a0.r - HALF_OF(sum.r);
+            b1.i = a0.i - HALF_OF(sum.i);
+            b2.r = b1.r + dif.i;
+            b2.i = b1.i - dif.r;
+            b1.r -= dif.i;
+            b1.i += dif.r;
+
+            C_ADD(y0[j], a0, sum);
+            if (q) {
+                C_MUL(y1[j], b1, w1);
+                C_MUL(y2[j], b2, w2);
+            } else {
+                y1[j] = b1;
+                y2[j] = b2;
+            }
+        }
+    }
+}
+
+static void kf_stockham5(const struct kiss_ffts_stage * sp,
+        const kiss_fft_cpx * x, kiss_fft_cpx * y)
+{
+    const int m = sp->m, s = sp->s;
+    const kiss_fft_cpx ya = sp->roots[1], yb = sp->roots[2];
+    int q, j;
+
+    for (q = 0; q < m; ++q) {
+        const kiss_fft_cpx * x0 = x + s*q;
+        const kiss_fft_cpx * x1 = x0 + s*m;
+        const kiss_fft_cpx * x2 = x1 + s*m;
+        const kiss_fft_cpx * x3 = x2 + s*m;
+        const kiss_fft_cpx * x4 = x3 + s*m;
+        kiss_fft_cpx * y0 = y + s*5*q;
+        kiss_fft_cpx * y1 = y0 + s;
+        kiss_fft_cpx * y2 = y1 + s;
+        kiss_fft_cpx * y3 = y2 + s;
+        kiss_fft_cpx * y4 = y3 + s;
+        const kiss_fft_cpx * w = sp->tw + 4*q;
+
+        for (j = 0; j < s; ++j) {
+            kiss_fft_cpx a0 = x0[j], a1 = x1[j], a2 = x2[j], a3 = x3[j], a4 = x4[j];
+            kiss_fft_cpx s14, d14, s23, d23, c1, r1, c2, r2, b[5];
+
+            C_FIXDIV(a0,5); C_FIXDIV(a1,5); C_FIXDIV(a2,5); C_FIXDIV(a3,5); C_FIXDIV(a4,5);
+            C_ADD(s14, a1, a4);
+            C_SUB(d14, a1, a4);
+            C_ADD(s23, a2, a3);
+            C_SUB(d23, a2, a3);
+
+            b[0].r = a0.r + s14.r + s23.r;
+            b[0].i = a0.i + s14.i + s23.i;
+
+            c1.r = a0.r + S_MUL(s14.r,ya.r) + S_MUL(s23.r,yb.r);
+            c1.i = a0.i + S_MUL(s14.i,ya.r) + S_MUL(s23.i,yb.r);
+            r1.r =  S_MUL(d14.i,ya.i) + S_MUL(d23.i,yb.i);
+            r1.i = -S_MUL(d14.r,ya.i) - S_MUL(d23.r,yb.i);
+            C_SUB(b[1], c1, r1);
+            C_ADD(b[4], c1, r1);
+
+            c2.r = a0.r + S_MUL(s14.r,yb.r) + S_MUL(s23.r,ya.r);
+            c2.i = a0.i + S_MUL(s14.i,yb.r) + S_MUL(s23.i,ya.r);
+            r2.r = -S_MUL(d14.i,yb.i) + S_MUL(d23.i,ya.i);
+            r2.i =  S_MUL(d14.r,yb.i) - S_MUL(d23.r,ya.i);
+            C_ADD(b[2], c2, r2);
+            C_SUB(b[3], c2, r2);
+
+            y0[j] = b[0];
+            if (q) {
+                C_MUL(y1[j], b[1], w[0]);
+                C_MUL(y2[j], b[2], w[1]);
+                C_MUL(y3[j], b[3], w[2]);
+                C_MUL(y4[j], b[4], w[3]);
+            } else {
+                y1[j] = b[1];
+                y2[j] = b[2];
+                y3[j] = b[3];
+                y4[j] = b[4];
+            }
+        }
+    }
+}
+
+static void kf_stockham_generic(const struct kiss_ffts_stage * sp,
+        const kiss_fft_cpx * x, kiss_fft_cpx * y)
+{
+    const int p = sp->p, m = sp->m, s = sp->s;
+    kiss_fft_cpx a[KISS_FFT_MAX_GENERIC_RADIX];
+    int q, j, r, k;
+
+    for (q = 0; q < m; ++q) {
+        for (j = 0; j < s; ++j) {
+            for (r = 0; r < p; ++r) {
+                a[r] = x[j + s*(q + r*m)];
+                C_FIXDIV(a[r],p);
+            }
+            for (k = 0; k < p; ++k) {
+                kiss_fft_cpx sum = a[0], t;
+                int idx = 0;
+                for (r = 1; r < p; ++r) {
+                    idx += k;
+                    if (idx >= p)
+                        idx -= p;
+                    C_MUL(t, a[r], sp->roots[idx]);
+                    C_ADDTO(sum, t);
+                }
+                if (q && k)
+                    C_MUL(y[j + s*(p*q + k)], sum, sp->tw[q*(p-1) + k-1]);
+                else
+                    y[j + s*(p*q + k)] = sum;
+            }
+        }
+    }
+}
+
+static void kf_stage(const struct kiss_ffts_stage * sp,
+        const kiss_fft_cpx * x, kiss_fft_cpx * y, int inverse)
+{
+    switch (sp->p) {
+        case 2: kf_stockham2(sp, x, y); break;
+        case 3: kf_stockham3(sp, x, y); break;
+        case 4: kf_stockham4(sp, x, y, inverse); break;
+        case 5: kf_stockham5(sp, x, y); break;
+        default: kf_stockham_generic(sp, x, y); break;
+    }
+}
+
+/* Same radix choice as kf_factor in kiss_fft.c: 4s, then 2s, then odd primes */
+static int kf_stockham_factor(int n, int * radices)
+{
+    int p = 4, count = 0;
+    double floor_sqrt = floor( sqrt((double)n) );
+
+    do {
+        while (n % p) {
+            switch (p) {
+                case 4: p = 2; break;
+                case 2: p = 3; break;
+                default: p += 2; break;
+            }
+            if (p > floor_sqrt)
+                p = n;
+        }
+        n /= p;
+        radices[count++] = p;
+    } while (n > 1);
+    return count;
+}
+
+static void * kf_stockham_build(int nfft, int inverse)
+{
+    const double pi=3.141592653589793238462643383279502884197169399375105820974944;
+    int radices[MAXFACTORS];
+    int nstages, i, q, k, n, s;
+    size_t ntw = 0;
+    kiss_ffts_cfg st;
+    kiss_fft_cpx * tw;
+
+    if (nfft < 1)
+        return NULL;
+    nstages = kf_stockham_factor(nfft, radices);
+    for (i = 0, n = nfft; i < nstages; ++i) {
+        if (radices[i] > KISS_FFT_MAX_GENERIC_RADIX)
+            return NULL;
+        n /= radices[i];
+        ntw += (size_t)n*(radices[i]-1) + radices[i];
+    }
+
+    st = (kiss_ffts_cfg)KISS_FFT_MALLOC(sizeof(struct kiss_ffts_state)
+            + sizeof(kiss_fft_cpx)*ntw);
+    if (st == NULL)
+        return NULL;
+    st->nfft = nfft;
+    st->inverse = inverse;
+    st->nstages = nstages;
+
+    /* W_(p*m)^(q*k) = W_nfft^(q*k*s), exact as q*k*s < nfft */
+    tw = st->twiddles;
+    for (i = 0, n = nfft, s = 1; i < nstages; ++i) {
+        struct kiss_ffts_stage * sp = &st->stages[i];
+        sp->p = radices[i];
+        sp->m = n / sp->p;
+        sp->s = s;
+
+        sp->tw = tw;
+        for (q = 0; q < sp->m; ++q) {
+            for (k = 1; k < sp->p; ++k) {
+                double phase = -2*pi*((double)q*k*s) / nfft;
+                if (inverse)
+                    phase *= -1;
+                kf_cexp(tw, phase);
+                ++tw;
+            }
+        }
+        sp->roots = tw;
+        for (k = 0; k < sp->p; ++k) {
+            double phase = -2*pi*k / sp->p;
+            if (inverse)
+                phase *= -1;
+            kf_cexp(tw, phase);
+            ++tw;
+        }
+
+        n = sp->m;
+        s *= sp->p;
+    }
+    return st;
+}
+
+static void kf_stockham_free(void * plan)
+{
+    KISS_FFT_FREE(plan);
+}
+
+static int kf_scalar_type(void)
+{
+#ifdef FIXED_POINT
+    return (FIXED_POINT == 32) ? FFT_SCALAR_Q31 : FFT_SCALAR_Q15;
+#else
+    return sizeof(kiss_fft_scalar) == sizeof(double) ? FFT_SCALAR_DOUBLE : FFT_SCALAR_FLOAT;
+#endif
+}
+
+kiss_ffts_cfg kiss_ffts_plan(int nfft,int inverse)
+{
+    return (kiss_ffts_cfg)fft_plan_cache_get(nfft, inverse, kf_scalar_type(),
+            kf_stockham_build, kf_stockham_free);
+}
+
+void kiss_ffts_work(kiss_ffts_cfg st,const kiss_fft_cpx *fin,kiss_fft_cpx *fout,kiss_fft_cpx *work)
+{
+    const kiss_fft_cpx * src = fin;
+    int last = st->nstages;
+    int i;
+
+    /* In place with an odd number of stages, the last one runs in place so
+       the ping-pong between fout and work still ends in fout. */
+    if (fin == fout && (last & 1))
+        --last;
+
+    for (i = 0; i < last; ++i) {
+        kiss_fft_cpx * dst = ((last - 1 - i) & 1) ? work : fout;
+        kf_stage(&st->stages[i], src, dst, st->inverse);
+        src = dst;
+    }
+    if (last < st->nstages)
+        kf_stage(&st->stages[last], fout, fout, st->inverse);
+}
+
+void kiss_ffts(kiss_ffts_cfg st,const kiss_fft_cpx *fin,kiss_fft_cpx *fout)
+{
+    kiss_fft_cpx * work = (kiss_fft_cpx*)KISS_FFT_MALLOC(sizeof(kiss_fft_cpx)*st->nfft);
+    kiss_ffts_work(st, fin, fout, work);
+    KISS_FFT_FREE(work);
+}
+
+int kiss_ffts_nfft(kiss_ffts_cfg st)
+{
+    return st->nfft;
+}
+
+void kiss_ffts_cleanup(void)
+{
+    fft_plan_cache_clear();
+}
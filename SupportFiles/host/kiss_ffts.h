@@ -0,0 +1,63 @@
+#ifndef KISS_FFTS_H
+#define KISS_FFTS_H
+
+#include "kiss_fft.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Stockham autosort version of kiss_fft for large transforms on the host.
+ *
+ * kiss_fft recurses depth first and, when fin == fout, copies the whole
+ * result out of a temporary buffer. Here every stage is one pass over the
+ * data, reading one buffer and writing the other in natural order, with
+ * the innermost loop running over consecutive elements. There is no bit
+ * reversal and no final copy, including when fin == fout.
+ *
+ * Scaling is that of kiss_fft for the same scalar type. Fixed point results
+ * can differ from kiss_fft in the last few bits, as the rounding happens in
+ * a different order.
+ */
+
+typedef struct kiss_ffts_state * kiss_ffts_cfg;
+
+/*
+ * kiss_ffts_plan(nfft,inverse)
+ *
+ * Returns the plan for nfft points from the process wide plan cache,
+ * building it on first use. Plans are read only and shared, so they must
+ * not be freed; kiss_ffts_cleanup frees all of them.
+ * Returns NULL if nfft has a prime factor above KISS_FFT_MAX_GENERIC_RADIX;
+ * use kiss_fft for those.
+ * */
+kiss_ffts_cfg kiss_ffts_plan(int nfft,int inverse);
+
+/*
+ * kiss_ffts(cfg,fin,fout)
+ *
+ * Transform fin into fout, which may be the same buffer. Allocates a work
+ * buffer of nfft points for the call.
+ * */
+void kiss_ffts(kiss_ffts_cfg cfg,const kiss_fft_cpx *fin,kiss_fft_cpx *fout);
+
+/*
+ * kiss_ffts_work(cfg,fin,fout,work)
+ *
+ * Same as kiss_ffts with a caller supplied work buffer of nfft points,
+ * which lets threads that share a plan keep one buffer each.
+ * */
+void kiss_ffts_work(kiss_ffts_cfg cfg,const kiss_fft_cpx *fin,kiss_fft_cpx *fout,kiss_fft_cpx *work);
+
+/* number of points of a plan */
+int kiss_ffts_nfft(kiss_ffts_cfg cfg);
+
+/* free every cached plan */
+void kiss_ffts_cleanup(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,41 @@
+/*
+ * Host stand-in for the few QmathLib functions used by the firmware FFTs,
+ * so qfft.c can be built and measured on a PC. Multiplies truncate like the
+ * MSP432 library; the trig and magnitude functions go through double and
+ * are therefore slightly more accurate than the real ones.
+ */
+#ifndef QMATHLIB_HOST_H
+#define QMATHLIB_HOST_H
+
+#include <stdint.h>
+#include <math.h>
+
+#ifndef GLOBAL_Q
+#define GLOBAL_Q    24
+#endif
+
+typedef int32_t _q;
+
+#define _Q(A)           ((_q)((A) * (double)(1L << GLOBAL_Q)))
+#define _Qmpy(A, B)     ((_q)(((int64_t)(A) * (B)) >> GLOBAL_Q))
+#define _Qdiv2(A)       ((A) >> 1)
+#define _Qmpy2(A)       ((A) << 1)
+
+static inline double _QtoF(_q A)
+{
+    return (double)A / (double)(1L << GLOBAL_Q);
+}
+
+static inline _q _QfromF(double A)
+{
+    double r = floor(A * (double)(1L << GLOBAL_Q) + 0.5);
+    if (r > INT32_MAX) return INT32_MAX;
+    if (r < INT32_MIN) return INT32_MIN;
+    return (_q)r;
+}
+
+static inline _q _Qcos(_q A) { return _QfromF(cos(_QtoF(A))); }
+static inline _q _Qsin(_q A) { return _QfromF(sin(_QtoF(A))); }
+static inline _q _Qmag(_q A, _q B) { return _QfromF(hypot(_QtoF(A), _QtoF(B))); }
+
+#endif
@@ -0,0 +1,185 @@
+'''
+SRAM budget of a firmware build, from its linker map and, with a board
+or fft_sim, from the memory telemetry, to pick the largest FFT size that
+safely fits.
+
+From the map (Debug/<project>.map of the build configuration) it lists
+what each memory region holds and splits SRAM_DATA into the static data
+(.vtable, .data, .bss), the heap (.sysmem, --heap_size), the stack
+(--stack_size) and what is left unused.
+
+Given a port it then selects every plan size the board offers, sends a
+frame of each and reads the telemetry: the bytes the engine's plan needs
+for the size, and how deep the painted stack has been since reset. A size
+fits when its plan and the heap's own block header fit the heap, and the
+stack peak stays inside the stack section; a peak past it means the
+stack has run into the unused SRAM under it, which nothing checks.
+
+The board's frame buffers are sized by its largest plan (MAX_SAMPLES),
+so for larger sizes the stack grows by SAMPLE_BYTES for every sample and
+the plan as the measured plans do. The last line is the largest power of
+two size that fits SRAM_DATA with the stack and heap resized to match,
+keeping STACK_MARGIN spare. A LARGE_FRAMES build keeps the frame in
+.bss instead, sized for 16384 samples, so there the map's static data
+already holds it and only the plan table applies.
+
+Usage: sram_budget.py map [port]
+Run the board freshly reset, so the stack peak is this run's.
+'''
+
+import random
+import re
+import sys
+import fft_protocol
+import fft_session
+
+#Bytes of stack per sample in the work buffer: a complex Q12 pair with cFFT
+#built in (fftEngine/fft_engine.h), 4 for kissFFT's in[] and out[] alone
+SAMPLE_BYTES = 8
+
+#malloc's block header in the TI run time library
+HEAP_OVERHEAD = 8
+
+#Spare stack kept on top of the measured peak for interrupts and the unforeseen
+STACK_MARGIN = 256
+
+SRAM = 'SRAM_DATA'
+
+
+def read_map(path):
+    '''(regions, sections) of a TI linker map'''
+    regions = {}
+    sections = {}
+    part = None
+    with open(path) as f:
+        for line in f:
+            if line.startswith('MEMORY CONFIGURATION'):
+                part = 'memory'
+            elif line.startswith('SEGMENT ALLOCATION MAP'):
+                part = None
+            elif line.startswith('SECTION ALLOCATION MAP'):
+                part = 'sections'
+            elif line.startswith('GLOBAL SYMBOLS'):
+                part = None
+            elif part == 'memory':
+                m = re.match(r'\s+(\w+)\s+([0-9a-f]{8})\s+([0-9a-f]{8})\s+([0-9a-f]{8})', line)
+                if m:
+                    regions[m.group(1)] = (int(m.group(2), 16), int(m.group(3), 16),
+                                           int(m.group(4), 16))
+            elif part == 'sections':
+                m = re.match(r'(\.[\w.]+)\s+\d+\s+([0-9a-f]{8})\s+([0-9a-f]{8})', line)
+                if m:
+                    sections[m.group(1)] = (int(m.group(2), 16), int(m.group(3), 16))
+    return regions, sections
+
+
+def region_of(regions, address):
+    for name, (origin, length, used) in regions.items():
+        if origin <= address < origin + length:
+            return name
+    return None
+
+
+def print_map(regions, sections):
+    print "%-12s %10s %10s %10s" % ('region', 'length', 'used', 'unused')
+    for name, (origin, length, used) in sorted(regions.items(), key=lambda r: r[1][0]):
+        print "%-12s %10d %10d %10d" % (name, length, used, length - used)
+    print
+
+    if SRAM not in regions:
+        return
+    size = lambda name: sections.get(name, (0, 0))[1]
+    static = size('.vtable') + size('.data') + size('.bss')
+    heap = size('.sysmem')
+    stack = size('.stack')
+    print "%s:" % SRAM
+    for name in sorted(sections, key=lambda s: sections[s][0]):
+        origin, length = sections[name]
+        if region_of(regions, origin) == SRAM:
+            print "  %-12s 0x%08x %8d" % (name, origin, length)
+    print "  static %d, heap %d, stack %d, unused %d of %d bytes" % (
+        static, heap, stack, regions[SRAM][1] - static - heap - stack, regions[SRAM][1])
+    print
+
+
+def measure(port):
+    '''Memory telemetry after a frame of every plan size, smallest first'''
+    s = fft_session.open_port(port, 9600)
+    caps = fft_protocol.query_capabilities(s)
+    rows = []
+    for samples in sorted(caps['plans']):
+        fft_protocol.select_size(s, samples)
+        fft_protocol.send_frame(s, [random.randint(-32768, 32767) for n in range(samples)])
+        frame_caps = dict(caps)
+        frame_caps['samples'] = samples
+        fft_protocol.read_any_spectrum(s, frame_caps)
+        rows.append((samples, fft_protocol.query_telemetry(s)))
+    fft_protocol.select_size(s, caps['samples'])
+    s.close()
+    return rows
+
+
+def print_plans(rows):
+    print "%8s %10s %10s %10s  %s" % ('size', 'plan', 'heap', 'stack', 'fits')
+    fits = []
+    for samples, t in rows:
+        heap_ok = t['heap_size'] == 0 or t['plan_bytes'] + HEAP_OVERHEAD <= t['heap_size']
+        stack_ok = t['stack_peak'] <= t['stack_size']
+        if heap_ok and stack_ok:
+            fits.append(samples)
+        print "%8d %10d %10d %10d  %s" % (
+            samples, t['plan_bytes'], t['heap_size'], t['stack_peak'],
+            'yes' if heap_ok and stack_ok else
+            ', '.join(n for n, ok in (('heap', heap_ok), ('stack', stack_ok)) if not ok))
+    last = rows[-1][1]
+    print "stack section %d bytes, plan memory %d bytes for the largest plan" % (
+        last['stack_size'], last['plan_memory'])
+    if last['stack_peak'] > last['stack_size']:
+        print "the stack has run %d bytes past its section into unused SRAM" % (
+            last['stack_peak'] - last['stack_size'])
+    if fits:
+        print "largest size that fits as linked: %d" % max(fits)
+    print
+
+
+def largest_size(regions, sections, rows):
+    '''Largest power of two size whose plan and stack fit SRAM_DATA'''
+    if SRAM not in regions or len(rows) < 2:
+        return None
+    size = lambda name: sections.get(name, (0, 0))[1]
+    room = regions[SRAM][1] - size('.vtable') - size('.data') - size('.bss')
+
+    #Plan bytes grow about linearly with the size, fit them through the two largest
+    (n0, t0), (n1, t1) = rows[-2], rows[-1]
+    slope = float(t1['plan_bytes'] - t0['plan_bytes']) / (n1 - n0)
+    plan = lambda n: t1['plan_bytes'] + slope * (n - n1)
+    #What the stack holds besides the frame buffers of the largest plan
+    stack_base = rows[-1][1]['stack_peak'] - SAMPLE_BYTES * n1
+    stack = lambda n: stack_base + SAMPLE_BYTES * n + STACK_MARGIN
+
+    best = None
+    n = 64
+    while plan(n) + HEAP_OVERHEAD + stack(n) <= room:
+        best = n
+        n *= 2
+    if best is not None:
+        print "largest power of two size in %s: %d (heap %d, stack %d bytes)" % (
+            SRAM, best, int(plan(best)) + HEAP_OVERHEAD, int(stack(best)))
+    return best
+
+
+def main(argv):
+    if len(argv) not in (1, 2):
+        print __doc__
+        return 1
+    regions, sections = read_map(argv[0])
+    print_map(regions, sections)
+    if len(argv) == 2:
+        rows = measure(argv[1])
+        print_plans(rows)
+        largest_size(regions, sections, rows)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))
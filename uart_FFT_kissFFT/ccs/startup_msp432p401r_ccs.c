@@ -39,6 +39,21 @@
 /* Linker variable that marks the top of the stack. */
 extern unsigned long __STACK_END;
 
+/* End of .data, .bss and .sysmem, see msp432p401r.cmd. */
+extern unsigned long __SRAM_DATA_END;
+
+/* Pattern the free SRAM below the stack is painted with at reset, so the */
+/* application can find how deep the stack has ever reached. Keep it the  */
+/* same as STACK_PAINT in uart_FFT_kissFFT.c.                              */
+#define STACK_PAINT     0xA5C3A5C3
+
+#ifdef RAMFUNC_KERNELS
+#include <cpy_tbl.h>
+
+/* Copy table of the FFT kernels run from SRAM_CODE, see msp432p401r.cmd. */
+extern COPY_TABLE ramfuncCopyTable;
+#endif
+
 /* External declaration for the reset handler that is to be called when the */
 /* processor is started                                                     */
 extern void _c_int00(void);
@@ -180,8 +195,26 @@ void (* const interruptVectors[])(void) =
 /* application.                                                                */
 void Reset_Handler(void)
 {
+    volatile uint32_t here;
+    uint32_t *p;
+
+    /* Halts WDT_A, which would reset the board long before the copy and */
+    /* the paint below are done at the 3MHz reset clock.                  */
     SystemInit();
 
+#ifdef RAMFUNC_KERNELS
+    /* Copy the FFT kernels from flash to SRAM_CODE, whose 8KB the linker */
+    /* keeps apart from SRAM_DATA, before anything can call them.         */
+    copy_in(&ramfuncCopyTable);
+#endif
+
+    /* Paint from the end of the data up to a little below this frame; the */
+    /* stack section and the unused SRAM under it are one free run, and a  */
+    /* stack that outgrows its section still shows in the high water mark. */
+    for (p = (uint32_t *)(((uint32_t)&__SRAM_DATA_END + 3) & ~3u);
+         p < (uint32_t *)&here - 16; p++)
+        *p = STACK_PAINT;
+
     /* Jump to the CCS C Initialization Routine. */
     __asm("    .global _c_int00\n"
           "    b.w     _c_int00");
@@ -0,0 +1,86 @@
+/*
+ * In place engine, see fft_engine.h. inplace_fftr (staticFFT/) turns the
+ * received Q15 samples into their spectrum in the same bytes, so the work
+ * buffer is 2 bytes a sample and the plan only holds log2(n); the twiddles
+ * are a table in flash. This is what lets LARGE_FRAMES fit 16384 samples
+ * in SRAM_DATA.
+ *
+ * As with the kissFFT engine the Q12 samples are taken as Q15 and _Qmag
+ * only sees raw values, so the magnitudes are on the usual |DFT|/N scale.
+ */
+#include "fft_engine.h"
+
+#ifdef ENGINE_INPLACE
+
+#include <math.h>
+
+ /* Select the global Q value */
+ #define GLOBAL_Q    12
+
+ /* Include the iqmathlib header files */
+ #include <ti/iqmathlib/QmathLib.h>
+
+typedef struct inplace_plan {
+    uint16_t log2n;
+} inplace_plan;
+
+static size_t inplacePlanSize(uint16_t n)
+{
+    if (n < 8 || n > INPLACE_FFTR_MAX || (n & (n-1)) != 0)
+        return 0;
+    return sizeof(inplace_plan);
+}
+
+static size_t inplaceWorkSize(uint16_t n)
+{
+    return INPLACE_WORK_BYTES(n);
+}
+
+static void *inplacePlan(uint16_t n, void *memory)
+{
+    inplace_plan *plan = (inplace_plan *)memory;
+
+    plan->log2n = 0;
+    while ((1u << plan->log2n) < n)
+        plan->log2n++;
+    return plan;
+}
+
+static int inplaceExecute(void *plan, uint16_t n, void *work)
+{
+    inplace_fftr(n, (int16_t *)work);
+#ifdef BFP_OUTPUT
+    /* Every stage was halved, so the exponent is log2(n). */
+    return ((inplace_plan *)plan)->log2n;
+#else
+    return 0;
+#endif
+}
+
+static void inplaceMagnitude(void *plan, uint16_t n, void *work)
+{
+    const int16_t *bins = (const int16_t *)work;
+    fft_magnitude *mag = (fft_magnitude *)work;
+    uint16_t i;
+
+    /* Bin 0 is real, its imaginary half holds bin n/2, which is not sent. */
+#ifdef KISS_FFT_FLOAT
+    mag[0] = fabsf((float)bins[0]);
+    for (i = 1; i < n/2; i++) {
+        mag[i] = sqrtf((float)bins[2*i]*bins[2*i] + (float)bins[2*i+1]*bins[2*i+1]);
+    }
+#else
+    mag[0] = _Qmag(bins[0], 0);
+    /* mag[i] lies below bins[2*i], which is read first */
+    for (i = 1; i < n/2; i++) {
+        mag[i] = _Qmag(bins[2*i], bins[2*i+1]);
+    }
+#endif
+}
+
+const fft_engine fftEngineInplace = {
+    "inplace", inplacePlanSize, inplaceWorkSize, inplacePlan, inplaceExecute,
+    inplaceMagnitude
+};
+
+#endif
@@ -0,0 +1,114 @@
+/*
+ * kissFFT engine, see fft_engine.h. kiss_fftr on the project's scalar type,
+ * in[] at the start of the work buffer and out[] right after it.
+ *
+ * With FIXED_POINT 32 the received Q15 samples are moved to the top half of
+ * 32 bit words and the whole FFT runs in Q31, so large frames and small
+ * signals keep their precision through the stages. The magnitudes are
+ * rounded back to the usual 16 bit words. With KISS_FFT_FLOAT the samples
+ * are converted to float and the magnitudes stay float.
+ *
+ * The samples are Q12 as IQmathFFT.m writes them and the FFT takes the
+ * same raw values as Q15, rescale<q15> in staticFFT/fixed.hpp: it sees
+ * them 8 times smaller and its results are as much smaller, so read back
+ * as Q12 they are the spectrum of the samples. _Qmag only works on the raw
+ * values, sqrt(r*r + i*i), so its GLOBAL_Q does not matter here.
+ */
+#include "fft_engine.h"
+
+#ifdef ENGINE_KISS
+
+#include <math.h>
+
+#include "../kissFFT/kiss_fftr.h"
+#include "../staticFFT/static_fftr.h"
+
+ /* Select the global Q value */
+ #define GLOBAL_Q    12
+
+ /* Include the iqmathlib header files */
+ #include <ti/iqmathlib/QmathLib.h>
+#if (FIXED_POINT == 32)
+ #include <ti/iqmathlib/IQmathLib.h>
+#endif
+
+static size_t kissPlanSize(uint16_t n)
+{
+    size_t len = 0;
+
+    /* kiss_fftr only does even sizes */
+    if (n & 1)
+        return 0;
+    kiss_fftr_alloc(n,0,NULL,&len);
+    return len;
+}
+
+static size_t kissWorkSize(uint16_t n)
+{
+    return KISS_WORK_BYTES(n);
+}
+
+static void *kissPlan(uint16_t n, void *memory)
+{
+    size_t len = kissPlanSize(n);
+
+    return kiss_fftr_alloc(n,0,memory,&len);
+}
+
+static int kissExecute(void *plan, uint16_t n, void *work)
+{
+    kiss_fft_scalar *in = (kiss_fft_scalar *)work;
+    kiss_fft_cpx *out = (kiss_fft_cpx *)(in + n);
+#if defined(KISS_FFT_FLOAT) || (FIXED_POINT == 32)
+    int16_t i;
+#endif
+
+#if defined(KISS_FFT_FLOAT)
+    /* Widen the received samples, last first so none is overwritten. */
+    for (i = n-1; i >= 0; i--) {
+        in[i] = ((int16_t*)in)[i];
+    }
+#elif (FIXED_POINT == 32)
+    /* Q15 to Q31, last first so none is overwritten. */
+    for (i = n-1; i >= 0; i--) {
+        in[i] = (int32_t)((int16_t*)in)[i] * 65536;
+    }
+#endif
+
+#ifdef BFP_OUTPUT
+    return kiss_fftr_bfp((kiss_fftr_cfg)plan,in,out);
+#else
+#ifdef STATIC_FFT
+    if (!static_fftr(n,in,out))
+#endif
+    kiss_fftr((kiss_fftr_cfg)plan,in,out);
+    return 0;
+#endif
+}
+
+static void kissMagnitude(void *plan, uint16_t n, void *work)
+{
+    kiss_fft_cpx *out = (kiss_fft_cpx *)((kiss_fft_scalar *)work + n);
+    fft_magnitude *mag = (fft_magnitude *)work;
+    int16_t i;
+
+#ifdef KISS_FFT_FLOAT
+    for (i = 0; i < n/2; i++) {
+        mag[i] = sqrtf(out[i].r*out[i].r + out[i].i*out[i].i) / n;
+    }
+#elif (FIXED_POINT == 32)
+    for (i = 0; i < n/2; i++) {
+        mag[i] = ((_IQmag(out[i].r, out[i].i) >> 15) + 1) >> 1;
+    }
+#else
+    for (i = 0; i < n/2; i++) {
+        mag[i] = _Qmag(out[i].r, out[i].i);
+    }
+#endif
+}
+
+const fft_engine fftEngineKiss = {
+    "kissFFT", kissPlanSize, kissWorkSize, kissPlan, kissExecute, kissMagnitude
+};
+
+#endif
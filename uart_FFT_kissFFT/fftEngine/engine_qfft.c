@@ -0,0 +1,112 @@
+/*
+ * IQmath cFFT engine, see fft_engine.h. The received 16 bit samples are
+ * taken as Q12 _q values, as IQmathFFT.m writes them, spread over the work
+ * buffer as a complex array and transformed in place by the radix-2 cFFT,
+ * so it only does powers of 2.
+ *
+ * By default cFFT halves every stage, which gives the 1/N scale. With
+ * BLOCK_FLOAT cFFTBlockFloat only halves the stages that could overflow,
+ * and the result is brought back to 1/N in one rounded shift instead of
+ * truncating a bit at every stage. With BFP_OUTPUT it is only shifted down
+ * as far as the magnitudes need to fit 16 bit words, and the shifts in all
+ * make the exponent.
+ */
+#include "fft_engine.h"
+
+#ifdef ENGINE_QFFT
+
+typedef struct qfft_plan {
+    uint16_t log2n;
+} qfft_plan;
+
+static size_t qfftPlanSize(uint16_t n)
+{
+    if (n < 2 || (n & (n-1)) != 0)
+        return 0;
+    return sizeof(qfft_plan);
+}
+
+/* n complex _q values */
+static size_t qfftWorkSize(uint16_t n)
+{
+    return 2*(size_t)n*sizeof(_q);
+}
+
+static void *qfftPlan(uint16_t n, void *memory)
+{
+    qfft_plan *plan = (qfft_plan *)memory;
+
+    plan->log2n = 0;
+    while ((1u << plan->log2n) < n)
+        plan->log2n++;
+    return plan;
+}
+
+#if defined(BFP_OUTPUT) || defined(BLOCK_FLOAT)
+/* Divide every value by 2^shift, rounding to nearest. */
+static void qfftShift(_q *input, uint16_t n, int16_t shift)
+{
+    uint16_t i;
+
+    if (shift <= 0)
+        return;
+    for (i = 0; i < 2*n; i++) {
+        input[i] = (input[i] + (1 << (shift-1))) >> shift;
+    }
+}
+#endif
+
+static int qfftExecute(void *plan, uint16_t n, void *work)
+{
+    _q *input = (_q *)work;
+    int16_t i;
+#ifdef BFP_OUTPUT
+    int16_t exponent, shift;
+    _q peak;
+#endif
+
+    /* Samples to complex values, last first so none is overwritten. */
+    for (i = n-1; i >= 0; i--) {
+        _q sample = ((int16_t*)work)[i];
+        input[IM(i)] = 0;
+        input[RE(i)] = sample;
+    }
+
+#ifdef BFP_OUTPUT
+    exponent = cFFTBlockFloat(input, n);
+
+    /* The magnitude of a pair below 2^15 fits an unsigned word. */
+    peak = 0;
+    for (i = 0; i < 2*n; i++) {
+        peak |= (input[i] < 0) ? -input[i] : input[i];
+    }
+    for (shift = 0; (peak >> shift) >= 0x8000; shift++)
+        ;
+    qfftShift(input, n, shift);
+    return exponent + shift;
+#elif defined(BLOCK_FLOAT)
+    qfftShift(input, n, ((qfft_plan *)plan)->log2n - cFFTBlockFloat(input, n));
+    return 0;
+#else
+    cFFT(input, n);
+    return 0;
+#endif
+}
+
+static void qfftMagnitude(void *plan, uint16_t n, void *work)
+{
+    _q *input = (_q *)work;
+    fft_magnitude *mag = (fft_magnitude *)work;
+    uint16_t i;
+
+    /* mag[i] lies below RE(i) and IM(i), which are read first */
+    for (i = 0; i < n/2; i++) {
+        mag[i] = _Qmag(input[RE(i)], input[IM(i)]);
+    }
+}
+
+const fft_engine fftEngineQfft = {
+    "cFFT", qfftPlanSize, qfftWorkSize, qfftPlan, qfftExecute, qfftMagnitude
+};
+
+#endif
@@ -0,0 +1,32 @@
+/*
+ * The engines built in, see fft_engine.h.
+ */
+#include "fft_engine.h"
+
+#ifdef ENGINE_KISS
+extern const fft_engine fftEngineKiss;
+#endif
+#ifdef ENGINE_QFFT
+extern const fft_engine fftEngineQfft;
+#endif
+#ifdef ENGINE_INPLACE
+extern const fft_engine fftEngineInplace;
+#endif
+
+const fft_engine * const fftEngines[FFT_ENGINE_COUNT] = {
+#ifdef ENGINE_KISS
+    &fftEngineKiss,
+#else
+    NULL,
+#endif
+#ifdef ENGINE_QFFT
+    &fftEngineQfft,
+#else
+    NULL,
+#endif
+#ifdef ENGINE_INPLACE
+    &fftEngineInplace,
+#else
+    NULL,
+#endif
+};
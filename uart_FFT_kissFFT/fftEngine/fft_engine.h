@@ -0,0 +1,170 @@
+/*
+ * FFT engines the firmware can run a frame through.
+ *
+ * uart_FFT_kissFFT.c receives the samples, times the work and sends the
+ * spectrum; an engine only plans, transforms and takes magnitudes, so every
+ * engine sees the same frames over the same protocol and clock setup and
+ * they can be compared one against the other. The host picks one with the
+ * 'E' command, FFT_ENGINE_DEFAULT runs after reset.
+ *
+ * A frame lives in one work buffer of at least the engine's workSize(n)
+ * bytes, word aligned; FFT_WORK_BYTES(n) covers every engine built in.
+ * The receive interrupt writes the n 16 bit samples to its start,
+ * execute() transforms them in whatever layout the engine likes, and
+ * magnitude() writes the n/2 magnitudes over the start of the buffer as
+ * fft_magnitude values on the usual |DFT|/N scale.
+ */
+#ifndef FFT_ENGINE_H
+#define FFT_ENGINE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Scalar type of the whole project, Q15, Q31 or float */
+#include "../kissFFT/kiss_fft_config.h"
+
+/*
+ * Engines built in. Without either of the first two both are; give one of
+ * them for the whole project (--define=ENGINE_QFFT) to build only that one
+ * and save the other's code and work buffer. ENGINE_INPLACE comes on top.
+ *   ENGINE_KISS     kissFFT real FFT, any even size, in the project's
+ *                   scalar type (kissFFT/), through static_fftr with
+ *                   STATIC_FFT
+ *   ENGINE_QFFT     IQmath radix-2 cFFT in Q12 (qFFT/), powers of 2 only
+ *   ENGINE_INPLACE  real FFT in Q15 in the samples' own memory, powers of
+ *                   2 up to 16384 (staticFFT/inplace_fft.hpp), needs the
+ *                   C++14 compiler
+ */
+//#define ENGINE_KISS
+//#define ENGINE_QFFT
+//#define ENGINE_INPLACE
+
+/*
+ * Large frames. LARGE_FRAMES, for the whole project, adds the sizes 2048
+ * to 16384 (0.5 Hz bins at 8192 Hz) and builds ENGINE_INPLACE, the only
+ * engine that fits them: 2 bytes a sample, twiddles in flash, no plan.
+ * uart_FFT_kissFFT.c then keeps the work buffer in .bss, 32k of SRAM_DATA,
+ * and the other engines only offer the sizes whose work buffer and plan
+ * still fit.
+ */
+//#define LARGE_FRAMES
+
+#if defined(LARGE_FRAMES) && !defined(ENGINE_INPLACE)
+#define ENGINE_INPLACE
+#endif
+
+#if !defined(ENGINE_KISS) && !defined(ENGINE_QFFT)
+#define ENGINE_KISS
+#define ENGINE_QFFT
+#endif
+
+/* Engine numbers of the 'E' command, fixed whatever is built in */
+#define FFT_ENGINE_KISS         0
+#define FFT_ENGINE_QFFT         1
+#define FFT_ENGINE_INPLACE      2
+#define FFT_ENGINE_COUNT        3
+
+#ifndef FFT_ENGINE_DEFAULT
+#ifdef ENGINE_KISS
+#define FFT_ENGINE_DEFAULT      FFT_ENGINE_KISS
+#else
+#define FFT_ENGINE_DEFAULT      FFT_ENGINE_QFFT
+#endif
+#endif
+
+/*
+ * Block floating point. When BFP_OUTPUT is defined the engines only scale
+ * the stages that could overflow, so small signals keep the low bits that
+ * scaling every stage divides away, and return the exponent of the
+ * spectrum. uart_FFT_kissFFT.c sends it with the magnitudes in 'B' frames.
+ */
+//#define BFP_OUTPUT
+
+/*
+ * BLOCK_FLOAT runs the cFFT engine through cFFTBlockFloat and rounds back
+ * to the 1/N scale once, instead of truncating a bit at every stage. Small
+ * signals keep more bits (fft_bench, N = 1024, input 6 bits down: 8.6 to
+ * 18.6 dB SNR), but tracking the peak costs about a third more time, so it
+ * is off unless asked for. BFP_OUTPUT implies it.
+ */
+//#define BLOCK_FLOAT
+
+/*
+ * Compile time plans. With STATIC_FFT the kissFFT engine runs the power of
+ * 2 sizes through static_fftr (staticFFT/), whose twiddles, input order and
+ * stage loops are all fixed when compiling; the other sizes still use
+ * kiss_fftr. Needs the C++14 compiler and about 20k of flash for the
+ * tables.
+ */
+//#define STATIC_FFT
+
+#if defined(STATIC_FFT) && defined(BFP_OUTPUT)
+#error "STATIC_FFT has no block floating point version"
+#endif
+
+#ifdef KISS_FFT_FLOAT
+typedef float fft_magnitude;
+#else
+typedef int16_t fft_magnitude;          // unsigned with BFP_OUTPUT
+#endif
+
+#define FFT_MAX(a, b)           ((a) > (b) ? (a) : (b))
+
+/* in[] then out[], as kiss_fftr takes them */
+#ifdef ENGINE_KISS
+#include "../kissFFT/kiss_fft.h"
+#define KISS_WORK_BYTES(n)      ((n)*sizeof(kiss_fft_scalar) + ((n)/2+1)*sizeof(kiss_fft_cpx))
+#else
+#define KISS_WORK_BYTES(n)      0
+#endif
+
+/* n complex _q values, for the largest power of 2 up to n */
+#ifdef ENGINE_QFFT
+#include "../qFFT/qfft.h"
+#define QFFT_SIZE_FLOOR(n)      ((n) >= 16384 ? 16384 : (n) >= 8192 ? 8192 : \
+                                 (n) >= 4096 ? 4096 : (n) >= 2048 ? 2048 : \
+                                 (n) >= 1024 ? 1024 : (n) >= 512 ? 512 : \
+                                 (n) >= 256 ? 256 : 128)
+#define QFFT_WORK_BYTES(n)      (2*QFFT_SIZE_FLOOR(n)*sizeof(_q))
+#else
+#define QFFT_WORK_BYTES(n)      0
+#endif
+
+/* The samples and nothing else */
+#ifdef ENGINE_INPLACE
+#include "../staticFFT/inplace_fftr.h"
+#define INPLACE_WORK_BYTES(n)   ((n)*sizeof(int16_t))
+#else
+#define INPLACE_WORK_BYTES(n)   0
+#endif
+
+#define FFT_WORK_BYTES(n)       FFT_MAX(FFT_MAX(KISS_WORK_BYTES(n), QFFT_WORK_BYTES(n)), \
+                                        INPLACE_WORK_BYTES(n))
+
+typedef struct fft_engine {
+    const char *name;
+
+    /* Bytes of plan memory size n needs, 0 if the engine cannot do n. */
+    size_t (*planSize)(uint16_t n);
+
+    /* Bytes of work buffer size n needs. */
+    size_t (*workSize)(uint16_t n);
+
+    /* Build the plan for n in memory, planSize(n) bytes, and return it. */
+    void *(*plan)(uint16_t n, void *memory);
+
+    /*
+     * Transform the n samples at the start of work. Returns the block
+     * floating point exponent with BFP_OUTPUT, where |DFT| = magnitude *
+     * 2^exponent, and 0 otherwise.
+     */
+    int (*execute)(void *plan, uint16_t n, void *work);
+
+    /* Magnitudes of bins 0 to n/2-1 over the start of work. */
+    void (*magnitude)(void *plan, uint16_t n, void *work);
+} fft_engine;
+
+/* Indexed by FFT_ENGINE_*, NULL for an engine not built in */
+extern const fft_engine * const fftEngines[FFT_ENGINE_COUNT];
+
+#endif
@@ -16,6 +16,9 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
    defines kiss_fft_scalar as either short or a float type
    and defines
    typedef struct { kiss_fft_scalar r; kiss_fft_scalar i; }kiss_fft_cpx; */
+#ifndef _KISS_FFT_GUTS_H
+#define _KISS_FFT_GUTS_H
+
 #include "kiss_fft.h"
 #include <limits.h>
 
@@ -25,10 +28,20 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
  4*4*4*2
  */
 
+/* Prime factors above this are not done with generic butterflies in floating
+ * point builds; the whole transform goes through Bluestein's algorithm instead. */
+#define KISS_FFT_MAX_GENERIC_RADIX 32
+
 struct kiss_fft_state{
     int nfft;
     int inverse;
     int factors[2*MAXFACTORS];
+    kiss_fft_cpx * scratch;     /* work space for generic butterflies and Bluestein */
+#ifndef FIXED_POINT
+    struct kiss_fft_state * bluestein;  /* power of 2 sub fft, NULL if unused */
+    kiss_fft_cpx * chirp;       /* exp(-i*pi*n^2/nfft), nfft entries */
+    kiss_fft_cpx * filter;      /* fft of the conjugate chirp, divided by its length */
+#endif
     kiss_fft_cpx twiddles[1];
 };
 
@@ -55,9 +68,25 @@ struct kiss_fft_state{
 #define SAMP_MIN -SAMP_MAX
 
 #if defined(CHECK_OVERFLOW)
+/* Count rather than print, so the check can stay on in the firmware: each
+   overflow goes to the counter of the radix and stage being recombined,
+   which KF_OVERFLOW_AT selects. See kiss_fft_overflows in kiss_fft.h. */
+extern uint32_t * kf_overflow_cell;
 #  define CHECK_OVERFLOW_OP(a,op,b)  \
 	if ( (SAMPPROD)(a) op (SAMPPROD)(b) > SAMP_MAX || (SAMPPROD)(a) op (SAMPPROD)(b) < SAMP_MIN ) { \
-		fprintf(stderr,"WARNING:overflow @ " __FILE__ "(%d): (%d " #op" %d) = %ld\n",__LINE__,(a),(b),(SAMPPROD)(a) op (SAMPPROD)(b) );  }
+		++*kf_overflow_cell; }
+#  define KF_RADIX_INDEX(p) ( (p) <= 5 ? (p) - 2 : KISS_OVERFLOW_GENERIC )
+#  define KF_OVERFLOW_AT(index,stage) \
+	( kf_overflow_cell = &kiss_fft_overflows.count[index] \
+	      [(stage) < KISS_OVERFLOW_STAGES ? (stage) : KISS_OVERFLOW_STAGES-1] )
+#endif
+
+#if defined(KISS_FFT_SATURATE)
+/* clamp sums to the scalar's range instead of letting them wrap */
+#  define kf_saturate(x) \
+	( (kiss_fft_scalar)( (x) > SAMP_MAX ? SAMP_MAX : (x) < SAMP_MIN ? SAMP_MIN : (x) ) )
+#  define S_ADD(a,b) kf_saturate( (SAMPPROD)(a) + (SAMPPROD)(b) )
+#  define S_SUB(a,b) kf_saturate( (SAMPPROD)(a) - (SAMPPROD)(b) )
 #endif
 
 
@@ -66,9 +95,21 @@ struct kiss_fft_state{
 
 #   define S_MUL(a,b) sround( smul(a,b) )
 
+#if (FIXED_POINT==32)
+/* Q31: both products are accumulated onto the rounding constant in 64 bits,
+   which the M4 does with one SMULL/SMLAL pair per output. b is the twiddle,
+   so negating it cannot overflow. */
+#   define C_MUL(m,a,b) \
+      do{ SAMPPROD acc_r_ = (SAMPPROD)1 << (FRACBITS-1), acc_i_ = acc_r_; \
+          acc_r_ += smul((a).r,(b).r); acc_r_ += smul((a).i,-(b).i); \
+          acc_i_ += smul((a).r,(b).i); acc_i_ += smul((a).i,(b).r); \
+          (m).r = (kiss_fft_scalar)( acc_r_ >> FRACBITS ); \
+          (m).i = (kiss_fft_scalar)( acc_i_ >> FRACBITS ); }while(0)
+#else
 #   define C_MUL(m,a,b) \
       do{ (m).r = sround( smul((a).r,(b).r) - smul((a).i,(b).i) ); \
           (m).i = sround( smul((a).r,(b).i) + smul((a).i,(b).r) ); }while(0)
+#endif
 
 #   define DIVSCALAR(x,k) \
 	(x) = sround( smul(  x, SAMP_MAX/k ) )
@@ -95,32 +136,38 @@ struct kiss_fft_state{
 
 #ifndef CHECK_OVERFLOW_OP
 #  define CHECK_OVERFLOW_OP(a,op,b) /* noop */
+#  define KF_OVERFLOW_AT(index,stage) /* noop */
+#endif
+
+#ifndef S_ADD
+#  define S_ADD(a,b) ( (a) + (b) )
+#  define S_SUB(a,b) ( (a) - (b) )
 #endif
 
 #define  C_ADD( res, a,b)\
     do { \
 	    CHECK_OVERFLOW_OP((a).r,+,(b).r)\
 	    CHECK_OVERFLOW_OP((a).i,+,(b).i)\
-	    (res).r=(a).r+(b).r;  (res).i=(a).i+(b).i; \
+	    (res).r=S_ADD((a).r,(b).r);  (res).i=S_ADD((a).i,(b).i); \
     }while(0)
 #define  C_SUB( res, a,b)\
     do { \
 	    CHECK_OVERFLOW_OP((a).r,-,(b).r)\
 	    CHECK_OVERFLOW_OP((a).i,-,(b).i)\
-	    (res).r=(a).r-(b).r;  (res).i=(a).i-(b).i; \
+	    (res).r=S_SUB((a).r,(b).r);  (res).i=S_SUB((a).i,(b).i); \
     }while(0)
 #define C_ADDTO( res , a)\
     do { \
 	    CHECK_OVERFLOW_OP((res).r,+,(a).r)\
 	    CHECK_OVERFLOW_OP((res).i,+,(a).i)\
-	    (res).r += (a).r;  (res).i += (a).i;\
+	    (res).r = S_ADD((res).r,(a).r);  (res).i = S_ADD((res).i,(a).i);\
     }while(0)
 
 #define C_SUBFROM( res , a)\
     do {\
 	    CHECK_OVERFLOW_OP((res).r,-,(a).r)\
 	    CHECK_OVERFLOW_OP((res).i,-,(a).i)\
-	    (res).r -= (a).r;  (res).i -= (a).i; \
+	    (res).r = S_SUB((res).r,(a).r);  (res).i = S_SUB((res).i,(a).i); \
     }while(0)
 
 
@@ -162,3 +209,5 @@ struct kiss_fft_state{
 #define  KISS_FFT_TMP_ALLOC(nbytes) KISS_FFT_MALLOC(nbytes)
 #define  KISS_FFT_TMP_FREE(ptr) KISS_FFT_FREE(ptr)
 #endif
+
+#endif
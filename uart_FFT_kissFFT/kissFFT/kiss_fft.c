@@ -18,11 +18,32 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
  fixed or floating point complex numbers.  It also delares the kf_ internal functions.
  */
 
-static void kf_bfly2(
+#if defined(FIXED_POINT) && defined(CHECK_OVERFLOW)
+kiss_fft_overflow_counts kiss_fft_overflows;
+uint32_t * kf_overflow_cell = &kiss_fft_overflows.count[0][0];
+
+uint32_t kiss_fft_overflow_total(void)
+{
+    uint32_t total = 0;
+    int r, s;
+    for (r = 0; r < KISS_OVERFLOW_RADIXES; ++r)
+        for (s = 0; s < KISS_OVERFLOW_STAGES; ++s)
+            total += kiss_fft_overflows.count[r][s];
+    return total;
+}
+
+void kiss_fft_overflow_reset(void)
+{
+    memset(&kiss_fft_overflows, 0, sizeof(kiss_fft_overflows));
+}
+#endif
+
+static KISS_FFT_RAMFUNC void kf_bfly2(
         kiss_fft_cpx * Fout,
         const size_t fstride,
         const kiss_fft_cfg st,
-        int m
+        int m,
+        int fixdiv
         )
 {
     kiss_fft_cpx * Fout2;
@@ -30,7 +51,9 @@ static void kf_bfly2(
     kiss_fft_cpx t;
     Fout2 = Fout + m;
     do{
-        C_FIXDIV(*Fout,2); C_FIXDIV(*Fout2,2);
+        if (fixdiv) {
+            C_FIXDIV(*Fout,2); C_FIXDIV(*Fout2,2);
+        }
 
         C_MUL (t,  *Fout2 , *tw1);
         tw1 += fstride;
@@ -41,11 +64,12 @@ static void kf_bfly2(
     }while (--m);
 }
 
-static void kf_bfly4(
+static KISS_FFT_RAMFUNC void kf_bfly4(
         kiss_fft_cpx * Fout,
         const size_t fstride,
         const kiss_fft_cfg st,
-        const size_t m
+        const size_t m,
+        int fixdiv
         )
 {
     kiss_fft_cpx *tw1,*tw2,*tw3;
@@ -58,7 +82,9 @@ static void kf_bfly4(
     tw3 = tw2 = tw1 = st->twiddles;
 
     do {
-        C_FIXDIV(*Fout,4); C_FIXDIV(Fout[m],4); C_FIXDIV(Fout[m2],4); C_FIXDIV(Fout[m3],4);
+        if (fixdiv) {
+            C_FIXDIV(*Fout,4); C_FIXDIV(Fout[m],4); C_FIXDIV(Fout[m2],4); C_FIXDIV(Fout[m3],4);
+        }
 
         C_MUL(scratch[0],Fout[m] , *tw1 );
         C_MUL(scratch[1],Fout[m2] , *tw2 );
@@ -89,11 +115,12 @@ static void kf_bfly4(
     }while(--k);
 }
 
-static void kf_bfly3(
+static KISS_FFT_RAMFUNC void kf_bfly3(
          kiss_fft_cpx * Fout,
          const size_t fstride,
          const kiss_fft_cfg st,
-         size_t m
+         size_t m,
+         int fixdiv
          )
 {
      size_t k=m;
@@ -106,7 +133,9 @@ static void kf_bfly3(
      tw1=tw2=st->twiddles;
 
      do{
-         C_FIXDIV(*Fout,3); C_FIXDIV(Fout[m],3); C_FIXDIV(Fout[m2],3);
+         if (fixdiv) {
+             C_FIXDIV(*Fout,3); C_FIXDIV(Fout[m],3); C_FIXDIV(Fout[m2],3);
+         }
 
          C_MUL(scratch[1],Fout[m] , *tw1);
          C_MUL(scratch[2],Fout[m2] , *tw2);
@@ -133,11 +162,12 @@ static void kf_bfly3(
      }while(--k);
 }
 
-static void kf_bfly5(
+static KISS_FFT_RAMFUNC void kf_bfly5(
         kiss_fft_cpx * Fout,
         const size_t fstride,
         const kiss_fft_cfg st,
-        int m
+        int m,
+        int fixdiv
         )
 {
     kiss_fft_cpx *Fout0,*Fout1,*Fout2,*Fout3,*Fout4;
@@ -157,7 +187,9 @@ static void kf_bfly5(
 
     tw=st->twiddles;
     for ( u=0; u<m; ++u ) {
-        C_FIXDIV( *Fout0,5); C_FIXDIV( *Fout1,5); C_FIXDIV( *Fout2,5); C_FIXDIV( *Fout3,5); C_FIXDIV( *Fout4,5);
+        if (fixdiv) {
+            C_FIXDIV( *Fout0,5); C_FIXDIV( *Fout1,5); C_FIXDIV( *Fout2,5); C_FIXDIV( *Fout3,5); C_FIXDIV( *Fout4,5);
+        }
         scratch[0] = *Fout0;
 
         C_MUL(scratch[1] ,*Fout1, tw[u*fstride]);
@@ -195,12 +227,13 @@ static void kf_bfly5(
 }
 
 /* perform the butterfly for one stage of a mixed radix FFT */
-static void kf_bfly_generic(
+static KISS_FFT_RAMFUNC void kf_bfly_generic(
         kiss_fft_cpx * Fout,
         const size_t fstride,
         const kiss_fft_cfg st,
         int m,
-        int p
+        int p,
+        int fixdiv
         )
 {
     int u,k,q1,q;
@@ -208,13 +241,16 @@ static void kf_bfly_generic(
     kiss_fft_cpx t;
     int Norig = st->nfft;
 
-    kiss_fft_cpx * scratch = (kiss_fft_cpx*)KISS_FFT_TMP_ALLOC(sizeof(kiss_fft_cpx)*p);
+    /* sized by kiss_fft_alloc for the largest radix, so nothing is allocated here */
+    kiss_fft_cpx * scratch = st->scratch;
 
     for ( u=0; u<m; ++u ) {
         k=u;
         for ( q1=0 ; q1<p ; ++q1 ) {
             scratch[q1] = Fout[ k  ];
-            C_FIXDIV(scratch[q1],p);
+            if (fixdiv) {
+                C_FIXDIV(scratch[q1],p);
+            }
             k += m;
         }
 
@@ -231,10 +267,75 @@ static void kf_bfly_generic(
             k += m;
         }
     }
-    KISS_FFT_TMP_FREE(scratch);
 }
 
-static
+#ifndef FIXED_POINT
+/*
+ * Bluestein's algorithm: the DFT of any length n written as a circular
+ * convolution of length nb (a power of 2 >= 2n-1) with a chirp, so the
+ * cost is three power of 2 ffts instead of O(p^2) generic butterflies.
+ * fin is read completely before fout is written, so fin may equal fout.
+ */
+static void kf_bluestein(
+        const kiss_fft_cfg st,
+        const kiss_fft_cpx * fin,
+        kiss_fft_cpx * fout,
+        int in_stride
+        )
+{
+    const int n = st->nfft;
+    const int nb = st->bluestein->nfft;
+    kiss_fft_cpx * a = st->scratch;
+    kiss_fft_cpx * fa = st->scratch + nb;
+    kiss_fft_cpx t;
+    int k;
+
+    /* chirp the input and zero pad it */
+    for (k=0;k<n;++k) {
+        C_MUL(a[k], fin[k*in_stride], st->chirp[k]);
+    }
+    memset(a+n,0,sizeof(kiss_fft_cpx)*(nb-n));
+
+    /* convolve with the conjugate chirp, the inverse fft done as a
+       conjugated forward fft (the filter already holds the 1/nb) */
+    kiss_fft(st->bluestein,a,fa);
+    for (k=0;k<nb;++k) {
+        C_MUL(t, fa[k], st->filter[k]);
+        a[k].r = t.r;
+        a[k].i = -t.i;
+    }
+    kiss_fft(st->bluestein,a,fa);
+
+    /* undo the conjugation and chirp the result */
+    for (k=0;k<n;++k) {
+        t.r = fa[k].r;
+        t.i = -fa[k].i;
+        C_MUL(fout[k], t, st->chirp[k]);
+    }
+}
+#endif
+
+/* recombine the p smaller DFTs of length m, dividing by p in fixed point
+   unless the caller has already made room (fixdiv == 0) */
+static KISS_FFT_RAMFUNC void kf_recombine(
+        kiss_fft_cpx * Fout,
+        const size_t fstride,
+        const kiss_fft_cfg st,
+        int m,
+        int p,
+        int fixdiv
+        )
+{
+    switch (p) {
+        case 2: kf_bfly2(Fout,fstride,st,m,fixdiv); break;
+        case 3: kf_bfly3(Fout,fstride,st,m,fixdiv); break;
+        case 4: kf_bfly4(Fout,fstride,st,m,fixdiv); break;
+        case 5: kf_bfly5(Fout,fstride,st,m,fixdiv); break;
+        default: kf_bfly_generic(Fout,fstride,st,m,p,fixdiv); break;
+    }
+}
+
+static KISS_FFT_RAMFUNC
 void kf_work(
         kiss_fft_cpx * Fout,
         const kiss_fft_cpx * f,
@@ -252,7 +353,8 @@ void kf_work(
 #ifdef _OPENMP
     // use openmp extensions at the 
     // top-level (not recursive)
-    if (fstride==1 && p<=5)
+    // generic butterflies share st->scratch, so only when there are none
+    if (fstride==1 && p<=5 && st->scratch==NULL)
     {
         int k;
 
@@ -262,13 +364,8 @@ void kf_work(
             kf_work( Fout +k*m, f+ fstride*in_stride*k,fstride*p,in_stride,factors,st);
         // all threads have joined by this point
 
-        switch (p) {
-            case 2: kf_bfly2(Fout,fstride,st,m); break;
-            case 3: kf_bfly3(Fout,fstride,st,m); break; 
-            case 4: kf_bfly4(Fout,fstride,st,m); break;
-            case 5: kf_bfly5(Fout,fstride,st,m); break; 
-            default: kf_bfly_generic(Fout,fstride,st,m,p); break;
-        }
+        KF_OVERFLOW_AT(KF_RADIX_INDEX(p), (int)(factors - st->factors)/2 - 1);
+        kf_recombine(Fout,fstride,st,m,p,1);
         return;
     }
 #endif
@@ -292,15 +389,116 @@ void kf_work(
     Fout=Fout_beg;
 
     // recombine the p smaller DFTs 
+    KF_OVERFLOW_AT(KF_RADIX_INDEX(p), (int)(factors - st->factors)/2 - 1);
+    kf_recombine(Fout,fstride,st,m,p,1);
+}
+
+#ifdef FIXED_POINT
+/*
+ * Block floating point.
+ *
+ * kf_work divides every butterfly by its radix, which keeps the output in
+ * range but throws away a bit or more per stage even when the signal is
+ * small. kf_work_bfp only scales a block when the next stage could actually
+ * overflow, and then by a power of 2, and returns the total number of bits
+ * shifted out. The result is the DFT divided by 2^exponent.
+ */
+
+/* shift n values right by s bits, rounding */
+static KISS_FFT_RAMFUNC void kf_shift(kiss_fft_cpx * Fout, int n, int s)
+{
+    const SAMPPROD half = (SAMPPROD)1 << (s-1);
+    int k;
+    for (k=0;k<n;++k) {
+        Fout[k].r = (kiss_fft_scalar)( ( (SAMPPROD)Fout[k].r + half ) >> s );
+        Fout[k].i = (kiss_fft_scalar)( ( (SAMPPROD)Fout[k].i + half ) >> s );
+    }
+}
+
+/* number of bits a radix p butterfly can grow its inputs by: each output
+   part is at most (1 + (p-1)*sqrt(2)) times the largest input part */
+static KISS_FFT_RAMFUNC int kf_growth_bits(int p)
+{
+    int bits = 0;
     switch (p) {
-        case 2: kf_bfly2(Fout,fstride,st,m); break;
-        case 3: kf_bfly3(Fout,fstride,st,m); break; 
-        case 4: kf_bfly4(Fout,fstride,st,m); break;
-        case 5: kf_bfly5(Fout,fstride,st,m); break; 
-        default: kf_bfly_generic(Fout,fstride,st,m,p); break;
+        case 2: case 3: return 2;
+        case 4: case 5: return 3;
+    }
+    while ( ((SAMPPROD)1000 << bits) < 1000 + (SAMPPROD)(p-1)*1415 )
+        ++bits;
+    return bits;
+}
+
+/* right shift needed before a radix p stage over n values so it cannot overflow */
+static KISS_FFT_RAMFUNC int kf_headroom(const kiss_fft_cpx * Fout, int n, int p)
+{
+    SAMPPROD peak = 0;
+    int k, bits = 0;
+
+    /* or-ing the magnitudes gives the bit length of the largest */
+    for (k=0;k<n;++k) {
+        SAMPPROD r = Fout[k].r, i = Fout[k].i;
+        peak |= (r < 0 ? -r : r) | (i < 0 ? -i : i);
     }
+    while (peak >> bits)
+        ++bits;
+
+    bits += kf_growth_bits(p) - FRACBITS;
+    return bits > 0 ? bits : 0;
 }
 
+static KISS_FFT_RAMFUNC
+int kf_work_bfp(
+        kiss_fft_cpx * Fout,
+        const kiss_fft_cpx * f,
+        const size_t fstride,
+        int in_stride,
+        int * factors,
+        const kiss_fft_cfg st
+        )
+{
+    kiss_fft_cpx * Fout_beg=Fout;
+    const int p=*factors++; /* the radix  */
+    const int m=*factors++; /* stage's fft length/p */
+    const kiss_fft_cpx * Fout_end = Fout + p*m;
+    int exponent = 0;
+    int shift;
+
+    if (m==1) {
+        do{
+            *Fout = *f;
+            f += fstride*in_stride;
+        }while(++Fout != Fout_end );
+    }else{
+        int k;
+        for (k=0;k<p;++k) {
+            int e = kf_work_bfp( Fout_beg + k*m, f, fstride*p, in_stride, factors,st);
+
+            // bring the smaller DFTs to a common exponent
+            if (k==0) {
+                exponent = e;
+            }else if (e > exponent) {
+                kf_shift(Fout_beg, k*m, e - exponent);
+                exponent = e;
+            }else if (e < exponent) {
+                kf_shift(Fout_beg + k*m, m, exponent - e);
+            }
+            f += fstride*in_stride;
+        }
+    }
+
+    shift = kf_headroom(Fout_beg, p*m, p);
+    if (shift) {
+        kf_shift(Fout_beg, p*m, shift);
+        exponent += shift;
+    }
+
+    KF_OVERFLOW_AT(KF_RADIX_INDEX(p), (int)(factors - st->factors)/2 - 1);
+    kf_recombine(Fout_beg,fstride,st,m,p,0);
+    return exponent;
+}
+#endif
+
 /*  facbuf is populated by p1,m1,p2,m2, ...
     where 
     p[i] * m[i] = m[i-1]
@@ -335,12 +533,46 @@ void kf_factor(int n,int * facbuf)
  *
  * The return value is a contiguous block of memory, allocated with malloc.  As such,
  * It can be freed with free(), rather than a kiss_fft-specific function.
+ *
+ * Work space for generic butterflies (and in floating point builds the
+ * Bluestein chirp, filter and sub fft) is part of the same block, so running
+ * the fft never allocates.
  * */
 kiss_fft_cfg kiss_fft_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem )
 {
     kiss_fft_cfg st=NULL;
+    int factors[2*MAXFACTORS];
+    int i, maxradix=0;
+    size_t nscratch=0;
     size_t memneeded = sizeof(struct kiss_fft_state)
         + sizeof(kiss_fft_cpx)*(nfft-1); /* twiddle factors*/
+    const size_t statesize = memneeded;
+#ifndef FIXED_POINT
+    int nbluestein=0;
+    size_t subsize=0;
+#endif
+
+    kf_factor(nfft,factors);
+    for (i=0;;i+=2) {
+        if (factors[i] > maxradix)
+            maxradix = factors[i];
+        if (factors[i+1] == 1)
+            break;
+    }
+    if (maxradix > 5 || nfft == 1)
+        nscratch = maxradix; /* kf_bfly_generic, which also does nfft==1 */
+
+#ifndef FIXED_POINT
+    if (maxradix > KISS_FFT_MAX_GENERIC_RADIX) {
+        nbluestein = 2;
+        while (nbluestein < 2*nfft-1)
+            nbluestein <<= 1;
+        kiss_fft_alloc(nbluestein,0,NULL,&subsize);
+        nscratch = 2*nbluestein;
+        memneeded += subsize + sizeof(kiss_fft_cpx)*(nfft + nbluestein); /* chirp, filter */
+    }
+#endif
+    memneeded += sizeof(kiss_fft_cpx)*nscratch;
 
     if ( lenmem==NULL ) {
         st = ( kiss_fft_cfg)KISS_FFT_MALLOC( memneeded );
@@ -350,26 +582,75 @@ kiss_fft_cfg kiss_fft_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem
         *lenmem = memneeded;
     }
     if (st) {
-        int i;
+        const double pi=3.141592653589793238462643383279502884197169399375105820974944;
+        char * tail = (char*)st + statesize;
+
         st->nfft=nfft;
         st->inverse = inverse_fft;
 
         for (i=0;i<nfft;++i) {
-            const double pi=3.141592653589793238462643383279502884197169399375105820974944;
             double phase = -2*pi*i / nfft;
             if (st->inverse)
                 phase *= -1;
             kf_cexp(st->twiddles+i, phase );
         }
 
-        kf_factor(nfft,st->factors);
+        memcpy(st->factors,factors,sizeof(factors));
+
+#ifndef FIXED_POINT
+        /* the sub fft goes first, it needs the alignment of the state */
+        st->bluestein = NULL;
+        if (nbluestein) {
+            st->bluestein = kiss_fft_alloc(nbluestein,0,tail,&subsize);
+            tail += subsize;
+        }
+#endif
+        st->scratch = nscratch ? (kiss_fft_cpx*)tail : NULL;
+        tail += sizeof(kiss_fft_cpx)*nscratch;
+
+#ifndef FIXED_POINT
+        if (nbluestein) {
+            st->chirp = (kiss_fft_cpx*)tail;
+            st->filter = st->chirp + nfft;
+
+            /* n^2 is reduced mod 2n to keep the phase accurate for large n */
+            for (i=0;i<nfft;++i) {
+                double phase = -pi * fmod((double)i*i, 2.0*nfft) / nfft;
+                if (st->inverse)
+                    phase *= -1;
+                kf_cexp(st->chirp+i, phase );
+            }
+
+            /* conjugate chirp, wrapped around to the negative indices */
+            memset(st->scratch,0,sizeof(kiss_fft_cpx)*nbluestein);
+            for (i=0;i<nfft;++i) {
+                st->scratch[i].r = st->chirp[i].r;
+                st->scratch[i].i = -st->chirp[i].i;
+                if (i)
+                    st->scratch[nbluestein-i] = st->scratch[i];
+            }
+            kiss_fft(st->bluestein,st->scratch,st->filter);
+            for (i=0;i<nbluestein;++i) {
+                st->filter[i].r /= nbluestein;
+                st->filter[i].i /= nbluestein;
+            }
+        }else{
+            st->chirp = st->filter = NULL;
+        }
+#endif
     }
     return st;
 }
 
 
-void kiss_fft_stride(kiss_fft_cfg st,const kiss_fft_cpx *fin,kiss_fft_cpx *fout,int in_stride)
+KISS_FFT_RAMFUNC void kiss_fft_stride(kiss_fft_cfg st,const kiss_fft_cpx *fin,kiss_fft_cpx *fout,int in_stride)
 {
+#ifndef FIXED_POINT
+    if (st->bluestein) {
+        kf_bluestein(st,fin,fout,in_stride);
+        return;
+    }
+#endif
     if (fin == fout) {
         //NOTE: this is not really an in-place FFT algorithm.
         //It just performs an out-of-place FFT into a temp buffer
@@ -387,6 +668,23 @@ void kiss_fft(kiss_fft_cfg cfg,const kiss_fft_cpx *fin,kiss_fft_cpx *fout)
     kiss_fft_stride(cfg,fin,fout,1);
 }
 
+#ifdef FIXED_POINT
+KISS_FFT_RAMFUNC int kiss_fft_bfp(kiss_fft_cfg st,const kiss_fft_cpx *fin,kiss_fft_cpx *fout)
+{
+    int exponent;
+
+    if (fin == fout) {
+        kiss_fft_cpx * tmpbuf = (kiss_fft_cpx*)KISS_FFT_TMP_ALLOC( sizeof(kiss_fft_cpx)*st->nfft);
+        exponent = kf_work_bfp(tmpbuf,fin,1,1,st->factors,st);
+        memcpy(fout,tmpbuf,sizeof(kiss_fft_cpx)*st->nfft);
+        KISS_FFT_TMP_FREE(tmpbuf);
+    }else{
+        exponent = kf_work_bfp(fout,fin,1,1,st->factors,st);
+    }
+    return exponent;
+}
+#endif
+
 
 void kiss_fft_cleanup(void)
 {
@@ -1,7 +1,7 @@
 #ifndef KISS_FFT_H
 #define KISS_FFT_H
 
-#define FIXED_POINT 16
+#include "kiss_fft_config.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -91,6 +91,12 @@ kiss_fft_cfg kiss_fft_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem)
  * fout will be   F[0] , F[1] , ... ,F[nfft-1]
  * Note that each element is complex and can be accessed like
     f[k].r and f[k].i
+ *
+ * Any nfft is supported. Radices 2,3,4,5 have dedicated butterflies, other
+ * prime factors use generic butterflies, and in floating point builds sizes
+ * with a prime factor above 32 go through Bluestein's algorithm so they stay
+ * O(n log n). The work space for both is inside cfg, so one cfg must not be
+ * used by two threads at the same time.
  * */
 void kiss_fft(kiss_fft_cfg cfg,const kiss_fft_cpx *fin,kiss_fft_cpx *fout);
 
@@ -99,6 +105,46 @@ void kiss_fft(kiss_fft_cfg cfg,const kiss_fft_cpx *fin,kiss_fft_cpx *fout);
  * */
 void kiss_fft_stride(kiss_fft_cfg cfg,const kiss_fft_cpx *fin,kiss_fft_cpx *fout,int fin_stride);
 
+#ifdef FIXED_POINT
+/*
+ * kiss_fft_bfp(cfg,fin,fout)
+ *
+ * Block floating point version of kiss_fft for fixed point builds. Instead of
+ * dividing every stage by its radix, a stage is only scaled (by a power of 2)
+ * when it could overflow, so small signals keep their low bits.
+ * Returns the exponent e: fout holds the DFT divided by 2^e, where kiss_fft
+ * always divides by nfft.
+ * */
+int kiss_fft_bfp(kiss_fft_cfg cfg,const kiss_fft_cpx *fin,kiss_fft_cpx *fout);
+#endif
+
+#if defined(FIXED_POINT) && defined(CHECK_OVERFLOW)
+#include <stdint.h>
+/*
+ * Overflow counters, when built with CHECK_OVERFLOW (kiss_fft_config.h).
+ * Every checked addition or subtraction whose result leaves the scalar's
+ * range adds one to count[radix][stage]: radix 0 to 3 are the radix 2 to 5
+ * butterflies, KISS_OVERFLOW_GENERIC the others and KISS_OVERFLOW_REAL the
+ * split at the end of kiss_fftr. stage is the butterfly's position in the
+ * plan's factors, 0 being the last stage run; stages from
+ * KISS_OVERFLOW_STAGES-1 on share the last counter. The counts run from
+ * start up, or the last kiss_fft_overflow_reset, and are not thread safe.
+ */
+#define KISS_OVERFLOW_GENERIC   4
+#define KISS_OVERFLOW_REAL      5
+#define KISS_OVERFLOW_RADIXES   6
+#define KISS_OVERFLOW_STAGES    8
+
+typedef struct {
+    uint32_t count[KISS_OVERFLOW_RADIXES][KISS_OVERFLOW_STAGES];
+} kiss_fft_overflow_counts;
+
+extern kiss_fft_overflow_counts kiss_fft_overflows;
+
+uint32_t kiss_fft_overflow_total(void);
+void kiss_fft_overflow_reset(void);
+#endif
+
 /* If kiss_fft_alloc allocated a buffer, it is one contiguous 
    buffer and can be simply free()d when no longer needed*/
 #define kiss_fft_free free
@@ -0,0 +1,52 @@
+#ifndef KISS_FFT_CONFIG_H
+#define KISS_FFT_CONFIG_H
+
+/*
+ * Scalar type used by every file built against kissFFT. The firmware
+ * defaults to FIXED_POINT 16 (Q15); FIXED_POINT 32 gives Q31, and
+ * KISS_FFT_FLOAT single precision float, which the MSP432's FPU runs in
+ * hardware. Either can also be given on the compiler command line, which
+ * is how the host tools build each variant.
+ */
+//#define FIXED_POINT 32
+//#define KISS_FFT_FLOAT
+
+#if !defined(FIXED_POINT) && !defined(KISS_FFT_FLOAT)
+#define FIXED_POINT 16
+#endif
+
+#if defined(FIXED_POINT) && defined(KISS_FFT_FLOAT)
+#error "Select either FIXED_POINT or KISS_FFT_FLOAT"
+#endif
+
+/*
+ * Fixed point overflow checks. CHECK_OVERFLOW counts the butterfly and
+ * real split additions whose result leaves the scalar's range, per radix
+ * and stage (kiss_fft_overflows in kiss_fft.h); the firmware reports the
+ * counts in its telemetry. KISS_FFT_SATURATE clamps those results to the
+ * range instead of letting them wrap around. Each costs a compare or two
+ * per addition.
+ */
+//#define CHECK_OVERFLOW
+//#define KISS_FFT_SATURATE
+
+#if (defined(CHECK_OVERFLOW) || defined(KISS_FFT_SATURATE)) && !defined(FIXED_POINT)
+#error "CHECK_OVERFLOW and KISS_FFT_SATURATE are for the fixed point builds"
+#endif
+
+/*
+ * RAMFUNC_KERNELS runs the butterflies, kf_work and the real split from
+ * SRAM, out of reach of the flash wait states at 48 MHz. The TI compiler
+ * puts functions marked KISS_FFT_RAMFUNC in .TI.ramfunc, msp432p401r.cmd
+ * links that to run from SRAM_CODE and the reset handler copies it there,
+ * so define it for the whole project, compiler and linker
+ * (--define=RAMFUNC_KERNELS for both), not here. Other compilers, as for
+ * the host tools, ignore it.
+ */
+#if defined(RAMFUNC_KERNELS) && defined(__TI_COMPILER_VERSION__)
+#define KISS_FFT_RAMFUNC __attribute__((ramfunc))
+#else
+#define KISS_FFT_RAMFUNC
+#endif
+
+#endif
@@ -64,22 +64,15 @@ kiss_fftr_cfg kiss_fftr_alloc(int nfft,int inverse_fft,void * mem,size_t * lenme
     return st;
 }
 
-void kiss_fftr(kiss_fftr_cfg st,const kiss_fft_scalar *timedata,kiss_fft_cpx *freqdata)
+/* split the packed complex fft in tmpbuf into the spectrum of the real input */
+static KISS_FFT_RAMFUNC void kf_fftr_split(kiss_fftr_cfg st,const kiss_fft_cpx *tmpbuf,kiss_fft_cpx *freqdata)
 {
-    /* input buffer timedata is stored row-wise */
     int k,ncfft;
     kiss_fft_cpx fpnk,fpk,f1k,f2k,tw,tdc;
 
-    if ( st->substate->inverse) {
-        fprintf(stderr,"kiss fft usage error: improper alloc\n");
-        exit(1);
-    }
-
     ncfft = st->substate->nfft;
 
-    /*perform the parallel fft of two real signals packed in real,imag*/
-    kiss_fft( st->substate , (const kiss_fft_cpx*)timedata, st->tmpbuf );
-    /* The real part of the DC element of the frequency spectrum in st->tmpbuf
+    /* The real part of the DC element of the frequency spectrum in tmpbuf
      * contains the sum of the even-numbered elements of the input time sequence
      * The imag part is the sum of the odd-numbered elements
      *
@@ -89,13 +82,14 @@ void kiss_fftr(kiss_fftr_cfg st,const kiss_fft_scalar *timedata,kiss_fft_cpx *fr
      *      yielding Nyquist bin of input time sequence
      */
  
-    tdc.r = st->tmpbuf[0].r;
-    tdc.i = st->tmpbuf[0].i;
+    tdc.r = tmpbuf[0].r;
+    tdc.i = tmpbuf[0].i;
     C_FIXDIV(tdc,2);
+    KF_OVERFLOW_AT(KISS_OVERFLOW_REAL, 0);
     CHECK_OVERFLOW_OP(tdc.r ,+, tdc.i);
     CHECK_OVERFLOW_OP(tdc.r ,-, tdc.i);
-    freqdata[0].r = tdc.r + tdc.i;
-    freqdata[ncfft].r = tdc.r - tdc.i;
+    freqdata[0].r = S_ADD(tdc.r, tdc.i);
+    freqdata[ncfft].r = S_SUB(tdc.r, tdc.i);
 #ifdef USE_SIMD    
     freqdata[ncfft].i = freqdata[0].i = _mm_set1_ps(0);
 #else
@@ -103,9 +97,9 @@ void kiss_fftr(kiss_fftr_cfg st,const kiss_fft_scalar *timedata,kiss_fft_cpx *fr
 #endif
 
     for ( k=1;k <= ncfft/2 ; ++k ) {
-        fpk    = st->tmpbuf[k]; 
-        fpnk.r =   st->tmpbuf[ncfft-k].r;
-        fpnk.i = - st->tmpbuf[ncfft-k].i;
+        fpk    = tmpbuf[k]; 
+        fpnk.r =   tmpbuf[ncfft-k].r;
+        fpnk.i = - tmpbuf[ncfft-k].i;
         C_FIXDIV(fpk,2);
         C_FIXDIV(fpnk,2);
 
@@ -120,6 +114,47 @@ void kiss_fftr(kiss_fftr_cfg st,const kiss_fft_scalar *timedata,kiss_fft_cpx *fr
     }
 }
 
+void kiss_fftr(kiss_fftr_cfg st,const kiss_fft_scalar *timedata,kiss_fft_cpx *freqdata)
+{
+    kiss_fftr_work(st,timedata,freqdata,st->tmpbuf);
+}
+
+KISS_FFT_RAMFUNC void kiss_fftr_work(kiss_fftr_cfg st,const kiss_fft_scalar *timedata,kiss_fft_cpx *freqdata,kiss_fft_cpx *tmpbuf)
+{
+    /* input buffer timedata is stored row-wise */
+    if ( st->substate->inverse) {
+        fprintf(stderr,"kiss fft usage error: improper alloc\n");
+        exit(1);
+    }
+
+    /*perform the parallel fft of two real signals packed in real,imag*/
+    kiss_fft( st->substate , (const kiss_fft_cpx*)timedata, tmpbuf );
+    kf_fftr_split(st,tmpbuf,freqdata);
+}
+
+int kiss_fftr_shareable(kiss_fftr_cfg st)
+{
+    /* the generic butterflies and Bluestein work in substate->scratch */
+    return st->substate->scratch == NULL;
+}
+
+#ifdef FIXED_POINT
+KISS_FFT_RAMFUNC int kiss_fftr_bfp(kiss_fftr_cfg st,const kiss_fft_scalar *timedata,kiss_fft_cpx *freqdata)
+{
+    int exponent;
+
+    if ( st->substate->inverse) {
+        fprintf(stderr,"kiss fft usage error: improper alloc\n");
+        exit(1);
+    }
+
+    exponent = kiss_fft_bfp( st->substate , (const kiss_fft_cpx*)timedata, st->tmpbuf );
+    /* the split halves once more to stay in range */
+    kf_fftr_split(st,st->tmpbuf,freqdata);
+    return exponent + 1;
+}
+#endif
+
 void kiss_fftri(kiss_fftr_cfg st,const kiss_fft_cpx *freqdata,kiss_fft_scalar *timedata)
 {
     /* input buffer timedata is stored row-wise */
@@ -1,8 +1,6 @@
 #ifndef KISS_FTR_H
 #define KISS_FTR_H
 
-#define FIXED_POINT 16
-
 #include "kiss_fft.h"
 #ifdef __cplusplus
 extern "C" {
@@ -34,6 +32,27 @@ void kiss_fftr(kiss_fftr_cfg cfg,const kiss_fft_scalar *timedata,kiss_fft_cpx *f
  output freqdata has nfft/2+1 complex points
 */
 
+void kiss_fftr_work(kiss_fftr_cfg cfg,const kiss_fft_scalar *timedata,kiss_fft_cpx *freqdata,kiss_fft_cpx *tmpbuf);
+/*
+ same as kiss_fftr, with a caller supplied tmpbuf of nfft/2 complex points
+ instead of the one inside cfg. Threads that each pass their own tmpbuf can
+ share one cfg if kiss_fftr_shareable(cfg) is true.
+*/
+
+int kiss_fftr_shareable(kiss_fftr_cfg cfg);
+/*
+ nonzero if kiss_fftr_work touches nothing writable in cfg, which holds
+ when nfft/2 has no prime factor above 5
+*/
+
+#ifdef FIXED_POINT
+int kiss_fftr_bfp(kiss_fftr_cfg cfg,const kiss_fft_scalar *timedata,kiss_fft_cpx *freqdata);
+/*
+ block floating point version of kiss_fftr, see kiss_fft_bfp
+ returns the exponent e: freqdata holds the DFT divided by 2^e
+*/
+#endif
+
 void kiss_fftri(kiss_fftr_cfg cfg,const kiss_fft_cpx *freqdata,kiss_fft_scalar *timedata);
 /*
  input freqdata has  nfft/2+1 complex points
@@ -42,7 +42,15 @@ MEMORY
 {
     MAIN       (RX) : origin = 0x00000000, length = 0x00040000
     INFO       (RX) : origin = 0x00200000, length = 0x00004000
-#ifdef  __TI_COMPILER_VERSION__
+#ifdef  RAMFUNC_KERNELS
+    /* SRAM_CODE and SRAM_DATA are the same 64KB of SRAM at two addresses.  */
+    /* With the FFT kernels run from SRAM (--define=RAMFUNC_KERNELS, see     */
+    /* kissFFT/kiss_fft_config.h) the bottom 8KB are kept for their code and */
+    /* the rest for data and the stack, so neither can be placed over the   */
+    /* other.                                                                */
+    SRAM_CODE  (RWX): origin = 0x01000000, length = 0x00002000
+    SRAM_DATA  (RW) : origin = 0x20002000, length = 0x0000E000
+#elif   defined(__TI_COMPILER_VERSION__)
 #if     __TI_COMPILER_VERSION__ >= 15009000
     ALIAS
     {
@@ -94,13 +102,36 @@ SECTIONS
     /* BSL area for device bootstrap loader                                  */
     .bslArea      : > 0x00202000
 
+#ifdef  RAMFUNC_KERNELS
+    .vtable :   > 0x20002000
+#else
     .vtable :   > 0x20000000
-    .data   :   > SRAM_DATA
-    .bss    :   > SRAM_DATA
-    .sysmem :   > SRAM_DATA
+#endif
+
+    /* Grouped so __SRAM_DATA_END marks where the free SRAM starts; the      */
+    /* reset handler paints from there up to the stack for its high water    */
+    /* mark (see ccs/startup_msp432p401r_ccs.c).                             */
+    GROUP : > SRAM_DATA, RUN_END(__SRAM_DATA_END)
+    {
+        .data
+        .bss
+        .sysmem
+    }
     .stack  :   > SRAM_DATA (HIGH)
 
-#ifdef  __TI_COMPILER_VERSION__
+#ifdef  RAMFUNC_KERNELS
+    /* The FFT kernels of both engines, with the magnitude and the Q12 sine, */
+    /* cosine and multiply cFFT calls, copied to SRAM_CODE by the reset      */
+    /* handler before anything runs (ccs/startup_msp432p401r_ccs.c).         */
+    .TI.ramfunc :
+    {
+        *(.TI.ramfunc)
+        QmathLib_CCS_MSP432.lib<_QNsqrt.obj>(.text:_Qmag)
+        QmathLib_CCS_MSP432.lib<_QNsin_cos.obj>(.text)
+        QmathLib_CCS_MSP432.lib<_QNmpy.obj>(.text)
+    } load=MAIN, run=SRAM_CODE, table(ramfuncCopyTable)
+    .ovly   :   > MAIN
+#elif   defined(__TI_COMPILER_VERSION__)
 #if     __TI_COMPILER_VERSION__ >= 15009000
     .TI.ramfunc : {} load=MAIN, run=SRAM_CODE, table(BINIT)
 #endif
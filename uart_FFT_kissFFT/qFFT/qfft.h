@@ -0,0 +1,36 @@
+/*
+ * Radix-2 complex FFT on IQmath _q values.
+ *
+ * Complex arrays hold n real/imaginary pairs; use RE() and IM() to index
+ * them. cFFT scales every stage by 1/2, cFFTBlockFloat only scales the
+ * stages that could overflow and returns how many it scaled.
+ */
+#ifndef QFFT_H
+#define QFFT_H
+
+#include <stdint.h>
+
+ /* Select the global Q value */
+ #define GLOBAL_Q    12
+
+ /* Include the iqmathlib header files */
+ #include <ti/iqmathlib/QmathLib.h>
+
+ /* Access the real and imaginary parts of an index into a complex array. */
+ #define RE(x)           (((x)<<1)+0)    // access real part of index
+ #define IM(x)           (((x)<<1)+1)    // access imaginary part of index
+
+/*
+ * With RAMFUNC_KERNELS defined for the project, compiler and linker, the
+ * FFT runs from SRAM_CODE instead of flash (see msp432p401r.cmd).
+ */
+#if defined(RAMFUNC_KERNELS) && defined(__TI_COMPILER_VERSION__)
+#define QFFT_RAMFUNC __attribute__((ramfunc))
+#else
+#define QFFT_RAMFUNC
+#endif
+
+void cFFT(_q *input, int16_t n);
+int16_t cFFTBlockFloat(_q *input, int16_t n);
+
+#endif
@@ -0,0 +1,240 @@
+/*
+ * Fixed point numbers whose format is part of the type.
+ *
+ * fixed<IntBits, FracBits, Storage> holds a value as Storage raw / 2^FracBits.
+ * IntBits counts the sign, so the two fill Storage: q15 is fixed<1, 15,
+ * int16_t>, the IQmath _q values of GLOBAL_Q 12 are fixed<20, 12, int32_t>.
+ * The layout is that of Storage alone, so arrays of kiss_fft_scalar or _q
+ * can be read as arrays of the matching fixed type.
+ *
+ * Nothing converts implicitly between formats:
+ *  - + and - only take two values of the same format and keep it, wrapping
+ *    around like the integer arithmetic kissFFT does
+ *  - * widens: the product of fixed<I1, F1> and fixed<I2, F2> has F1 + F2
+ *    fraction bits in 32 or 64 bits, so nothing is lost; sum<A> is the
+ *    format a sum has to be taken in when it must not wrap
+ *  - fixed_cast<To, Rounding, Overflow> is the only way to drop fraction
+ *    bits or integer bits; Rounding is Truncate (an arithmetic shift, the
+ *    default) or RoundNearest, Overflow is Wrap (the default) or Saturate
+ *  - rescale<To> keeps the raw value and only changes what it means, for
+ *    data that is read in one format and computed in another
+ *
+ * Everything is constexpr and compiles to the shifts and adds the raw
+ * integer code would have, so tables can be built when compiling and the
+ * formats cost nothing at run time. Needs C++14.
+ */
+#ifndef FIXED_HPP
+#define FIXED_HPP
+
+#include <stdint.h>
+#include <type_traits>
+
+namespace static_fft {
+
+/* Overflow policies of fixed_cast */
+struct Wrap {};                         // keep the low bits, as C casts do
+struct Saturate {};                     // clamp to the range of the format
+
+/* Rounding policies of fixed_cast, when fraction bits are dropped */
+struct Truncate {};                     // towards minus infinity
+struct RoundNearest {};                 // to nearest, halves up
+
+namespace detail {
+
+/* Signed storage for a widened value of Bits bits */
+template <int Bits>
+struct WideStorage {
+    static_assert(Bits <= 64, "no storage wider than 64 bits");
+    typedef typename std::conditional<(Bits <= 32), int32_t, int64_t>::type type;
+};
+
+} // namespace detail
+
+template <int IntBits, int FracBits, typename Storage>
+class fixed {
+    static_assert(std::is_integral<Storage>::value && std::is_signed<Storage>::value,
+                  "fixed needs signed integer storage");
+    static_assert(IntBits >= 1 && FracBits >= 0 &&
+                  IntBits + FracBits == 8 * (int)sizeof(Storage),
+                  "IntBits, which counts the sign, and FracBits must fill Storage");
+
+public:
+    typedef Storage storage_type;
+    static constexpr int int_bits = IntBits;
+    static constexpr int frac_bits = FracBits;
+    static constexpr Storage raw_max = (Storage)~((uint64_t)-1 << (IntBits + FracBits - 1));
+    static constexpr Storage raw_min = (Storage)(-raw_max - 1);
+
+    Storage raw;
+
+    fixed() = default;
+
+    static constexpr fixed from_raw(Storage r)
+    {
+        fixed f{};
+        f.raw = r;
+        return f;
+    }
+
+    /* Nearest value to v, clamped to the range */
+    static constexpr fixed from_double(double v)
+    {
+        double scaled = v * (double)((int64_t)1 << FracBits) + 0.5;
+        int64_t r = (int64_t)scaled;
+        if (r > scaled)
+            r--;
+        return from_raw(r > raw_max ? raw_max : r < raw_min ? raw_min : (Storage)r);
+    }
+
+    constexpr double to_double() const
+    {
+        return (double)raw / (double)((int64_t)1 << FracBits);
+    }
+
+    constexpr fixed operator-() const { return from_raw((Storage)-raw); }
+
+    /* Division by 2^n, rounding towards minus infinity */
+    constexpr fixed operator>>(int n) const { return from_raw((Storage)(raw >> n)); }
+
+    friend constexpr fixed operator+(fixed a, fixed b)
+    {
+        return from_raw((Storage)(a.raw + b.raw));
+    }
+
+    friend constexpr fixed operator-(fixed a, fixed b)
+    {
+        return from_raw((Storage)(a.raw - b.raw));
+    }
+
+    friend constexpr bool operator==(fixed a, fixed b) { return a.raw == b.raw; }
+    friend constexpr bool operator!=(fixed a, fixed b) { return a.raw != b.raw; }
+    friend constexpr bool operator<(fixed a, fixed b) { return a.raw < b.raw; }
+};
+
+template <int I, int F, typename S>
+constexpr S fixed<I, F, S>::raw_max;
+
+template <int I, int F, typename S>
+constexpr S fixed<I, F, S>::raw_min;
+
+/* A format with one more integer bit, exact for the sum or difference of
+   two values of A */
+template <typename A>
+struct sum {
+    typedef typename detail::WideStorage<A::int_bits + A::frac_bits + 1>::type storage;
+    typedef fixed<8 * (int)sizeof(storage) - A::frac_bits, A::frac_bits, storage> type;
+};
+
+/* The exact product of two formats */
+template <typename A, typename B>
+struct product {
+    static constexpr int frac = A::frac_bits + B::frac_bits;
+    typedef typename detail::WideStorage<A::int_bits + B::int_bits + frac>::type storage;
+    typedef fixed<8 * (int)sizeof(storage) - frac, frac, storage> type;
+};
+
+template <int I1, int F1, typename S1, int I2, int F2, typename S2>
+constexpr typename product<fixed<I1, F1, S1>, fixed<I2, F2, S2> >::type
+operator*(fixed<I1, F1, S1> a, fixed<I2, F2, S2> b)
+{
+    typedef typename product<fixed<I1, F1, S1>, fixed<I2, F2, S2> >::type P;
+    return P::from_raw((typename P::storage_type)a.raw * b.raw);
+}
+
+namespace detail {
+
+/* raw * 2^shift for shift >= 0, raw / 2^-shift rounded for shift < 0 */
+template <typename Rounding>
+constexpr int64_t shiftRaw(int64_t raw, int shift);
+
+template <>
+constexpr int64_t shiftRaw<Truncate>(int64_t raw, int shift)
+{
+    return shift >= 0 ? (int64_t)((uint64_t)raw << shift) : raw >> -shift;
+}
+
+template <>
+constexpr int64_t shiftRaw<RoundNearest>(int64_t raw, int shift)
+{
+    return shift >= 0 ? (int64_t)((uint64_t)raw << shift)
+                      : (raw + ((int64_t)1 << (-shift - 1))) >> -shift;
+}
+
+template <typename To, typename Overflow>
+struct Narrow;
+
+template <typename To>
+struct Narrow<To, Wrap> {
+    static constexpr To from(int64_t raw)
+    {
+        return To::from_raw((typename To::storage_type)raw);
+    }
+};
+
+template <typename To>
+struct Narrow<To, Saturate> {
+    static constexpr To from(int64_t raw)
+    {
+        return To::from_raw(raw > To::raw_max ? To::raw_max :
+                            raw < To::raw_min ? To::raw_min :
+                            (typename To::storage_type)raw);
+    }
+};
+
+} // namespace detail
+
+/*
+ * x in the format To. Going to fewer fraction bits rounds as Rounding says,
+ * going to fewer integer bits handles what no longer fits as Overflow says.
+ * The shift is done on the raw value widened to 64 bits.
+ */
+template <typename To, typename Rounding = Truncate, typename Overflow = Wrap,
+          int I, int F, typename S>
+constexpr To fixed_cast(fixed<I, F, S> x)
+{
+    return detail::Narrow<To, Overflow>::from(
+            detail::shiftRaw<Rounding>(x.raw, To::frac_bits - F));
+}
+
+/* The same raw bits read as To, which must have the same storage */
+template <typename To, int I, int F, typename S>
+constexpr To rescale(fixed<I, F, S> x)
+{
+    static_assert(std::is_same<typename To::storage_type, S>::value,
+                  "rescale keeps the raw value, so the storage must match");
+    return To::from_raw(x.raw);
+}
+
+typedef fixed<1, 15, int16_t> q15;      // kissFFT FIXED_POINT 16
+typedef fixed<1, 31, int32_t> q31;      // kissFFT FIXED_POINT 32
+typedef fixed<4, 12, int16_t> q12s;     // samples as IQmathFFT.m writes them
+typedef fixed<20, 12, int32_t> iq12;    // IQmath _q with GLOBAL_Q 12
+
+/*
+ * The fixed type a raw kissFFT scalar stands for; float and double stand
+ * for themselves.
+ */
+template <typename T> struct scalar_format { typedef T type; };
+template <> struct scalar_format<int16_t> { typedef q15 type; };
+template <> struct scalar_format<int32_t> { typedef q31 type; };
+
+/* The formats checked when compiling */
+static_assert(sizeof(q15) == sizeof(int16_t) && std::is_standard_layout<q15>::value,
+              "q15 must have the layout of int16_t");
+static_assert(std::is_same<product<q15, q15>::type, fixed<2, 30, int32_t> >::value,
+              "q15 * q15 is exact in 32 bits");
+static_assert(std::is_same<product<q31, q31>::type, fixed<2, 62, int64_t> >::value,
+              "q31 * q31 is exact in 64 bits");
+static_assert(std::is_same<sum<q15>::type, fixed<17, 15, int32_t> >::value &&
+              std::is_same<sum<q31>::type, fixed<33, 31, int64_t> >::value,
+              "sums are exact one size up");
+static_assert(fixed_cast<q15, RoundNearest>(q15::from_raw(0x4000) * q15::from_raw(0x4000)).raw == 0x2000,
+              "0.5 * 0.5 is 0.25");
+static_assert(fixed_cast<q15, RoundNearest, Saturate>(iq12::from_double(3.0)).raw == q15::raw_max,
+              "out of range values saturate");
+static_assert(rescale<q15>(q12s::from_double(1.0)).raw == 4096,
+              "rescale keeps the raw value");
+
+} // namespace static_fft
+
+#endif
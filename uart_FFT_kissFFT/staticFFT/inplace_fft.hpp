@@ -0,0 +1,147 @@
+/*
+ * In place real FFT for frames too large for a second buffer.
+ *
+ * InPlaceFFTR<T, MaxN> transforms n real samples, n a power of 2 up to
+ * MaxN chosen at runtime, in the memory they arrived in: the samples are
+ * read as n/2 complex values, bit reversed by swapping pairs, run through
+ * radix 2 stages and split into the real spectrum where they are. Bins 0 to
+ * n/2-1 replace the samples, with the real bin n/2 in the imaginary part of
+ * bin 0, so the whole transform needs 2 bytes a sample in Q15 and nothing
+ * else. kiss_fftr needs in[], out[], tmpbuf and its twiddles, about 4n.
+ *
+ * The twiddles are one constexpr table in flash of the first octant of the
+ * unit circle, exp(-2*pi*i*j/MaxN) for j = 0..MaxN/8, 8k for MaxN = 16384
+ * in Q15. twiddle() folds the rest of the half circle onto it, and smaller
+ * sizes read it with a stride.
+ *
+ * The arithmetic is StaticFFTR's: inputs of every butterfly divided by 2,
+ * the twiddle products rounded once, so fixed point outputs are divided by
+ * n as with kissFFT. It trades the unrolled radix 4 stages of StaticFFT for
+ * one table and one instantiation that does every size.
+ */
+#ifndef INPLACE_FFT_HPP
+#define INPLACE_FFT_HPP
+
+#include "static_fft.hpp"
+
+namespace static_fft {
+
+/* exp(-2*pi*i*j/N) for j = 0..N/8 */
+template <typename T, unsigned N>
+constexpr TwiddleTable<T, N/8 + 1> makeOctant()
+{
+    TwiddleTable<T, N/8 + 1> t{};
+    for (unsigned j = 0; j <= N/8; ++j) {
+        detail::CosSin v = detail::unitRoot(j, N);
+        t.w[j].r = Arith<T>::twiddle(v.c);
+        t.w[j].i = Arith<T>::twiddle(-v.s);
+    }
+    return t;
+}
+
+template <typename T, unsigned MaxN>
+class InPlaceFFTR {
+    static_assert(MaxN >= 8 && (MaxN & (MaxN-1)) == 0,
+                  "InPlaceFFTR needs a power of 2 of at least 8");
+
+public:
+    typedef Complex<T> cpx;
+
+    static constexpr TwiddleTable<T, MaxN/8 + 1> octant = makeOctant<T, MaxN>();
+
+    /*
+     * exp(-2*pi*i*j/MaxN) for j < MaxN/2. With theta in the second octant
+     * cos and sin swap places with those of pi/2 - theta, and a quarter
+     * turn further on is a multiplication by -i.
+     */
+    static cpx twiddle(unsigned j)
+    {
+        const unsigned eighth = MaxN/8;
+
+        if (j > 2*eighth) {
+            cpx w = twiddle(j - 2*eighth);
+            return cpx{w.i, (T)-w.r};
+        }
+        if (j > eighth) {
+            cpx w = octant.w[2*eighth - j];
+            return cpx{(T)-w.i, (T)-w.r};
+        }
+        return octant.w[j];
+    }
+
+    /*
+     * The n real samples at data, n a power of 2 from 8 to MaxN, replaced
+     * by bins 0 to n/2-1 as Complex<T>, bin n/2 in the imaginary part of
+     * bin 0.
+     */
+    static void forward(T *data, unsigned n)
+    {
+        typedef Arith<T> A;
+        cpx *buf = reinterpret_cast<cpx *>(data);
+        const unsigned NC = n/2, stride = MaxN/n;
+
+        /* Bit reversed order, j counting backwards through the bits */
+        for (unsigned i = 0, j = 0; i < NC; ++i) {
+            if (i < j) {
+                cpx t = buf[i];
+                buf[i] = buf[j];
+                buf[j] = t;
+            }
+            unsigned m = NC/2;
+            while (m && (j & m)) {
+                j ^= m;
+                m /= 2;
+            }
+            j |= m;
+        }
+
+        /* Radix 2 stages joining FFTs of length M; k == 0 needs no twiddle */
+        for (unsigned M = 1; M < NC; M *= 2) {
+            for (unsigned b = 0; b < NC; b += 2*M)
+                butterfly(buf + b, M, NULL);
+            for (unsigned k = 1; k < M; ++k) {
+                cpx tw = twiddle(k * (NC/M) * stride);
+                for (unsigned b = k; b < NC; b += 2*M)
+                    butterfly(buf + b, M, &tw);
+            }
+        }
+
+        /* Split into the spectrum of the real input, as StaticFFTR does,
+           with -i * exp(-2*pi*i*k/n) for the super twiddles */
+        cpx tdc = A::fixdiv(buf[0], 2);
+        buf[0] = cpx{(T)(tdc.r + tdc.i), (T)(tdc.r - tdc.i)};
+
+        for (unsigned k = 1; k <= NC/2; ++k) {
+            cpx fpk = A::fixdiv(buf[k], 2);
+            cpx fpnk = A::fixdiv(cpx{buf[NC-k].r, (T)-buf[NC-k].i}, 2);
+            cpx f1k{(T)(fpk.r + fpnk.r), (T)(fpk.i + fpnk.i)};
+            cpx f2k{(T)(fpk.r - fpnk.r), (T)(fpk.i - fpnk.i)};
+            cpx w = twiddle(k * stride);
+            cpx tw = A::cmul(f2k, cpx{w.i, (T)-w.r});
+
+            buf[k] = cpx{A::halfSum(f1k.r, tw.r), A::halfSum(f1k.i, tw.i)};
+            buf[NC-k] = cpx{A::halfDiff(f1k.r, tw.r), A::halfDiff(tw.i, f1k.i)};
+        }
+    }
+
+private:
+    /* a[0] and a[M] through one radix 2 butterfly, tw NULL for 1 */
+    static void butterfly(cpx *a, unsigned M, const cpx *tw)
+    {
+        typedef Arith<T> A;
+        cpx u = A::fixdiv(a[0], 2);
+        cpx t = A::fixdiv(a[M], 2);
+
+        if (tw)
+            t = A::cmul(t, *tw);
+        a[M] = cpx{(T)(u.r - t.r), (T)(u.i - t.i)};
+        a[0] = cpx{(T)(u.r + t.r), (T)(u.i + t.i)};
+    }
+};
+
+template <typename T, unsigned MaxN>
+constexpr TwiddleTable<T, MaxN/8 + 1> InPlaceFFTR<T, MaxN>::octant;
+
+} // namespace static_fft
+
+#endif
@@ -0,0 +1,23 @@
+/*
+ * inplace_fftr for the firmware: one instantiation, one octant table in
+ * flash, every size up to INPLACE_FFTR_MAX.
+ */
+#include "inplace_fftr.h"
+#include "inplace_fft.hpp"
+
+namespace {
+
+typedef static_fft::InPlaceFFTR<static_fft::q15, INPLACE_FFTR_MAX> fft;
+
+static_assert(sizeof(static_fft::q15) == sizeof(int16_t),
+              "the samples are read in place as q15");
+
+}
+
+bool inplace_fftr(int nfft, int16_t *data)
+{
+    if (nfft < 8 || nfft > INPLACE_FFTR_MAX || (nfft & (nfft-1)) != 0)
+        return false;
+    fft::forward(reinterpret_cast<static_fft::q15 *>(data), nfft);
+    return true;
+}
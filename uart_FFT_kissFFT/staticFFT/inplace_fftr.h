@@ -0,0 +1,31 @@
+/*
+ * C entry point to the in place real FFT in inplace_fft.hpp, in Q15 for
+ * the large frames of the in place engine (fftEngine/engine_inplace.c).
+ */
+#ifndef INPLACE_FFTR_H
+#define INPLACE_FFTR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Largest size, which fixes the twiddle table: 16384 is 8k of flash */
+#define INPLACE_FFTR_MAX        16384
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * The nfft Q15 samples at data replaced by bins 0 to nfft/2-1, each a real
+ * and an imaginary Q15 value, divided by nfft as kiss_fftr's are. Bin
+ * nfft/2 is real and takes the imaginary half of bin 0. Returns false
+ * without touching data unless nfft is a power of 2 from 8 to
+ * INPLACE_FFTR_MAX.
+ */
+bool inplace_fftr(int nfft, int16_t *data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
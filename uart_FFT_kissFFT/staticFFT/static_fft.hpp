@@ -0,0 +1,434 @@
+/*
+ * Compile time specialised FFT.
+ *
+ * StaticFFT<T, N, Plan> is a complex forward FFT of a size known when the
+ * code is compiled. Everything kissFFT works out at runtime is fixed here:
+ *
+ *  - twiddles and the input permutation are constexpr tables, so they end
+ *    up in flash on the board and cost nothing at startup
+ *  - Plan lists the radices (2 or 4) in the order the stages run; the
+ *    default is all radix 4 with one radix 2 stage first when log2(N) is odd
+ *  - the stages run one after another from a flat schedule unrolled by the
+ *    compiler, instead of kf_work recursing through factors[]
+ *  - radix and stage length are template arguments, so the butterfly loops
+ *    unroll, and the first stage and the k == 0 butterflies of every stage,
+ *    whose twiddles are all 1, are compiled without multiplications
+ *
+ * StaticFFTR<T, N> is the real input version, equivalent to kiss_fftr: N
+ * real samples in, N/2+1 bins out. It needs no scratch memory, so unlike
+ * kiss_fftr it is safe to call from several threads.
+ *
+ * T is float, double or a fixed<> format from fixed.hpp, q15 and q31 for
+ * the kissFFT fixed point builds (scalar_format maps kiss_fft_scalar to
+ * it). One format covers every stage, as in kissFFT: each butterfly
+ * divides its inputs by its radix, so values stay in T from input to
+ * output and no stage needs a format of its own. What is checked when
+ * compiling is the step out of T and back: every twiddle product is
+ * widened to product<T, T> and every sum of the real split to sum<T>, and
+ * each is brought back by an explicit fixed_cast, so code that would
+ * narrow or mix formats without one does not compile. The scaling matches
+ * kissFFT built for the same type: fixed point outputs are divided by N,
+ * floating point outputs are not scaled.
+ * Complex<T> has the layout of kiss_fft_cpx, so the two can share buffers.
+ *
+ * Needs C++14 for the constexpr tables.
+ */
+#ifndef STATIC_FFT_HPP
+#define STATIC_FFT_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+#include "fixed.hpp"
+
+namespace static_fft {
+
+template <typename T>
+struct Complex {
+    T r;
+    T i;
+};
+
+/* The radices of a plan, first stage first */
+template <unsigned... R>
+struct Radices {};
+
+namespace detail {
+
+/*
+ * constexpr cos and sin of 2*pi*j/n. The angle is folded into the first
+ * octant with integer arithmetic, where a short Taylor series is exact to
+ * double precision.
+ */
+struct CosSin {
+    double c;
+    double s;
+};
+
+constexpr double pi = 3.14159265358979323846;
+
+constexpr CosSin taylor(double x)
+{
+    double x2 = x*x, c = 1, s = x, tc = 1, ts = x;
+    for (int k = 1; k < 12; ++k) {
+        tc *= -x2 / ((2*k - 1) * (2*k));
+        ts *= -x2 / ((2*k) * (2*k + 1));
+        c += tc;
+        s += ts;
+    }
+    return CosSin{c, s};
+}
+
+constexpr CosSin unitRoot(unsigned long j, unsigned long n)
+{
+    /* angle = pi/2 * (quadrant + r/n) */
+    unsigned long quadrant = (4*(j % n)) / n;
+    unsigned long r = 4*(j % n) - quadrant*n;
+    CosSin v{0, 0};
+
+    if (2*r <= n) {
+        v = taylor(pi/2 * r / n);
+    } else {
+        CosSin w = taylor(pi/2 * (n - r) / n);
+        v = CosSin{w.s, w.c};
+    }
+
+    switch (quadrant) {
+    case 1: return CosSin{-v.s, v.c};
+    case 2: return CosSin{-v.c, -v.s};
+    case 3: return CosSin{v.s, -v.c};
+    }
+    return v;
+}
+
+constexpr long roundToLong(double v)
+{
+    /* floor(v + .5), which is what kissFFT uses for its fixed point twiddles */
+    double f = v + 0.5;
+    long i = static_cast<long>(f);
+    return (i > f) ? i - 1 : i;
+}
+
+/* Plan helpers */
+template <typename Plan> struct PlanInfo;
+
+template <>
+struct PlanInfo<Radices<> > {
+    static constexpr unsigned size = 1;
+    static constexpr bool valid = true;
+};
+
+template <unsigned R, unsigned... Rest>
+struct PlanInfo<Radices<R, Rest...> > {
+    static constexpr unsigned size = R * PlanInfo<Radices<Rest...> >::size;
+    static constexpr bool valid = (R == 2 || R == 4) && PlanInfo<Radices<Rest...> >::valid;
+};
+
+template <unsigned N, unsigned... R>
+struct DefaultPlan {
+    static_assert(N > 4 && (N & (N-1)) == 0, "StaticFFT sizes must be powers of 2");
+    typedef typename DefaultPlan<N/4, 4, R...>::type type;
+};
+
+template <unsigned... R>
+struct DefaultPlan<4, R...> { typedef Radices<4, R...> type; };
+
+template <unsigned... R>
+struct DefaultPlan<2, R...> { typedef Radices<2, R...> type; };
+
+template <unsigned... R>
+struct DefaultPlan<1, R...> { typedef Radices<R...> type; };
+
+} // namespace detail
+
+/*
+ * Arithmetic per scalar type. fixdiv scales a butterfly input by 1/p,
+ * which fixed point needs to stay in range. halfSum and halfDiff are
+ * (a + b)/2 and (a - b)/2, which always fit T although a + b may not.
+ */
+template <typename T>
+struct Arith {
+    static_assert(std::is_floating_point<T>::value,
+                  "fixed point scalars must be fixed<> formats, see scalar_format");
+
+    static constexpr T twiddle(double v) { return static_cast<T>(v); }
+
+    static Complex<T> cmul(const Complex<T> &a, const Complex<T> &b)
+    {
+        return Complex<T>{a.r*b.r - a.i*b.i, a.r*b.i + a.i*b.r};
+    }
+
+    static Complex<T> fixdiv(const Complex<T> &a, unsigned) { return a; }
+    static T halfSum(T a, T b) { return (a + b) * T(0.5); }
+    static T halfDiff(T a, T b) { return (a - b) * T(0.5); }
+};
+
+/*
+ * Fixed point. Twiddles are scaled by raw_max rather than 2^FracBits, as
+ * kissFFT does. Products are exact in the wider format P and rounded back
+ * to T, the same multiply, add and shift the raw integer code did.
+ */
+template <int I, int F, typename S>
+struct Arith<fixed<I, F, S> > {
+    typedef fixed<I, F, S> T;
+    typedef typename product<T, T>::type P;
+    typedef typename sum<T>::type W;
+
+    static_assert(W::int_bits > T::int_bits && W::frac_bits == T::frac_bits,
+                  "the split's sums need one integer bit more than T");
+
+    static constexpr T twiddle(double v)
+    {
+        return T::from_raw(static_cast<S>(detail::roundToLong(T::raw_max * v)));
+    }
+
+    /* Both products are summed before the one rounding, one SMULL and one
+       SMLAL per output for Q31 on the M4 */
+    static Complex<T> cmul(const Complex<T> &a, const Complex<T> &b)
+    {
+        P r = a.r * b.r - a.i * b.i;
+        P i = a.r * b.i + a.i * b.r;
+        return Complex<T>{fixed_cast<T, RoundNearest>(r), fixed_cast<T, RoundNearest>(i)};
+    }
+
+    static T smul(T a, T b)
+    {
+        return fixed_cast<T, RoundNearest>(a * b);
+    }
+
+    static Complex<T> fixdiv(const Complex<T> &a, unsigned p)
+    {
+        const T scale = T::from_raw((S)(T::raw_max / p));
+        return Complex<T>{smul(a.r, scale), smul(a.i, scale)};
+    }
+
+    /* In the wider format W and shifted there, as kiss_fftr's HALF_OF
+       does on the int promoted sum, so full scale inputs do not wrap */
+    static T halfSum(T a, T b)
+    {
+        return fixed_cast<T>((fixed_cast<W>(a) + fixed_cast<W>(b)) >> 1);
+    }
+
+    static T halfDiff(T a, T b)
+    {
+        return fixed_cast<T>((fixed_cast<W>(a) - fixed_cast<W>(b)) >> 1);
+    }
+};
+
+/* exp(-2*pi*i*j/N) for j < N */
+template <typename T, unsigned N>
+struct TwiddleTable {
+    Complex<T> w[N];
+};
+
+template <typename T, unsigned N>
+constexpr TwiddleTable<T, N> makeTwiddles()
+{
+    TwiddleTable<T, N> t{};
+    for (unsigned j = 0; j < N; ++j) {
+        detail::CosSin v = detail::unitRoot(j, N);
+        t.w[j].r = Arith<T>::twiddle(v.c);
+        t.w[j].i = Arith<T>::twiddle(-v.s);
+    }
+    return t;
+}
+
+/*
+ * Input order for a decimation in time plan: the stages work on
+ * neighbouring blocks, so input n goes to the position given by reading
+ * its mixed radix digits backwards. perm[pos] is the input for pos.
+ */
+template <unsigned N>
+struct PermTable {
+    typename std::conditional<(N <= 65536), uint16_t, uint32_t>::type perm[N];
+};
+
+template <unsigned N, unsigned... R>
+constexpr PermTable<N> makePerm(Radices<R...>)
+{
+    const unsigned radices[] = {R..., 1};
+    const unsigned count = sizeof...(R);
+    PermTable<N> t{};
+    for (unsigned n = 0; n < N; ++n) {
+        unsigned pos = 0, size = N, rem = n;
+        for (unsigned s = count; s-- > 0; ) {
+            size /= radices[s];
+            pos += (rem % radices[s]) * size;
+            rem /= radices[s];
+        }
+        t.perm[pos] = n;
+    }
+    return t;
+}
+
+template <typename T, unsigned N,
+          typename Plan = typename detail::DefaultPlan<N>::type>
+class StaticFFT {
+    static_assert(detail::PlanInfo<Plan>::size == N, "radices must multiply to N");
+    static_assert(detail::PlanInfo<Plan>::valid, "only radix 2 and 4 stages are supported");
+
+public:
+    typedef Complex<T> cpx;
+
+    static constexpr TwiddleTable<T, N> twiddles = makeTwiddles<T, N>();
+    static constexpr PermTable<N> order = makePerm<N>(Plan());
+
+    /* out = FFT(in); in and out must not overlap */
+    static void forward(const cpx *in, cpx *out)
+    {
+        for (unsigned n = 0; n < N; ++n)
+            out[n] = in[order.perm[n]];
+        Stages<1, Plan>::run(out);
+    }
+
+    /* the permutation is done, run the stages in place on buf */
+    static void stages(cpx *buf)
+    {
+        Stages<1, Plan>::run(buf);
+    }
+
+private:
+    typedef Arith<T> A;
+
+    static void butterfly(cpx *a, std::integral_constant<unsigned, 2>)
+    {
+        cpx t = a[1];
+        a[1] = cpx{(T)(a[0].r - t.r), (T)(a[0].i - t.i)};
+        a[0] = cpx{(T)(a[0].r + t.r), (T)(a[0].i + t.i)};
+    }
+
+    static void butterfly(cpx *a, std::integral_constant<unsigned, 4>)
+    {
+        cpx t0{(T)(a[0].r + a[2].r), (T)(a[0].i + a[2].i)};
+        cpx t1{(T)(a[0].r - a[2].r), (T)(a[0].i - a[2].i)};
+        cpx t2{(T)(a[1].r + a[3].r), (T)(a[1].i + a[3].i)};
+        cpx t3{(T)(a[1].r - a[3].r), (T)(a[1].i - a[3].i)};
+        a[0] = cpx{(T)(t0.r + t2.r), (T)(t0.i + t2.i)};
+        a[2] = cpx{(T)(t0.r - t2.r), (T)(t0.i - t2.i)};
+        /* t1 -/+ j*t3 */
+        a[1] = cpx{(T)(t1.r + t3.i), (T)(t1.i - t3.r)};
+        a[3] = cpx{(T)(t1.r - t3.i), (T)(t1.i + t3.r)};
+    }
+
+    /* One radix P butterfly on the inputs M apart from a, in place */
+    template <unsigned P, unsigned M, bool Twiddled>
+    static void butterflyAt(cpx *a, const cpx *tw)
+    {
+        cpx v[P];
+        for (unsigned q = 0; q < P; ++q)
+            v[q] = A::fixdiv(a[q*M], P);
+        if (Twiddled) {
+            for (unsigned q = 1; q < P; ++q)
+                v[q] = A::cmul(v[q], tw[q]);
+        }
+        butterfly(v, std::integral_constant<unsigned, P>());
+        for (unsigned q = 0; q < P; ++q)
+            a[q*M] = v[q];
+    }
+
+    /* Combine blocks of P sub-FFTs of length M into FFTs of length P*M */
+    template <unsigned P, unsigned M>
+    static void stage(cpx *buf)
+    {
+        const unsigned L = P*M, stride = N/L;
+
+        /* k == 0 needs no twiddles, and with M == 1 that is the whole stage */
+        for (unsigned b = 0; b < N; b += L)
+            butterflyAt<P, M, false>(buf + b, NULL);
+
+        /* twiddles only depend on k, so load them once for all blocks */
+        for (unsigned k = 1; k < M; ++k) {
+            cpx tw[P];
+            for (unsigned q = 1; q < P; ++q)
+                tw[q] = twiddles.w[q*k*stride];
+            for (unsigned b = 0; b < N; b += L)
+                butterflyAt<P, M, true>(buf + b + k, tw);
+        }
+    }
+
+    template <unsigned M, typename Rest> struct Stages;
+
+    template <unsigned M>
+    struct Stages<M, Radices<> > {
+        static void run(cpx *) {}
+    };
+
+    template <unsigned M, unsigned P, unsigned... Rest>
+    struct Stages<M, Radices<P, Rest...> > {
+        static void run(cpx *buf)
+        {
+            stage<P, M>(buf);
+            Stages<M*P, Radices<Rest...> >::run(buf);
+        }
+    };
+};
+
+template <typename T, unsigned N, typename Plan>
+constexpr TwiddleTable<T, N> StaticFFT<T, N, Plan>::twiddles;
+
+template <typename T, unsigned N, typename Plan>
+constexpr PermTable<N> StaticFFT<T, N, Plan>::order;
+
+/* -j * exp(-2*pi*i*k/N) for k = 1..N/4, kiss_fftr's super twiddles */
+template <typename T, unsigned N>
+constexpr TwiddleTable<T, N/4> makeSuperTwiddles()
+{
+    TwiddleTable<T, N/4> t{};
+    for (unsigned k = 1; k <= N/4; ++k) {
+        detail::CosSin v = detail::unitRoot(k, N);
+        t.w[k-1].r = Arith<T>::twiddle(-v.s);
+        t.w[k-1].i = Arith<T>::twiddle(-v.c);
+    }
+    return t;
+}
+
+template <typename T, unsigned N,
+          typename Plan = typename detail::DefaultPlan<N/2>::type>
+class StaticFFTR {
+    static_assert(N >= 4, "StaticFFTR needs at least 4 samples");
+
+public:
+    typedef Complex<T> cpx;
+    typedef StaticFFT<T, N/2, Plan> Half;
+
+    static constexpr TwiddleTable<T, N/4> superTwiddles = makeSuperTwiddles<T, N>();
+
+    /* N real samples in, N/2+1 bins out */
+    static void forward(const T *timedata, cpx *freqdata)
+    {
+        const unsigned NC = N/2;
+        const cpx *packed = reinterpret_cast<const cpx *>(timedata);
+        typedef Arith<T> A;
+
+        /* FFT of the even samples in r and the odd ones in i, straight
+           into freqdata */
+        for (unsigned n = 0; n < NC; ++n)
+            freqdata[n] = packed[Half::order.perm[n]];
+        Half::stages(freqdata);
+
+        /* Split into the spectrum of the real input. Bins k and NC-k only
+           depend on each other, so this works in place. */
+        cpx tdc = A::fixdiv(freqdata[0], 2);
+        freqdata[0] = cpx{(T)(tdc.r + tdc.i), T()};
+        freqdata[NC] = cpx{(T)(tdc.r - tdc.i), T()};
+
+        for (unsigned k = 1; k <= NC/2; ++k) {
+            cpx fpk = A::fixdiv(freqdata[k], 2);
+            cpx fpnk = A::fixdiv(cpx{freqdata[NC-k].r, (T)-freqdata[NC-k].i}, 2);
+            cpx f1k{(T)(fpk.r + fpnk.r), (T)(fpk.i + fpnk.i)};
+            cpx f2k{(T)(fpk.r - fpnk.r), (T)(fpk.i - fpnk.i)};
+            cpx tw = A::cmul(f2k, superTwiddles.w[k-1]);
+
+            freqdata[k] = cpx{A::halfSum(f1k.r, tw.r), A::halfSum(f1k.i, tw.i)};
+            freqdata[NC-k] = cpx{A::halfDiff(f1k.r, tw.r), A::halfDiff(tw.i, f1k.i)};
+        }
+    }
+};
+
+template <typename T, unsigned N, typename Plan>
+constexpr TwiddleTable<T, N/4> StaticFFTR<T, N, Plan>::superTwiddles;
+
+} // namespace static_fft
+
+#endif
@@ -0,0 +1,38 @@
+/*
+ * static_fftr for the firmware. Each size below is a separate instantiation
+ * with its own twiddle and permutation tables in flash, so only the
+ * power of 2 sizes from planSizes[] are listed.
+ */
+#include "static_fftr.h"
+#include "static_fft.hpp"
+
+namespace {
+
+/* q15 or q31 for the fixed point builds, which have the raw scalar's layout */
+typedef static_fft::scalar_format<kiss_fft_scalar>::type scalar;
+typedef static_fft::Complex<scalar> cpx;
+
+static_assert(sizeof(scalar) == sizeof(kiss_fft_scalar) && sizeof(cpx) == sizeof(kiss_fft_cpx),
+              "the static FFT must share kissFFT's buffers");
+
+template <unsigned N>
+bool run(const kiss_fft_scalar *timedata, kiss_fft_cpx *freqdata)
+{
+    static_fft::StaticFFTR<scalar, N>::forward(reinterpret_cast<const scalar *>(timedata),
+            reinterpret_cast<cpx *>(freqdata));
+    return true;
+}
+
+}
+
+bool static_fftr(int nfft, const kiss_fft_scalar *timedata, kiss_fft_cpx *freqdata)
+{
+    switch (nfft) {
+    case 64:    return run<64>(timedata, freqdata);
+    case 128:   return run<128>(timedata, freqdata);
+    case 256:   return run<256>(timedata, freqdata);
+    case 512:   return run<512>(timedata, freqdata);
+    case 1024:  return run<1024>(timedata, freqdata);
+    }
+    return false;
+}
@@ -0,0 +1,27 @@
+/*
+ * C entry point to the compile time specialised real FFT in static_fft.hpp,
+ * built for the kissFFT scalar type selected in kiss_fft_config.h.
+ */
+#ifndef STATIC_FFTR_H
+#define STATIC_FFTR_H
+
+#include <stdbool.h>
+
+#include "../kissFFT/kiss_fft.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Same input, output and scaling as kiss_fftr, for the sizes listed in
+ * static_fftr.cpp. Returns false without touching freqdata for any other
+ * size, so the caller can fall back to kiss_fftr.
+ */
+bool static_fftr(int nfft, const kiss_fft_scalar *timedata, kiss_fft_cpx *freqdata);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
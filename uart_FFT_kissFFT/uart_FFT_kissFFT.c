@@ -70,6 +70,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 
 //![Simple UART Config]
 /* UART Configuration Parameter. These are the configuration parameters to
@@ -92,27 +93,250 @@ const eUSCI_UART_Config uartConfig =
 };
 //![Simple UART Config]
 
- /* Select the global Q value */
- #define GLOBAL_Q    12
+/*
+ * The FFT itself is done by one of the engines in fftEngine/, kissFFT,
+ * IQmath cFFT or the in place one for LARGE_FRAMES; which are built in is
+ * chosen in fftEngine/fft_engine.h, the scalar type, Q15, Q31 or float, in
+ * kissFFT/kiss_fft_config.h.
+ */
+#include "fftEngine/fft_engine.h"
+#ifdef CHECK_OVERFLOW
+#include "kissFFT/kiss_fft.h"
+#endif
+
+ /* Specify the default sample size and sample frequency. Both can be changed
+  * at runtime with the 'N' and 'S' commands below. */
+ #define SAMPLES         1024          // must be one of planSizes[]
+ #define SAMPLE_FREQ     8192            // no larger than SAMPLE_FREQ_MAX
+ #define SAMPLE_FREQ_MAX 16384
+
+ /*
+  * MCLK_48MHZ runs the core at 48 MHz instead of 12 MHz. Flash reads then
+  * take a wait state, which RAMFUNC_KERNELS (kissFFT/kiss_fft_config.h)
+  * keeps out of the FFT; SupportFiles/fft_cycles.py compares the two. SMCLK
+  * stays at 12 MHz, so the UART setup above holds either way.
+  */
+//#define MCLK_48MHZ
+
+ /*
+  * LOW_POWER sleeps in LPM0 between commands instead of spinning: the UART
+  * interrupt runs with sleep on ISR exit and only wakes main once a whole
+  * command is in. While waiting MCLK is DCO/16 at core voltage 0; only the
+  * FFT and the magnitudes run at 48 MHz. LPM3 would stop SMCLK and so the
+  * UART, which is the only wake up source here. TEL_WAIT_CYCLES gives the
+  * time spent awake while waiting, for energy per frame (fft_cycles.py).
+  */
+//#define LOW_POWER
+
+ /* Largest entry of planSizes[], sizes the sample and result buffers. */
+#ifdef LARGE_FRAMES
+ #define MAX_SAMPLES     16384
+#else
+ #define MAX_SAMPLES     1200
+#endif
+
+/*
+ * FFT sizes the board can switch between, as far as the engine in use can
+ * do them. Any even size works with kissFFT, cFFT only does powers of 2;
+ * 1000 and 1200 match the frame lengths of our sensors. The table lives in
+ * flash; the engine's plan for the selected size is built into planMemory,
+ * which is allocated once at startup for the largest plan of any engine so
+ * switching never touches the heap again. An engine only does a size when
+ * its work buffer fits work[] and its plan the heap, see engineFits().
+ * LARGE_FRAMES (fftEngine/fft_engine.h) adds the sizes only the in place
+ * engine fits.
+ */
+#ifdef LARGE_FRAMES
+const uint16_t planSizes[] = {64, 128, 256, 512, 1000, 1024, 1200,
+                              2048, 4096, 8192, 16384};
+#else
+const uint16_t planSizes[] = {64, 128, 256, 512, 1000, 1024, 1200};
+#endif
+#define PLAN_COUNT      (sizeof(planSizes)/sizeof(planSizes[0]))
+
+/*
+ * Command channel. Every message from the host starts with a command byte:
+ *   'F' + 2*N bytes   frame of N samples, answered with the spectrum
+ *   'N' + word        select FFT size N, answered with 'A' + N
+ *   'S' + word        set sample frequency, 1 to SAMPLE_FREQ_MAX, answered
+ *                     with 'A' + frequency
+ *   'E' + byte        select FFT engine (FFT_ENGINE_* in fftEngine/
+ *                     fft_engine.h), answered with 'A' + engine (byte)
+ *   '?'               capabilities, answered with 'C' + PROTOCOL_VERSION,
+ *                     flags, N, sample frequency, SAMPLE_FREQ_MAX,
+ *                     plan count (byte) and each plan size the current
+ *                     engine can do
+ *   'T'               telemetry, answered with 'T' + count (byte) and that
+ *                     many tag (byte), value (32 bit) pairs
+ * Errors are answered with 'E' + one of the codes below. Words are 16 bit,
+ * least significant byte first. The host waits for each answer before
+ * sending the next command.
+ */
+#define PROTOCOL_VERSION        1
+#define CAP_DIFF_OUTPUT         0x01    // spectra are sent as 'K'/'D' frames
+#define CAP_BFP_OUTPUT          0x02    // spectra are sent as 'B' frames
+#define CAP_FLOAT_OUTPUT        0x04    // magnitudes are 32 bit floats
+#define CAP_RAMFUNC_KERNELS     0x08    // the FFT runs from SRAM
+#define CAP_LOW_POWER           0x10    // sleeps between commands
+
+/*
+ * Telemetry tags. Cycles are counted by the DWT cycle counter, so they are
+ * MCLK cycles; TEL_MCLK_HZ converts them to time.
+ */
+#define TEL_FFT_CYCLES          1       // last FFT
+#define TEL_MAGNITUDE_CYCLES    2       // magnitudes of the last FFT
+#define TEL_MCLK_HZ             3       // clock of the two above
+#define TEL_ENGINE              13      // FFT_ENGINE_* in use
+#define TEL_ENGINES             14      // bit per FFT_ENGINE_* built in
+#define TELEMETRY_COUNT         13
+
+/*
+ * Memory use in bytes, so the largest plan size that fits can be picked
+ * (SupportFiles/sram_budget.py puts them next to the linker map). The
+ * reset handler paints the free SRAM from the end of .sysmem to the stack
+ * with STACK_PAINT; TEL_STACK_PEAK is how far below __STACK_END the paint
+ * has been overwritten since. Above TEL_STACK_SIZE the stack has left its
+ * section and eats into TEL_SRAM_FREE, which nothing checks.
+ */
+#define TEL_STACK_PEAK          5       // deepest the stack has been
+#define TEL_STACK_SIZE          6       // --stack_size
+#define TEL_SRAM_FREE           7       // between .sysmem and the stack section
+#define TEL_PLAN_BYTES          8       // the engine's need, current size
+#define TEL_PLAN_MEMORY         9       // heap taken for plans, largest size
+#define TEL_HEAP_SIZE           10      // --heap_size
+
+/*
+ * Time awake between frames, spent in the UART interrupt and answering
+ * other commands, in cycles of TEL_IDLE_MCLK_HZ. The cycle counter stops
+ * while the core sleeps, so with LOW_POWER the rest of the frame period
+ * is LPM0; without it the core never sleeps.
+ */
+#define TEL_IDLE_MCLK_HZ        11
+#define TEL_WAIT_CYCLES         12      // before the last frame
+
+/*
+ * With CHECK_OVERFLOW (kissFFT/kiss_fft_config.h) the telemetry also holds
+ * the overflows counted since start up: TEL_OVERFLOWS in all, then one tag
+ * for every radix and stage that has any, TEL_OVERFLOW_BASE + radix * 8 +
+ * stage, with radix and stage as in kiss_fft_overflows.
+ */
+#define TEL_OVERFLOWS           4
+#define TEL_OVERFLOW_BASE       0x40
 
-/* Select FIXED point option for kissFFT */
-#define FIXED_POINT 16
+/* Same as in ccs/startup_msp432p401r_ccs.c */
+#define STACK_PAINT             0xA5C3A5C3
 
-#include "kissFFT/kiss_fftr.h"
-#include "kissFFT/kiss_fft_guts.h"
+/* Linker symbols, their addresses are the values */
+extern unsigned long __STACK_END;
+extern unsigned long __STACK_SIZE;
+extern unsigned long __SYSMEM_SIZE;
+#define HEAP_OVERHEAD           8       // rts malloc header and alignment
+extern unsigned long __SRAM_DATA_END;
 
- /* Include the iqmathlib header files */
- #include <ti/iqmathlib/QmathLib.h>
- #include <ti/iqmathlib/IQmathLib.h>
+#define ERR_UNKNOWN_COMMAND     1
+#define ERR_UNSUPPORTED_SIZE    2
+#define ERR_BAD_SAMPLE_FREQ     3
+#define ERR_UNSUPPORTED_ENGINE  4       // not built in, or not at this size
 
- /* Specify the sample size and sample frequency. */
- #define SAMPLES         1024          // power of 2 no larger than 256
- #define SAMPLE_FREQ     8192            // no larger than 16384
+/*
+ * Differential output. When DIFF_OUTPUT is defined the board remembers the
+ * magnitudes it last transmitted and only sends bins that have moved by more
+ * than DIFF_DEADBAND since then. Every DIFF_KEYFRAME_INTERVAL frames a full
+ * spectrum is sent so the host can resynchronise.
+ *
+ * Each frame starts with a type byte:
+ *   'K'  keyframe: N/2 magnitudes follow
+ *   'D'  delta: run count, then for each run its start bin, its length and
+ *        that many magnitudes
+ * Without DIFF_OUTPUT the N/2 magnitudes are sent on their own.
+ */
+//#define DIFF_OUTPUT
+#define DIFF_DEADBAND           4       // LSB change needed to resend a bin
+#define DIFF_KEYFRAME_INTERVAL  16      // frames between full spectra
+#define DIFF_MAX_GAP            2       // unchanged bins merged into a run
+
+/*
+ * Block floating point. With BFP_OUTPUT (fftEngine/fft_engine.h) the
+ * engines only scale the stages that could overflow, so small signals keep
+ * their low bits. Each spectrum is then sent as
+ *   'B' + exponent (byte) + N/2 unsigned magnitudes
+ * where |DFT| = magnitude * 2^exponent; divide by N for the usual scale.
+ */
+
+#if defined(BFP_OUTPUT) && defined(DIFF_OUTPUT)
+#error "DIFF_OUTPUT works on the usual scale and cannot be combined with BFP_OUTPUT"
+#endif
+
+/*
+ * Float build. With KISS_FFT_FLOAT kissFFT runs on the FPU. Frames are
+ * still received as 16 bit samples and converted in place; the magnitudes
+ * are sent as 32 bit floats on the same scale as the Q15 words, |DFT|/N.
+ */
+#ifdef KISS_FFT_FLOAT
+#if defined(BFP_OUTPUT) || defined(DIFF_OUTPUT)
+#error "BFP_OUTPUT and DIFF_OUTPUT need the fixed point engine"
+#endif
+#endif
 
 volatile int bytes = 0;
 volatile char msg;
 char *information_bytes;
 
+volatile char command = 0;              // command being received, 0 when idle
+volatile int payloadSize = 0;           // bytes expected after the command
+volatile bool commandReady = false;     // set by the ISR, cleared by main
+uint8_t commandArgs[2];
+
+volatile int samples = SAMPLES;         // current FFT size
+uint16_t sampleFreq = SAMPLE_FREQ;
+
+uint32_t fftCycles = 0;                 // telemetry, see TEL_*
+uint32_t magnitudeCycles = 0;
+uint32_t computeMclk;                   // MCLK the two above were counted at
+uint32_t idleMclk;
+uint32_t waitCycles = 0;
+uint32_t frameEnd = 0;                  // DWT->CYCCNT after the last frame
+
+const fft_engine *engine;              // engine in use, see selectEngine()
+int engineId;
+void *plan;
+void *planMemory;
+size_t planMemorySize;
+size_t planBytes;                       // of planMemory the current plan uses
+
+/*
+ * Samples in, magnitudes out, whatever the engine does in between. It is
+ * in .bss: even 1024 samples for cFFT are 8k, far more than the 512 or
+ * 1024 byte stack section. With LARGE_FRAMES it is sized for the in place
+ * engine alone, the others get the sizes that fit in it.
+ */
+#ifdef LARGE_FRAMES
+#define WORK_BYTES      INPLACE_WORK_BYTES(MAX_SAMPLES)
+#else
+#define WORK_BYTES      ((FFT_WORK_BYTES(MAX_SAMPLES) + 3) & ~3)
+#endif
+uint32_t work[WORK_BYTES / 4];
+
+#ifdef DIFF_OUTPUT
+int16_t lastSent[MAX_SAMPLES/2];        // magnitudes as the host last saw them
+int framesSinceKey = 0;
+
+void sendDifferential(const int16_t *mag);
+#endif
+
+void sendWord(uint16_t word);
+void sendLong(uint32_t value);
+bool engineFits(const fft_engine *e, uint16_t size);
+bool selectPlan(uint16_t size);
+bool selectEngine(int id);
+void sendCapabilities(void);
+void sendTelemetry(void);
+uint32_t stackPeak(void);
+#ifdef LOW_POWER
+void clockIdle(void);
+void clockCompute(void);
+#endif
+
 int main(void)
     {
     /* Halting WDT  */
@@ -122,8 +346,19 @@ int main(void)
     MAP_GPIO_setAsPeripheralModuleFunctionInputPin(GPIO_PORT_P1,
             GPIO_PIN2 | GPIO_PIN3, GPIO_PRIMARY_MODULE_FUNCTION);
 
+#if defined(LOW_POWER)
+    clockIdle();
+#elif defined(MCLK_48MHZ)
+    /* 48MHz needs core voltage level 1 and a flash wait state */
+    MAP_PCM_setCoreVoltageLevel(PCM_VCORE1);
+    MAP_FlashCtl_setWaitState(FLASH_BANK0, 1);
+    MAP_FlashCtl_setWaitState(FLASH_BANK1, 1);
+    CS_setDCOCenteredFrequency(CS_DCO_FREQUENCY_48);
+    MAP_CS_initClockSignal(CS_SMCLK, CS_DCOCLK_SELECT, CS_CLOCK_DIVIDER_4);
+#else
     /* Setting DCO to 12MHz */
     CS_setDCOCenteredFrequency(CS_DCO_FREQUENCY_12);
+#endif
 
     //![Simple UART Example]
     /* Configuring UART Module */
@@ -139,50 +374,167 @@ int main(void)
     MAP_Interrupt_enableMaster();   
     //![Simple UART Example]
 
+#ifdef KISS_FFT_FLOAT
+    MAP_FPU_enableModule();
+#endif
+
+    /* Start the cycle counter used for telemetry. */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    computeMclk = idleMclk = CS_getMCLK();
+
     volatile uint32_t i;
 
     // Stop watchdog timer
     WDT_A_hold(WDT_A_BASE);
 
-    const int rcvMessageSize = SAMPLES;//Size of received message array
-    const int sndMessageSize = SAMPLES/2;//Size of sending message array
+    fft_magnitude *mag = (fft_magnitude *)work;
+#ifdef BFP_OUTPUT
+    int exponent;
+#endif
+    uint32_t start;
+    int e;
 
-    kiss_fft_scalar  in[SAMPLES];
-    kiss_fft_cpx  out[SAMPLES];
-    kiss_fftr_cfg  kiss_fftr_state;
-    kiss_fftr_state = kiss_fftr_alloc(SAMPLES,0,0,0);
+    /* Size the plan memory for the largest plan, then build the default one. */
+    planMemorySize = 0;
+    for (e = 0; e < FFT_ENGINE_COUNT; e++) {
+        if (fftEngines[e] == NULL)
+            continue;
+        for (i = 0; i < PLAN_COUNT; i++) {
+            size_t len = fftEngines[e]->planSize(planSizes[i]);
+            if (engineFits(fftEngines[e], planSizes[i]) && len > planMemorySize)
+                planMemorySize = len;
+        }
+    }
+    planMemory = malloc(planMemorySize);
+    engine = fftEngines[FFT_ENGINE_DEFAULT];
+    engineId = FFT_ENGINE_DEFAULT;
+    selectPlan(SAMPLES);
 
-    information_bytes = (char*)&in;
+    information_bytes = (char*)work;
 
     while(1)
     {
         int16_t i;
 
+#ifdef LOW_POWER
+        /*
+         * Sleep until the interrupt has a whole command. Masked, a command
+         * completing between the test and the sleep still wakes the core
+         * (WFI returns on a pending interrupt), and the interrupt runs once
+         * unmasked; after that it sleeps on exit until the command is in.
+         */
+        MAP_Interrupt_disableMaster();
+        if (!commandReady) {
+            MAP_Interrupt_enableSleepOnIsrExit();
+            MAP_PCM_gotoLPM0();
+        }
+        MAP_Interrupt_enableMaster();
+#else
         /* Disable WDT. */
         WDT_A->CTL = WDT_A_CTL_PW | WDT_A_CTL_HOLD;
+#endif
 
-        if (bytes == 2*rcvMessageSize)
+        if (commandReady)
         {
+            switch (command)
+            {
+            case 'F':
+                waitCycles = DWT->CYCCNT - frameEnd;
+#ifdef LOW_POWER
+                clockCompute();
+#endif
+                /* The engine takes the samples from work, so that is timed too. */
+                start = DWT->CYCCNT;
+#ifdef BFP_OUTPUT
+                exponent = engine->execute(plan, samples, work);
+#else
+                engine->execute(plan, samples, work);
+#endif
+                fftCycles = DWT->CYCCNT - start;
 
-            kiss_fftr(kiss_fftr_state,in,out);
+                /* Calculate the magnitude of the results. */
+                start = DWT->CYCCNT;
+                engine->magnitude(plan, samples, work);
+                magnitudeCycles = DWT->CYCCNT - start;
+#ifdef LOW_POWER
+                clockIdle();
+#endif
+                frameEnd = DWT->CYCCNT;
 
-            /* Calculate the magnitude and phase angle of the results. */
-            for (i = 0; i < SAMPLES/2; i++) {
-                in[i] = _Qmag(out[i].r, out[i].i);
-            }
+                //Transmit
+#if defined(KISS_FFT_FLOAT)
+                for (i = 0; i < samples/2; i++)
+                {
+                    uint32_t bits;
+                    memcpy(&bits, &mag[i], sizeof(bits));
+                    sendLong(bits);
+                }
+#elif defined(DIFF_OUTPUT)
+                sendDifferential(mag);
+#else
+#ifdef BFP_OUTPUT
+                UART_transmitData(EUSCI_A0_BASE, 'B');
+                UART_transmitData(EUSCI_A0_BASE, exponent);
+#endif
+                for (i = 0; i < samples/2; i++)
+                {
+                    sendWord(mag[i]);
+                }
+#endif
+                break;
 
-            //Transmit
-            int sendMsgCount;
-            for (sendMsgCount = 0; sendMsgCount < sndMessageSize; sendMsgCount++)
-            {
-                UART_transmitData(EUSCI_A0_BASE, (in[sendMsgCount]%256));
-                UART_transmitData(EUSCI_A0_BASE, (in[sendMsgCount]/256));
-                //UART_transmitData(EUSCI_A0_BASE, '\n');
+            case 'N':
+                if (selectPlan(commandArgs[0] + 256*commandArgs[1])) {
+                    UART_transmitData(EUSCI_A0_BASE, 'A');
+                    sendWord(samples);
+                } else {
+                    UART_transmitData(EUSCI_A0_BASE, 'E');
+                    UART_transmitData(EUSCI_A0_BASE, ERR_UNSUPPORTED_SIZE);
+                }
+                break;
+
+            case 'E':
+                if (selectEngine(commandArgs[0])) {
+                    UART_transmitData(EUSCI_A0_BASE, 'A');
+                    UART_transmitData(EUSCI_A0_BASE, engineId);
+                } else {
+                    UART_transmitData(EUSCI_A0_BASE, 'E');
+                    UART_transmitData(EUSCI_A0_BASE, ERR_UNSUPPORTED_ENGINE);
+                }
+                break;
+
+            case 'S':
+                if (commandArgs[0] + 256*commandArgs[1] >= 1 &&
+                    commandArgs[0] + 256*commandArgs[1] <= SAMPLE_FREQ_MAX) {
+                    sampleFreq = commandArgs[0] + 256*commandArgs[1];
+                    UART_transmitData(EUSCI_A0_BASE, 'A');
+                    sendWord(sampleFreq);
+                } else {
+                    UART_transmitData(EUSCI_A0_BASE, 'E');
+                    UART_transmitData(EUSCI_A0_BASE, ERR_BAD_SAMPLE_FREQ);
+                }
+                break;
+
+            case '?':
+                sendCapabilities();
+                break;
+
+            case 'T':
+                sendTelemetry();
+                break;
+
+            default:
+                UART_transmitData(EUSCI_A0_BASE, 'E');
+                UART_transmitData(EUSCI_A0_BASE, ERR_UNKNOWN_COMMAND);
+                break;
             }
 
+            /* Ready for the next command. */
+            command = 0;
             bytes = 0;
-
-            i = 1;
+            commandReady = false;
 
         }
 
@@ -196,7 +548,333 @@ void EUSCIA0_IRQHandler(void)
         while(!(UCA0IFG&UCTXIFG));//Busy wait
 
         msg = UCA0RXBUF;
-        information_bytes[bytes] = msg;
-        bytes++;
+
+        //Ignore anything sent before the last command was answered
+        if (commandReady)
+            return;
+
+        if (command == 0)
+        {
+            command = msg;
+            bytes = 0;
+            switch (command)
+            {
+            case 'F': payloadSize = 2*samples; break;
+            case 'N':
+            case 'S': payloadSize = 2; break;
+            case 'E': payloadSize = 1; break;
+            default: payloadSize = 0; break;
+            }
+        }
+        else if (command == 'F')
+        {
+            information_bytes[bytes] = msg;
+            bytes++;
+        }
+        else
+        {
+            commandArgs[bytes] = msg;
+            bytes++;
+        }
+
+        if (bytes == payloadSize) {
+            commandReady = true;
+#ifdef LOW_POWER
+            /* return to main rather than to sleep */
+            MAP_Interrupt_disableSleepOnIsrExit();
+#endif
+        }
     }
 }
+
+/*
+ * Whether engine e can do size in this build: it has a plan for it, and
+ * its work buffer fits work[] and its plan the heap. Without LARGE_FRAMES
+ * everything in planSizes[] that e has a plan for fits.
+ */
+bool engineFits(const fft_engine *e, uint16_t size)
+{
+    size_t len = e->planSize(size);
+
+    return len != 0 && e->workSize(size) <= WORK_BYTES &&
+           len + HEAP_OVERHEAD <= (size_t)&__SYSMEM_SIZE;
+}
+
+/*
+ * Switch to the FFT size given, if it is one of planSizes[] and the engine
+ * can do it. The current plan is kept if the size is not supported.
+ */
+bool selectPlan(uint16_t size)
+{
+    unsigned int p;
+    size_t len;
+
+    for (p = 0; p < PLAN_COUNT; p++) {
+        if (planSizes[p] == size)
+            break;
+    }
+    if (p == PLAN_COUNT || planMemory == NULL || !engineFits(engine, size))
+        return false;
+    len = engine->planSize(size);
+
+    plan = engine->plan(size, planMemory);
+    planBytes = len;
+    samples = size;
+
+#ifdef DIFF_OUTPUT
+    /* Old magnitudes mean nothing at the new size, start with a keyframe. */
+    framesSinceKey = 0;
+#endif
+    return true;
+}
+
+/*
+ * Switch to engine id, FFT_ENGINE_* in fftEngine/fft_engine.h, keeping the
+ * FFT size. The current engine is kept if id is not built in or cannot do
+ * the size.
+ */
+bool selectEngine(int id)
+{
+    const fft_engine *previous = engine;
+
+    if (id >= FFT_ENGINE_COUNT || fftEngines[id] == NULL)
+        return false;
+    engine = fftEngines[id];
+    if (!selectPlan(samples)) {
+        engine = previous;
+        return false;
+    }
+    engineId = id;
+    return true;
+}
+
+/* Report protocol version, current settings and the FFT sizes the engine does. */
+void sendCapabilities(void)
+{
+    unsigned int p;
+    uint8_t flags = 0;
+    uint8_t count = 0;
+
+#ifdef DIFF_OUTPUT
+    flags |= CAP_DIFF_OUTPUT;
+#endif
+#ifdef BFP_OUTPUT
+    flags |= CAP_BFP_OUTPUT;
+#endif
+#ifdef KISS_FFT_FLOAT
+    flags |= CAP_FLOAT_OUTPUT;
+#endif
+#ifdef RAMFUNC_KERNELS
+    flags |= CAP_RAMFUNC_KERNELS;
+#endif
+#ifdef LOW_POWER
+    flags |= CAP_LOW_POWER;
+#endif
+
+    UART_transmitData(EUSCI_A0_BASE, 'C');
+    UART_transmitData(EUSCI_A0_BASE, PROTOCOL_VERSION);
+    UART_transmitData(EUSCI_A0_BASE, flags);
+    sendWord(samples);
+    sendWord(sampleFreq);
+    sendWord(SAMPLE_FREQ_MAX);
+    for (p = 0; p < PLAN_COUNT; p++) {
+        if (engineFits(engine, planSizes[p]))
+            count++;
+    }
+    UART_transmitData(EUSCI_A0_BASE, count);
+    for (p = 0; p < PLAN_COUNT; p++) {
+        if (engineFits(engine, planSizes[p]))
+            sendWord(planSizes[p]);
+    }
+}
+
+/* Report the TEL_* values, each as a tag byte and a 32 bit value. */
+void sendTelemetry(void)
+{
+    uint8_t count = TELEMETRY_COUNT;
+    uint32_t engines = 0;
+    int e;
+#ifdef CHECK_OVERFLOW
+    int r, s;
+
+    count++;
+    for (r = 0; r < KISS_OVERFLOW_RADIXES; r++)
+        for (s = 0; s < KISS_OVERFLOW_STAGES; s++)
+            if (kiss_fft_overflows.count[r][s])
+                count++;
+#endif
+
+    for (e = 0; e < FFT_ENGINE_COUNT; e++) {
+        if (fftEngines[e] != NULL)
+            engines |= 1u << e;
+    }
+
+    UART_transmitData(EUSCI_A0_BASE, 'T');
+    UART_transmitData(EUSCI_A0_BASE, count);
+    UART_transmitData(EUSCI_A0_BASE, TEL_FFT_CYCLES);
+    sendLong(fftCycles);
+    UART_transmitData(EUSCI_A0_BASE, TEL_MAGNITUDE_CYCLES);
+    sendLong(magnitudeCycles);
+    UART_transmitData(EUSCI_A0_BASE, TEL_MCLK_HZ);
+    sendLong(computeMclk);
+    UART_transmitData(EUSCI_A0_BASE, TEL_STACK_PEAK);
+    sendLong(stackPeak());
+    UART_transmitData(EUSCI_A0_BASE, TEL_STACK_SIZE);
+    sendLong((uint32_t)&__STACK_SIZE);
+    UART_transmitData(EUSCI_A0_BASE, TEL_SRAM_FREE);
+    sendLong((uint32_t)&__STACK_END - (uint32_t)&__STACK_SIZE
+             - (uint32_t)&__SRAM_DATA_END);
+    UART_transmitData(EUSCI_A0_BASE, TEL_PLAN_BYTES);
+    sendLong(planBytes);
+    UART_transmitData(EUSCI_A0_BASE, TEL_PLAN_MEMORY);
+    sendLong(planMemorySize);
+    UART_transmitData(EUSCI_A0_BASE, TEL_HEAP_SIZE);
+    sendLong((uint32_t)&__SYSMEM_SIZE);
+    UART_transmitData(EUSCI_A0_BASE, TEL_IDLE_MCLK_HZ);
+    sendLong(idleMclk);
+    UART_transmitData(EUSCI_A0_BASE, TEL_WAIT_CYCLES);
+    sendLong(waitCycles);
+    UART_transmitData(EUSCI_A0_BASE, TEL_ENGINE);
+    sendLong(engineId);
+    UART_transmitData(EUSCI_A0_BASE, TEL_ENGINES);
+    sendLong(engines);
+#ifdef CHECK_OVERFLOW
+    UART_transmitData(EUSCI_A0_BASE, TEL_OVERFLOWS);
+    sendLong(kiss_fft_overflow_total());
+    for (r = 0; r < KISS_OVERFLOW_RADIXES; r++)
+        for (s = 0; s < KISS_OVERFLOW_STAGES; s++)
+            if (kiss_fft_overflows.count[r][s]) {
+                UART_transmitData(EUSCI_A0_BASE, TEL_OVERFLOW_BASE + r*8 + s);
+                sendLong(kiss_fft_overflows.count[r][s]);
+            }
+#endif
+}
+
+#ifdef LOW_POWER
+/*
+ * Waiting for commands: DCO at 12MHz for the UART's SMCLK, MCLK a sixteenth
+ * of it at core voltage 0 without flash wait states. Called with the UART
+ * idle; the DCO goes down before SMCLK's divider so SMCLK never passes
+ * 12MHz.
+ */
+void clockIdle(void)
+{
+    while (MAP_UART_queryStatusFlags(EUSCI_A0_BASE, EUSCI_A_UART_BUSY))
+        ;
+    CS_setDCOCenteredFrequency(CS_DCO_FREQUENCY_12);
+    MAP_CS_initClockSignal(CS_SMCLK, CS_DCOCLK_SELECT, CS_CLOCK_DIVIDER_1);
+    MAP_CS_initClockSignal(CS_MCLK, CS_DCOCLK_SELECT, CS_CLOCK_DIVIDER_16);
+    MAP_FlashCtl_setWaitState(FLASH_BANK0, 0);
+    MAP_FlashCtl_setWaitState(FLASH_BANK1, 0);
+    MAP_PCM_setCoreVoltageLevel(PCM_VCORE0);
+    idleMclk = CS_getMCLK();
+}
+
+/* The FFT at 48MHz, SMCLK kept at 12MHz, the reverse of clockIdle(). */
+void clockCompute(void)
+{
+    MAP_PCM_setCoreVoltageLevel(PCM_VCORE1);
+    MAP_FlashCtl_setWaitState(FLASH_BANK0, 1);
+    MAP_FlashCtl_setWaitState(FLASH_BANK1, 1);
+    MAP_CS_initClockSignal(CS_SMCLK, CS_DCOCLK_SELECT, CS_CLOCK_DIVIDER_4);
+    MAP_CS_initClockSignal(CS_MCLK, CS_DCOCLK_SELECT, CS_CLOCK_DIVIDER_1);
+    CS_setDCOCenteredFrequency(CS_DCO_FREQUENCY_48);
+    computeMclk = CS_getMCLK();
+}
+#endif
+
+/*
+ * Bytes below __STACK_END the stack has reached since reset: the lowest
+ * word whose paint is gone, searched up from the end of the data.
+ */
+uint32_t stackPeak(void)
+{
+    const uint32_t *p = (const uint32_t *)(((uint32_t)&__SRAM_DATA_END + 3) & ~3u);
+
+    while (p < (const uint32_t *)&__STACK_END && *p == STACK_PAINT)
+        p++;
+    return (uint32_t)&__STACK_END - (uint32_t)p;
+}
+
+/* Send a 16 bit word, least significant byte first. */
+void sendWord(uint16_t word)
+{
+    UART_transmitData(EUSCI_A0_BASE, (word%256));
+    UART_transmitData(EUSCI_A0_BASE, (word/256));
+}
+
+/* Send a 32 bit value, least significant word first. */
+void sendLong(uint32_t value)
+{
+    sendWord(value & 0xFFFF);
+    sendWord(value >> 16);
+}
+
+#ifdef DIFF_OUTPUT
+/* True if bin k has moved outside the deadband since it was last sent. */
+static bool binChanged(const int16_t *mag, int k)
+{
+    return abs(mag[k] - lastSent[k]) > DIFF_DEADBAND;
+}
+
+/*
+ * Find the next run of changed bins at or after bin from. Runs separated by
+ * no more than DIFF_MAX_GAP unchanged bins are merged, since resending a few
+ * bins is cheaper than a new run header. Returns the run length, or 0 if
+ * nothing further has changed.
+ */
+static int nextRun(const int16_t *mag, int from, int *start)
+{
+    int k, end;
+
+    for (k = from; k < samples/2 && !binChanged(mag, k); k++);
+    if (k == samples/2)
+        return 0;
+
+    *start = k;
+    end = k + 1;
+    for (k = end; k < samples/2 && k - end <= DIFF_MAX_GAP; k++) {
+        if (binChanged(mag, k))
+            end = k + 1;
+    }
+    return end - *start;
+}
+
+/*
+ * Transmit the spectrum as a keyframe or as runs of changed bins. A keyframe
+ * is also sent whenever the delta would not be any smaller.
+ */
+void sendDifferential(const int16_t *mag)
+{
+    int k, start, len, runs = 0;
+    int deltaBytes = 2;
+
+    for (k = 0; (len = nextRun(mag, k, &start)) != 0; k = start + len) {
+        runs++;
+        deltaBytes += 4 + 2*len;
+    }
+
+    if (framesSinceKey == 0 || deltaBytes >= samples) {
+        UART_transmitData(EUSCI_A0_BASE, 'K');
+        for (k = 0; k < samples/2; k++) {
+            sendWord(mag[k]);
+            lastSent[k] = mag[k];
+        }
+        framesSinceKey = 0;
+    } else {
+        UART_transmitData(EUSCI_A0_BASE, 'D');
+        sendWord(runs);
+        for (k = 0; (len = nextRun(mag, k, &start)) != 0; k = start + len) {
+            int j;
+            sendWord(start);
+            sendWord(len);
+            for (j = start; j < start + len; j++) {
+                sendWord(mag[j]);
+                lastSent[j] = mag[j];
+            }
+        }
+    }
+
+    framesSinceKey = (framesSinceKey + 1) % DIFF_KEYFRAME_INTERVAL;
+}
+#endif